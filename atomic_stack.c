@@ -0,0 +1,72 @@
+// It's licensed under MIT, btw
+#include "atomic_stack.h"
+#include "epoch.h"
+
+#include <stddef.h> // size_t
+#include <string.h> // memcpy()
+#include <stdlib.h> // malloc() and free()
+
+static void __item_free(void *p) {
+    free(p);
+}
+
+atomic_stack_t *atomic_stack_new() {
+    atomic_stack_t *S = (atomic_stack_t*)malloc(sizeof(atomic_stack_t));
+
+    atomic_init(&S->head, 0);
+    return S;
+}
+
+int atomic_stack_empty(atomic_stack_t *S) {
+    return !atomic_load_explicit(&S->head, memory_order_relaxed);
+}
+
+
+void atomic_stack_push(atomic_stack_t *S, void *item, size_t size) {
+    struct stack_item *newi = (struct stack_item*)malloc(sizeof(struct stack_item));
+
+    newi->item = size <= STACK_INLINE ? newi->small : malloc(size);
+    memcpy(newi->item, item, size);
+    newi->size = size;
+
+    newi->prev = atomic_load_explicit(&S->head, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&S->head, &newi->prev, newi, memory_order_release, memory_order_relaxed));
+}
+
+int atomic_stack_pop(atomic_stack_t *S, void *item, size_t *size) {
+    struct stack_item *oldi;
+
+    // Inside the critical section `oldi` can't be freed and reused, which rules out ABA on `head`
+    epoch_enter();
+    oldi = atomic_load_explicit(&S->head, memory_order_acquire);
+    while (oldi && !atomic_compare_exchange_weak_explicit(&S->head, &oldi, oldi->prev, memory_order_acquire, memory_order_acquire));
+    epoch_exit();
+
+    if (!oldi) return 0;
+
+    // Other threads may still read `oldi->prev`, but nothing else, so the payload is ours
+    memcpy(item, oldi->item, oldi->size < *size ? oldi->size : *size);
+    *size = oldi->size;
+
+    if (oldi->item != oldi->small) free(oldi->item);
+    epoch_retire(oldi, __item_free);
+    return 1;
+}
+
+stack_t atomic_stack_pop_all(atomic_stack_t *S) {
+    stack_t R = stack_new();
+
+    R.head = atomic_exchange_explicit(&S->head, 0, memory_order_acquire);
+    for (struct stack_item *p = R.head; p; p = p->prev) R.size++;
+
+    // A pop which loaded one of the nodes before the exchange may still read its `prev`
+    if (R.head) epoch_synchronize();
+    return R;
+}
+
+void atomic_stack_free(atomic_stack_t *S) {
+    stack_t R = atomic_stack_pop_all(S);
+
+    while (!stack_empty(R)) stack_pop(&R);
+    free(S);
+}
\ No newline at end of file
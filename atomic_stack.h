@@ -0,0 +1,42 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_ATOMIC_STACK_H
+#define _CTYPES_ATOMIC_STACK_H
+
+#include <stddef.h>    // size_t
+#include <stdatomic.h> // _Atomic
+
+#include "stack.h"
+
+// A lock-free stack which can be shared between any number of threads, obtained with `atomic_stack_new()`
+// Popped items are freed through `epoch.h`, so a node is never reused while another thread still reads it
+struct atomic_stack {
+    _Atomic(struct stack_item*) head;
+};
+
+typedef struct atomic_stack atomic_stack_t;
+
+
+// Returns an empty stack
+extern atomic_stack_t *atomic_stack_new();
+
+// Returns a boolean value indicating whether or not `S` is empty (only a snapshot under concurrent use)
+extern int atomic_stack_empty(atomic_stack_t *S);
+
+
+// Copies an element to the top
+extern void atomic_stack_push(atomic_stack_t *S, void *item, size_t size);
+
+// Moves the top element into `item`, which has room for `*size` bytes, and stores its real size in `*size`
+// (Bigger elements are truncated)
+// Returns 0 if the stack is empty
+extern int atomic_stack_pop(atomic_stack_t *S, void *item, size_t *size);
+
+// Detaches all elements at once and returns them as a plain `stack_t`, top first
+// Waits for concurrent pops to finish with the detached nodes, so the result can be freed right away
+extern stack_t atomic_stack_pop_all(atomic_stack_t *S);
+
+// Releases the stack and the elements left in it
+// No other thread may be using the stack
+extern void atomic_stack_free(atomic_stack_t *S);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,913 @@
+// It's licensed under MIT, btw
+//
+// Benchmark harness for the containers and comparators
+// Every benchmark reports ops/s, ns/op and sampled p50/p99/p999 latencies, as a table or as JSON (--json)
+//
+// Build: make bench (from the repository root)
+//
+// Usage: bench [--sizes=1000,1000000] [--keys=4,8,1024] [--patterns=seq,random,zipf]
+//              [--threads=1,8] [--ops=1000000] [--only=set,map,...] [--json]
+#define _GNU_SOURCE // clock_gettime() and sysconf()
+#include "comparator.h"
+#include "set.h"
+#include "map.h"
+#include "btree.h"
+#include "hashmap.h"
+#include "deque.h"
+#include "queue.h"
+#include "cmap.h"
+#include "shard_set.h"
+#include "mpmc_queue.h"
+#include "atomic_stack.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Every this many operations one is timed on its own for the latency percentiles
+#define BENCH_SAMPLE 64
+
+// The skew of the zipfian pattern
+#define BENCH_ZIPF_THETA 0.99
+
+#define BENCH_LIST_MAX 16
+
+// The number of keys handed to the batched lookups at once
+#define BENCH_BATCH 64
+
+// ---
+// options
+
+enum pattern { SEQUENTIAL, RANDOM, ZIPFIAN, PATTERNS };
+
+static const char *pattern_names[PATTERNS] = {"seq", "random", "zipf"};
+
+struct options {
+    size_t sizes[BENCH_LIST_MAX], nsizes;
+    size_t keys[BENCH_LIST_MAX], nkeys;
+    size_t threads[BENCH_LIST_MAX], nthreads;
+    int patterns[PATTERNS];
+    size_t ops;       // The number of lookups (or comparisons, or multi-threaded operations) per run
+    const char *only; // A comma-separated list of benchmark groups, all of them if zero
+    int json;
+};
+
+static size_t parse_list(const char *s, size_t *out) {
+    size_t n = 0;
+
+    while (*s && n < BENCH_LIST_MAX) {
+        char *end;
+        out[n++] = (size_t)strtod(s, &end); // strtod() accepts 1e6
+        s = *end == ',' ? end + 1 : end;
+        if (end == s && *s) break;
+    }
+    return n;
+}
+
+static void parse_options(struct options *O, int argc, char **argv) {
+    *O = (struct options){{1000, 10000, 100000, 1000000}, 4, {8}, 1, {1}, 1, {1, 1, 1}, 1000000, 0, 0};
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+
+        if (!strncmp(a, "--sizes=", 8)) O->nsizes = parse_list(a + 8, O->sizes);
+        else if (!strncmp(a, "--keys=", 7)) O->nkeys = parse_list(a + 7, O->keys);
+        else if (!strncmp(a, "--threads=", 10)) O->nthreads = parse_list(a + 10, O->threads);
+        else if (!strncmp(a, "--ops=", 6)) O->ops = (size_t)strtod(a + 6, 0);
+        else if (!strncmp(a, "--only=", 7)) O->only = a + 7;
+        else if (!strcmp(a, "--json")) O->json = 1;
+        else if (!strncmp(a, "--patterns=", 11)) {
+            for (int p = 0; p < PATTERNS; p++) O->patterns[p] = strstr(a + 11, pattern_names[p]) != 0;
+        } else {
+            fprintf(stderr, "usage: %s [--sizes=N,...] [--keys=B,...] [--patterns=seq,random,zipf] [--threads=T,...] [--ops=N] [--only=GROUP,...] [--json]\n", argv[0]);
+            exit(2);
+        }
+    }
+
+    for (size_t i = 0; i < O->nkeys; i++)
+        if (O->keys[i] < 4) O->keys[i] = 4;
+    for (size_t i = 0; i < O->nthreads; i++)
+        if (!O->threads[i]) O->threads[i] = (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+// Returns a boolean value indicating whether or not `group` was selected with --only
+static int selected(struct options *O, const char *group) {
+    size_t n = strlen(group);
+
+    if (!O->only) return 1;
+    for (const char *s = O->only; s; s = strchr(s, ',') ? strchr(s, ',') + 1 : 0)
+        if (!strncmp(s, group, n) && (s[n] == ',' || !s[n])) return 1;
+    return 0;
+}
+
+// ---
+
+// ---
+// keys and access patterns
+//
+// Key `i` holds `i` in its first bytes and a constant filler after them, so long keys share a long common suffix.
+// The random pattern visits a pseudo-random permutation of [0, n), the zipfian one draws hot keys
+// (spread over the key space by the same permutation) with the YCSB generator.
+
+struct keygen {
+    enum pattern pattern;
+    size_t n;
+    unsigned bits; // The smallest power of two covering `n`
+    uint64_t rng;
+
+    // Zipfian generator state
+    double zetan, alpha, eta, half;
+};
+
+static uint64_t splitmix(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// A bijection of [0, 2^bits), walked until it lands in [0, n)
+static size_t permute(struct keygen *G, size_t x) {
+    uint64_t mask = G->bits >= 64 ? ~0ull : (1ull << G->bits) - 1;
+    unsigned shift = G->bits / 2 ? G->bits / 2 : 1;
+
+    do {
+        x = (x ^ (x >> shift)) & mask;
+        x = (x * 0x9e3779b97f4a7c15ull + 0x632be59bd9b4e019ull) & mask;
+        x = (x ^ (x >> shift)) & mask;
+    } while (x >= G->n);
+    return x;
+}
+
+static double zeta(size_t n, double theta) {
+    static size_t cached_n;
+    static double cached;
+
+    if (n != cached_n) {
+        cached = 0;
+        for (size_t i = 1; i <= n; i++) cached += 1 / pow((double)i, theta);
+        cached_n = n;
+    }
+    return cached;
+}
+
+static void keygen_init(struct keygen *G, enum pattern pattern, size_t n, uint64_t seed) {
+    *G = (struct keygen){pattern, n, 1, seed, 0, 0, 0, 0};
+
+    while (G->bits < 64 && (1ull << G->bits) < n) G->bits++;
+
+    if (pattern == ZIPFIAN) {
+        double zeta2 = 1 + pow(0.5, BENCH_ZIPF_THETA);
+        G->zetan = zeta(n, BENCH_ZIPF_THETA);
+        G->alpha = 1 / (1 - BENCH_ZIPF_THETA);
+        G->eta = (1 - pow(2.0 / n, 1 - BENCH_ZIPF_THETA)) / (1 - zeta2 / G->zetan);
+        G->half = 1 + pow(0.5, BENCH_ZIPF_THETA);
+    }
+}
+
+// Returns the index of the `i`-th key to visit
+static size_t keygen_next(struct keygen *G, size_t i) {
+    double u, uz;
+    size_t k;
+
+    switch (G->pattern) {
+    case SEQUENTIAL: return i % G->n;
+    case RANDOM: return permute(G, i % G->n);
+    default:
+        u = (splitmix(&G->rng) >> 11) * 0x1.0p-53;
+        uz = u * G->zetan;
+        if (uz < 1) k = 0;
+        else if (uz < G->half) k = 1;
+        else k = (size_t)(G->n * pow(G->eta * u - G->eta + 1, G->alpha));
+        return permute(G, k < G->n ? k : G->n - 1);
+    }
+}
+
+static uint8_t *key_buffer(size_t size) {
+    uint8_t *buf = (uint8_t*)malloc(size);
+
+    memset(buf, 0xa5, size);
+    return buf;
+}
+
+static cmp_item_t key_fill(uint8_t *buf, size_t size, size_t i) {
+    if (size < sizeof(uint64_t)) {
+        uint32_t x = (uint32_t)i;
+        memcpy(buf, &x, sizeof(x));
+    } else {
+        uint64_t x = i;
+        memcpy(buf, &x, sizeof(x));
+    }
+    return cmp_item_new(buf, size);
+}
+
+// Fills `BENCH_BATCH` keys of `size` bytes, the ones `G` generates from the `i`-th on
+static void key_fill_batch(uint8_t *buf, cmp_item_t *keys, size_t size, struct keygen *G, size_t i) {
+    for (size_t j = 0; j < BENCH_BATCH; j++) keys[j] = key_fill(buf + j * size, size, keygen_next(G, i + j));
+}
+
+// 4- and 8-byte keys use the typed comparators, like an application storing integers would
+static int (*key_cmp(size_t size))(cmp_item_t a, cmp_item_t b) {
+    if (size == sizeof(uint32_t)) return cmp_sgn_u32;
+    if (size == sizeof(uint64_t)) return cmp_sgn_u64;
+    return cmp_sgn;
+}
+
+// ---
+
+// ---
+// timing and reporting
+
+struct samples {
+    double *data; // Nanoseconds
+    size_t size;
+    size_t capacity;
+};
+
+struct result {
+    const char *bench;
+    enum pattern pattern;
+    size_t n, key, threads, ops;
+    double seconds;
+    struct samples lat;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The cost of reading the clock twice, subtracted from every sample
+static double timer_overhead;
+
+static void timer_calibrate(void) {
+    double best = 1;
+
+    for (int i = 0; i < 1000; i++) {
+        double t = now();
+        double d = now() - t;
+        if (d < best) best = d;
+    }
+    timer_overhead = best;
+}
+
+static void sample_push(struct samples *S, double ns) {
+    if (S->size == S->capacity) {
+        S->capacity = S->capacity ? S->capacity * 2 : 1024;
+        S->data = (double*)realloc(S->data, S->capacity * sizeof(double));
+    }
+    S->data[S->size++] = ns;
+}
+
+static void sample_add(struct samples *S, double seconds) {
+    seconds -= timer_overhead;
+    sample_push(S, seconds > 0 ? seconds * 1e9 : 0);
+}
+
+static void sample_merge(struct samples *to, struct samples *from) {
+    for (size_t i = 0; i < from->size; i++) sample_push(to, from->data[i]);
+    free(from->data);
+    *from = (struct samples){0};
+}
+
+// Runs `stmt` for the `i`-th operation, timing it on its own every `BENCH_SAMPLE` operations
+#define TIMED(S, i, stmt) do { \
+    if ((i) % BENCH_SAMPLE == 0) { \
+        double __t = now(); \
+        stmt; \
+        sample_add((S), now() - __t); \
+    } else { \
+        stmt; \
+    } \
+} while (0)
+
+static int by_value(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(struct samples *S, double p) {
+    if (!S->size) return 0;
+    return S->data[(size_t)(p * (S->size - 1))];
+}
+
+static int reported;
+
+static void report(struct options *O, struct result *R) {
+    double ops_s = R->seconds > 0 ? R->ops / R->seconds : 0;
+    double ns_op = R->ops ? R->seconds * 1e9 / R->ops : 0;
+
+    qsort(R->lat.data, R->lat.size, sizeof(double), by_value);
+
+    if (O->json) {
+        printf("%s\n  {\"bench\": \"%s\", \"pattern\": \"%s\", \"n\": %zu, \"key\": %zu, \"threads\": %zu, \"ops\": %zu, "
+               "\"ops_per_s\": %.1f, \"ns_per_op\": %.2f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"p999_ns\": %.1f}",
+               reported ? "," : "[", R->bench, pattern_names[R->pattern], R->n, R->key, R->threads, R->ops,
+               ops_s, ns_op, percentile(&R->lat, 0.5), percentile(&R->lat, 0.99), percentile(&R->lat, 0.999));
+    } else {
+        if (!reported)
+            printf("%-18s %-7s %10s %6s %3s %12s %10s %9s %9s %9s\n", "bench", "pattern", "n", "key", "thr", "ops/s", "ns/op", "p50", "p99", "p999");
+        printf("%-18s %-7s %10zu %6zu %3zu %12.0f %10.2f %9.0f %9.0f %9.0f\n", R->bench, pattern_names[R->pattern], R->n, R->key, R->threads,
+               ops_s, ns_op, percentile(&R->lat, 0.5), percentile(&R->lat, 0.99), percentile(&R->lat, 0.999));
+    }
+    fflush(stdout);
+
+    reported = 1;
+    free(R->lat.data);
+    R->lat = (struct samples){0};
+}
+
+static struct result result_new(const char *bench, enum pattern pattern, size_t n, size_t key, size_t threads) {
+    return (struct result){bench, pattern, n, key, threads, 0, 0, {0}};
+}
+
+// ---
+
+// ---
+// single-threaded benchmarks
+//
+// Inserts and deletes visit every key once in the pattern's order (the zipfian one repeats hot keys instead),
+// lookups run `ops` times over the full container.
+
+static void bench_set(struct options *O, enum pattern p, size_t n, size_t key) {
+    uint8_t *buf = key_buffer(key), *batch = key_buffer(key * BENCH_BATCH);
+    cmp_item_t keys[BENCH_BATCH];
+    set_t S = set_new(key_cmp(key)), B, U;
+    struct keygen G;
+    struct result R;
+    volatile int sink = 0;
+    double t;
+
+    keygen_init(&G, p, n, 1);
+    R = result_new("set_insert", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, set_insert(&S, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 2);
+    R = result_new("set_count", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i++) TIMED(&R.lat, i, sink += set_count(S, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    // Every batched call is timed as a whole
+    keygen_init(&G, p, n, 2);
+    R = result_new("set_count_many", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i += BENCH_BATCH) {
+        key_fill_batch(batch, keys, key, &G, i);
+        TIMED(&R.lat, i, sink += (int)set_count_many(S, keys, BENCH_BATCH, 0));
+    }
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    // The set algebra runs once over `S` and a second set of `n` keys, every key of either counts as one operation
+    keygen_init(&G, p, n, 4);
+    B = set_new(key_cmp(key));
+    for (size_t i = 0; i < n; i++) set_insert(&B, key_fill(buf, key, keygen_next(&G, i)));
+    for (int op = 0; op < 2; op++) {
+        R = result_new(op ? "set_union" : "set_intersect", p, n, key, 1);
+        t = now();
+        TIMED(&R.lat, 0, U = op ? set_union(S, B) : set_intersect(S, B));
+        R.seconds = now() - t;
+        R.ops = set_size(S) + set_size(B);
+        report(O, &R);
+        sink += (int)set_size(U);
+        set_free(&U);
+    }
+    set_free(&B);
+
+    keygen_init(&G, p, n, 3);
+    R = result_new("set_delete", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, set_delete(&S, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    (void)sink;
+    set_free(&S);
+    free(batch);
+    free(buf);
+}
+
+static void bench_map(struct options *O, enum pattern p, size_t n, size_t key) {
+    uint8_t *buf = key_buffer(key), *batch = key_buffer(key * BENCH_BATCH);
+    cmp_item_t keys[BENCH_BATCH], *values[BENCH_BATCH];
+    map_t M = map_new(key_cmp(key));
+    uint64_t value = 42;
+    struct keygen G;
+    struct result R;
+    void *volatile sink = 0;
+    double t;
+
+    keygen_init(&G, p, n, 1);
+    R = result_new("map_insert", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, map_insert(&M, key_fill(buf, key, keygen_next(&G, i)), cmp_item_new(&value, sizeof(value))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 2);
+    R = result_new("map_find", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i++) TIMED(&R.lat, i, sink = map_find(M, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 2);
+    R = result_new("map_find_many", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i += BENCH_BATCH) {
+        key_fill_batch(batch, keys, key, &G, i);
+        TIMED(&R.lat, i, map_find_many(M, keys, BENCH_BATCH, values));
+        sink = values[0];
+    }
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 3);
+    R = result_new("map_delete", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, map_delete(&M, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 1);
+    R = result_new("map_insert_batch", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i += BENCH_BATCH) {
+        key_fill_batch(batch, keys, key, &G, i);
+        TIMED(&R.lat, i, map_insert_batch(&M, keys, keys, n - i < BENCH_BATCH ? n - i : BENCH_BATCH));
+    }
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 3);
+    R = result_new("map_delete_batch", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i += BENCH_BATCH) {
+        key_fill_batch(batch, keys, key, &G, i);
+        TIMED(&R.lat, i, map_delete_batch(&M, keys, n - i < BENCH_BATCH ? n - i : BENCH_BATCH));
+    }
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    (void)sink;
+    map_free(&M);
+    free(batch);
+    free(buf);
+}
+
+static void bench_btree(struct options *O, enum pattern p, size_t n, size_t key) {
+    uint8_t *buf = key_buffer(key);
+    btree_t T = btree_new(key_cmp(key));
+    uint64_t value = 42;
+    struct keygen G;
+    struct result R;
+    void *volatile sink = 0;
+    double t;
+
+    keygen_init(&G, p, n, 1);
+    R = result_new("btree_insert", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, btree_insert(&T, key_fill(buf, key, keygen_next(&G, i)), cmp_item_new(&value, sizeof(value))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 2);
+    R = result_new("btree_find", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i++) TIMED(&R.lat, i, sink = btree_find(T, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 3);
+    R = result_new("btree_delete", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, btree_delete(&T, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    (void)sink;
+    btree_free(&T);
+    free(buf);
+}
+
+static void bench_hashmap(struct options *O, enum pattern p, size_t n, size_t key) {
+    uint8_t *buf = key_buffer(key);
+    hashmap_t H = hashmap_new(0);
+    uint64_t value = 42;
+    struct keygen G;
+    struct result R;
+    void *volatile sink = 0;
+    double t;
+
+    keygen_init(&G, p, n, 1);
+    R = result_new("hashmap_insert", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, hashmap_insert(&H, key_fill(buf, key, keygen_next(&G, i)), cmp_item_new(&value, sizeof(value))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 2);
+    R = result_new("hashmap_find", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i++) TIMED(&R.lat, i, sink = hashmap_find(H, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 3);
+    R = result_new("hashmap_delete", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, hashmap_delete(&H, key_fill(buf, key, keygen_next(&G, i))));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    (void)sink;
+    hashmap_free(&H);
+    free(buf);
+}
+
+static void bench_deque(struct options *O, enum pattern p, size_t n, size_t key) {
+    uint8_t *buf = key_buffer(key);
+    deque_t L = deque_new();
+    struct keygen G;
+    struct result R;
+    void *volatile sink = 0;
+    double t;
+
+    R = result_new("deque_push_back", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, deque_push_back(&L, key_fill(buf, key, i).data, key));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    keygen_init(&G, p, n, 2);
+    R = result_new("deque_at", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < O->ops; i++) TIMED(&R.lat, i, sink = deque_at(L, (int)keygen_next(&G, i)));
+    R.seconds = now() - t;
+    R.ops = O->ops;
+    report(O, &R);
+
+    R = result_new("deque_pop_front", p, n, key, 1);
+    t = now();
+    for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, deque_pop_front(&L));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    (void)sink;
+    deque_free(&L);
+    free(buf);
+}
+
+// Queues don't depend on the key order, so they only run with the sequential pattern
+static void bench_queue(struct options *O, enum pattern p, size_t n, size_t key) {
+    static const char *names[2][2] = {{"queue_push", "queue_pop"}, {"queue_ring_push", "queue_ring_pop"}};
+    uint8_t *buf = key_buffer(key);
+    struct result R;
+    double t;
+
+    if (p != SEQUENTIAL) {
+        free(buf);
+        return;
+    }
+
+    for (int ring = 0; ring < 2; ring++) {
+        queue_t Q = ring ? queue_new_ring(key) : queue_new();
+
+        R = result_new(names[ring][0], p, n, key, 1);
+        t = now();
+        for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, queue_push(&Q, key_fill(buf, key, i).data, key));
+        R.seconds = now() - t;
+        R.ops = n;
+        report(O, &R);
+
+        R = result_new(names[ring][1], p, n, key, 1);
+        t = now();
+        for (size_t i = 0; i < n; i++) TIMED(&R.lat, i, queue_pop(&Q));
+        R.seconds = now() - t;
+        R.ops = n;
+        report(O, &R);
+
+        queue_free(&Q);
+    }
+    free(buf);
+}
+
+// Compares the `i`-th key of the pattern with its successor, `ops` times per comparator
+static void bench_cmp(struct options *O, enum pattern p, size_t n, size_t key) {
+    struct comparator {
+        const char *name;
+        size_t key; // Only run for this key size, any if zero
+        int (*cmp)(cmp_item_t a, cmp_item_t b);
+    };
+    static const struct comparator comparators[] = {
+        {"cmp_sgn", 0, cmp_sgn}, {"cmp_sgn_le", 0, cmp_sgn_le}, {"cmp_sgn_be", 0, cmp_sgn_be}, {"cmp_equal", 0, cmp_equal},
+        {"cmp_sgn_u32", 4, cmp_sgn_u32}, {"cmp_sgn_i32", 4, cmp_sgn_i32}, {"cmp_sgn_f32", 4, cmp_sgn_f32},
+        {"cmp_sgn_u64", 8, cmp_sgn_u64}, {"cmp_sgn_i64", 8, cmp_sgn_i64}, {"cmp_sgn_f64", 8, cmp_sgn_f64},
+    };
+    uint8_t *a = key_buffer(key), *b = key_buffer(key);
+    volatile int sink = 0;
+
+    for (size_t c = 0; c < sizeof(comparators) / sizeof(comparators[0]); c++) {
+        const struct comparator *C = &comparators[c];
+        struct keygen G;
+        struct result R;
+        double t;
+
+        if (C->key && C->key != key) continue;
+
+        keygen_init(&G, p, n, 4);
+        R = result_new(C->name, p, n, key, 1);
+        t = now();
+        for (size_t i = 0; i < O->ops; i++)
+            TIMED(&R.lat, i, sink += C->cmp(key_fill(a, key, keygen_next(&G, i)), key_fill(b, key, keygen_next(&G, i + 1))));
+        R.seconds = now() - t;
+        R.ops = O->ops;
+        report(O, &R);
+    }
+
+    (void)sink;
+    free(a);
+    free(b);
+}
+
+// ---
+
+// ---
+// multi-threaded benchmarks
+//
+// Every thread runs `ops / threads` operations with its own pattern generator and latency samples,
+// throughput is measured over the whole run.
+
+struct worker {
+    pthread_t thread;
+    size_t id, threads, ops, n, key;
+    enum pattern pattern;
+    void *shared;
+    struct samples lat;
+};
+
+static void run_workers(struct options *O, const char *name, enum pattern p, size_t n, size_t key, size_t threads, void *shared, void *(*fn)(void*)) {
+    struct worker *W = (struct worker*)calloc(threads, sizeof(struct worker));
+    struct result R = result_new(name, p, n, key, threads);
+    double t;
+
+    // The zipfian constant is cached by the first caller, so it's computed before the workers need it
+    if (p == ZIPFIAN) zeta(n, BENCH_ZIPF_THETA);
+
+    for (size_t i = 0; i < threads; i++)
+        W[i] = (struct worker){0, i, threads, O->ops / threads, n, key, p, shared, {0}};
+
+    t = now();
+    for (size_t i = 0; i < threads; i++) pthread_create(&W[i].thread, 0, fn, &W[i]);
+    for (size_t i = 0; i < threads; i++) pthread_join(W[i].thread, 0);
+    R.seconds = now() - t;
+
+    for (size_t i = 0; i < threads; i++) {
+        R.ops += W[i].ops;
+        sample_merge(&R.lat, &W[i].lat);
+    }
+    report(O, &R);
+    free(W);
+}
+
+static void *cmap_reader(void *arg) {
+    struct worker *W = (struct worker*)arg;
+    uint8_t *buf = key_buffer(W->key);
+    uint64_t value;
+    size_t size;
+    struct keygen G;
+
+    keygen_init(&G, W->pattern, W->n, 10 + W->id);
+    for (size_t i = 0; i < W->ops; i++) {
+        size = sizeof(value);
+        TIMED(&W->lat, i, cmap_find((cmap_t*)W->shared, key_fill(buf, W->key, keygen_next(&G, i * W->threads + W->id)), &value, &size));
+    }
+
+    free(buf);
+    return 0;
+}
+
+// 90% lookups, 5% inserts and 5% deletes
+static void *shard_set_mixer(void *arg) {
+    struct worker *W = (struct worker*)arg;
+    shard_set_t *S = (shard_set_t*)W->shared;
+    uint8_t *buf = key_buffer(W->key);
+    uint64_t rng = W->id;
+    struct keygen G;
+
+    keygen_init(&G, W->pattern, W->n, 20 + W->id);
+    for (size_t i = 0; i < W->ops; i++) {
+        cmp_item_t key = key_fill(buf, W->key, keygen_next(&G, i * W->threads + W->id));
+        unsigned dice = (unsigned)(splitmix(&rng) % 100);
+
+        if (dice < 90) TIMED(&W->lat, i, shard_set_count(S, key));
+        else if (dice < 95) TIMED(&W->lat, i, shard_set_insert(S, key));
+        else TIMED(&W->lat, i, shard_set_delete(S, key));
+    }
+
+    free(buf);
+    return 0;
+}
+
+// Pushes and pops in turn, so the queue stays short and every thread is both a producer and a consumer
+static void *mpmc_worker(void *arg) {
+    struct worker *W = (struct worker*)arg;
+    mpmc_queue_t *Q = (mpmc_queue_t*)W->shared;
+    uint8_t *buf = key_buffer(W->key);
+    size_t size;
+
+    for (size_t i = 0; i < W->ops; i++) {
+        size = W->key;
+        if (i & 1) TIMED(&W->lat, i, mpmc_queue_pop(Q, buf, &size));
+        else TIMED(&W->lat, i, mpmc_queue_push(Q, buf, W->key));
+    }
+    if (W->ops & 1) {
+        size = W->key;
+        mpmc_queue_pop(Q, buf, &size);
+    }
+
+    free(buf);
+    return 0;
+}
+
+static void *atomic_stack_worker(void *arg) {
+    struct worker *W = (struct worker*)arg;
+    atomic_stack_t *S = (atomic_stack_t*)W->shared;
+    uint8_t *buf = key_buffer(W->key);
+    size_t size;
+
+    for (size_t i = 0; i < W->ops; i++) {
+        size = W->key;
+        if (i & 1) TIMED(&W->lat, i, atomic_stack_pop(S, buf, &size));
+        else TIMED(&W->lat, i, atomic_stack_push(S, buf, W->key));
+    }
+
+    free(buf);
+    return 0;
+}
+
+static void touch(struct map_node *node, void *arg) {
+    (void)arg;
+    ((uint8_t*)node->value.data)[0]++;
+}
+
+// The parallel bulk calls run once each on a pool of `threads` threads, every key counts as one operation
+static void bench_pool(struct options *O, enum pattern p, size_t n, size_t key, size_t threads) {
+    pool_t *P = pool_new(threads);
+    uint8_t *buf = key_buffer(2 * n * key);
+    cmp_item_t *keys = (cmp_item_t*)malloc(2 * n * sizeof(cmp_item_t));
+    deque_t L = deque_new();
+    struct keygen G;
+    struct result R;
+    volatile int sink = 0;
+    set_t S, B, U;
+    map_t M;
+    double t;
+
+    // Two sorted batches of keys, for the two sets
+    for (size_t b = 0; b < 2; b++) {
+        keygen_init(&G, p, n, 1 + 3 * b);
+        for (size_t i = 0; i < n; i++) keys[b * n + i] = key_fill(buf + (b * n + i) * key, key, keygen_next(&G, i));
+        cmp_sort(keys + b * n, n, sizeof(cmp_item_t), key_cmp(key));
+    }
+
+    R = result_new("map_from_sorted_parallel", p, n, key, threads);
+    t = now();
+    TIMED(&R.lat, 0, M = map_from_sorted_parallel(keys, keys, n, key_cmp(key), P));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    R = result_new("map_for_each", p, n, key, threads);
+    t = now();
+    TIMED(&R.lat, 0, map_for_each(M, touch, 0, P));
+    R.seconds = now() - t;
+    R.ops = map_size(M);
+    report(O, &R);
+    map_free(&M);
+
+    S = set_from_sorted_parallel(keys, n, key_cmp(key), P);
+    B = set_from_sorted_parallel(keys + n, n, key_cmp(key), P);
+    for (int op = 0; op < 2; op++) {
+        R = result_new(op ? "set_union_parallel" : "set_intersect_parallel", p, n, key, threads);
+        t = now();
+        TIMED(&R.lat, 0, U = op ? set_union_parallel(S, B, P) : set_intersect_parallel(S, B, P));
+        R.seconds = now() - t;
+        R.ops = set_size(S) + set_size(B);
+        report(O, &R);
+        sink += (int)set_size(U);
+        set_free(&U);
+    }
+    set_free(&B);
+    set_free(&S);
+
+    for (size_t i = 0; i < n; i++) deque_push_back(&L, keys[i].data, key);
+    R = result_new("deque_count_parallel", p, n, key, threads);
+    t = now();
+    TIMED(&R.lat, 0, sink += deque_count_parallel(L, keys[0].data, key, P));
+    R.seconds = now() - t;
+    R.ops = n;
+    report(O, &R);
+
+    (void)sink;
+    deque_free(&L);
+    free(keys);
+    free(buf);
+    pool_free(P);
+}
+
+static void bench_threads(struct options *O, enum pattern p, size_t n, size_t key) {
+    uint8_t *buf = key_buffer(key);
+    uint64_t value = 42;
+
+    for (size_t t = 0; t < O->nthreads; t++) {
+        size_t threads = O->threads[t];
+
+        if (selected(O, "cmap")) {
+            cmap_t *C = cmap_new(key_cmp(key));
+            for (size_t i = 0; i < n; i++) cmap_insert(C, key_fill(buf, key, i), cmp_item_new(&value, sizeof(value)));
+            run_workers(O, "cmap_find", p, n, key, threads, C, cmap_reader);
+            cmap_free(C);
+        }
+
+        if (selected(O, "shard_set")) {
+            shard_set_t *S = shard_set_new(64, key_cmp(key), 0);
+            for (size_t i = 0; i < n; i++) shard_set_insert(S, key_fill(buf, key, i));
+            run_workers(O, "shard_set_mix", p, n, key, threads, S, shard_set_mixer);
+            shard_set_free(S);
+        }
+
+        if (p == SEQUENTIAL && selected(O, "mpmc")) {
+            mpmc_queue_t *Q = mpmc_queue_new(4096, key);
+            run_workers(O, "mpmc_queue", p, n, key, threads, Q, mpmc_worker);
+            mpmc_queue_free(Q);
+        }
+
+        if (p == SEQUENTIAL && selected(O, "atomic_stack")) {
+            atomic_stack_t *S = atomic_stack_new();
+            run_workers(O, "atomic_stack", p, n, key, threads, S, atomic_stack_worker);
+            atomic_stack_free(S);
+        }
+
+        if (selected(O, "pool")) bench_pool(O, p, n, key, threads);
+    }
+    free(buf);
+}
+
+// ---
+
+int main(int argc, char **argv) {
+    static const struct group {
+        const char *name;
+        void (*run)(struct options *O, enum pattern p, size_t n, size_t key);
+    } groups[] = {
+        {"set", bench_set}, {"map", bench_map}, {"btree", bench_btree}, {"hashmap", bench_hashmap},
+        {"deque", bench_deque}, {"queue", bench_queue}, {"cmp", bench_cmp},
+    };
+    struct options O;
+
+    parse_options(&O, argc, argv);
+    timer_calibrate();
+
+    for (size_t s = 0; s < O.nsizes; s++)
+        for (size_t k = 0; k < O.nkeys; k++)
+            for (int p = 0; p < PATTERNS; p++) {
+                if (!O.patterns[p] || !O.sizes[s]) continue;
+
+                for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++)
+                    if (selected(&O, groups[g].name)) groups[g].run(&O, (enum pattern)p, O.sizes[s], O.keys[k]);
+                bench_threads(&O, (enum pattern)p, O.sizes[s], O.keys[k]);
+            }
+
+    if (O.json) printf("%s\n]\n", reported ? "" : "[");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+// It's licensed under MIT, btw
+//
+// Microbenchmark for the byte comparators in comparator.c
+// Compares `cmp_sgn_le()`, `cmp_sgn_be()` and `cmp_equal()` against the byte-by-byte loops they replaced
+//
+// Build: make bench (from the repository root), or cc -O2 -I.. cmp_bench.c ../comparator.c -o cmp_bench
+#define _POSIX_C_SOURCE 200809L // clock_gettime()
+#include "comparator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define sgn(a) ( (0 < (a)) - ((a) < 0) )
+
+// The original byte-by-byte implementations, kept as the baseline
+
+static int byte_sgn_le(cmp_item_t a, cmp_item_t b) {
+    if (a.size != b.size) return a.size < b.size ? -1 : 1;
+
+    uint8_t* aptr = (uint8_t*)a.data + a.size - 1;
+    uint8_t* bptr = (uint8_t*)b.data + b.size - 1;
+
+    while (aptr >= (uint8_t*)a.data && bptr >= (uint8_t*)b.data) {
+        if (*aptr != *bptr) return sgn(*aptr - *bptr);
+        aptr--;
+        bptr--;
+    }
+    return 0;
+}
+
+static int byte_sgn_be(cmp_item_t a, cmp_item_t b) {
+    if (a.size != b.size) return a.size < b.size ? -1 : 1;
+
+    uint8_t* aptr = (uint8_t*)a.data;
+    uint8_t* bptr = (uint8_t*)b.data;
+
+    while (aptr != (uint8_t*)a.data + a.size) {
+        if (*aptr != *bptr) return sgn(*aptr - *bptr);
+        aptr++;
+        bptr++;
+    }
+    return 0;
+}
+
+static int byte_equal(cmp_item_t a, cmp_item_t b) {
+    if (a.size != b.size) return 0;
+
+    for (size_t i = 0; i < a.size; i++) {
+        if (((uint8_t*)a.data)[i] != ((uint8_t*)b.data)[i]) return 0;
+    }
+    return 1;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Returns nanoseconds per call, comparing equal items so that every byte is scanned
+__attribute__((noinline))
+static double measure(int (*cmp)(cmp_item_t a, cmp_item_t b), cmp_item_t a, cmp_item_t b, size_t iterations) {
+    volatile int sink = 0;
+    double start = now();
+
+    for (size_t i = 0; i < iterations; i++) sink += cmp(a, b);
+
+    (void)sink;
+    return (now() - start) * 1e9 / iterations;
+}
+
+int main(void) {
+    static const size_t sizes[] = {1, 2, 4, 7, 8, 15, 16, 31, 32, 64, 100, 128, 256, 512, 1024, 2048, 4096};
+    uint8_t *x = (uint8_t*)malloc(4096);
+    uint8_t *y = (uint8_t*)malloc(4096);
+
+    for (size_t i = 0; i < 4096; i++) x[i] = y[i] = (uint8_t)rand();
+
+    printf("%6s | %10s %10s %7s | %10s %10s %7s | %10s %10s %7s\n",
+        "bytes", "le byte", "le new", "speedup", "be byte", "be new", "speedup", "eq byte", "eq new", "speedup");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        cmp_item_t a = cmp_item_new(x, sizes[i]);
+        cmp_item_t b = cmp_item_new(y, sizes[i]);
+        size_t iterations = 200000000 / (sizes[i] + 16);
+
+        double le0 = measure(byte_sgn_le, a, b, iterations), le1 = measure(cmp_sgn_le, a, b, iterations);
+        double be0 = measure(byte_sgn_be, a, b, iterations), be1 = measure(cmp_sgn_be, a, b, iterations);
+        double eq0 = measure(byte_equal, a, b, iterations),  eq1 = measure(cmp_equal, a, b, iterations);
+
+        printf("%6zu | %8.2fns %8.2fns %6.2fx | %8.2fns %8.2fns %6.2fx | %8.2fns %8.2fns %6.2fx\n",
+            sizes[i], le0, le1, le0 / le1, be0, be1, be0 / be1, eq0, eq1, eq0 / eq1);
+    }
+
+    free(x);
+    free(y);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,523 @@
+// It's licensed under MIT, btw
+#include "btree.h"
+
+#include <string.h> // memcpy() and memmove()
+
+// The fewest keys a node other than the root holds
+#define BTREE_MIN (BTREE_ORDER / 2)
+
+// The inner nodes on the way from the root to a leaf, and the child taken at each of them
+struct btree_path {
+    struct btree_inner *nodes[BTREE_MAX_DEPTH];
+    size_t index[BTREE_MAX_DEPTH];
+    size_t depth;
+};
+
+btree_t btree_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    return (btree_t){0, sgn_cmp, 0, 0, 0, stats_new()};
+}
+
+size_t btree_size(btree_t T) {
+    return T.size;
+}
+
+// ---
+// node allocation
+
+static void *__alloc(btree_t *T, size_t size) {
+    STATS_ADD(T->stats, allocs, 1);
+    STATS_ADD(T->stats, bytes, size);
+    return malloc(size);
+}
+
+static void __free(btree_t *T, void *ptr, size_t size) {
+    STATS_ADD(T->stats, frees, 1);
+    STATS_SUB(T->stats, bytes, size);
+    free(ptr);
+}
+
+static struct btree_leaf *__leaf_new(btree_t *T) {
+    struct btree_leaf *leaf = (struct btree_leaf*)__alloc(T, sizeof(struct btree_leaf));
+    leaf->node.length = 0;
+    leaf->node.leaf = 1;
+    leaf->prev = 0;
+    leaf->next = 0;
+    return leaf;
+}
+
+static struct btree_inner *__inner_new(btree_t *T) {
+    struct btree_inner *inner = (struct btree_inner*)__alloc(T, sizeof(struct btree_inner));
+    inner->node.length = 0;
+    inner->node.leaf = 0;
+    return inner;
+}
+
+static inline cmp_item_t __box_item(struct btree_box *box) {
+    return cmp_item_new(box->size <= CMP_INLINE ? box->small : box->data, box->size);
+}
+
+static void __box_set(btree_t *T, struct btree_box *box, cmp_item_t key) {
+    box->size = key.size;
+    if (key.size <= CMP_INLINE) memcpy(box->small, key.data, key.size);
+    else memcpy(box->data = __alloc(T, key.size), key.data, key.size);
+}
+
+static void __box_free(btree_t *T, struct btree_box *box) {
+    if (box->size > CMP_INLINE) __free(T, box->data, box->size);
+}
+
+static void __value_set(btree_t *T, struct btree_leaf *leaf, size_t i, cmp_item_t value) {
+    leaf->values[i] = cmp_item_new(value.size <= CMP_INLINE ? leaf->small_values[i] : __alloc(T, value.size), value.size);
+    memcpy(leaf->values[i].data, value.data, value.size);
+}
+
+static void __value_free(btree_t *T, struct btree_leaf *leaf, size_t i) {
+    if (leaf->values[i].data != leaf->small_values[i]) __free(T, cmp_item(leaf->values[i]), leaf->values[i].size);
+}
+
+// Moves `n` entries of `src` starting at `si` to `dst` starting at `di` (the ranges may overlap)
+// Small values live inside the leaf, so their pointers are redirected to their new slots
+static void __leaf_move(struct btree_leaf *dst, size_t di, struct btree_leaf *src, size_t si, size_t n) {
+    memmove(&dst->node.keys[di], &src->node.keys[si], n * sizeof(struct btree_box));
+    memmove(&dst->values[di], &src->values[si], n * sizeof(cmp_item_t));
+    memmove(&dst->small_values[di], &src->small_values[si], n * CMP_INLINE);
+    for (size_t i = di; i < di + n; i++) {
+        if (dst->values[i].size <= CMP_INLINE) dst->values[i].data = dst->small_values[i];
+    }
+}
+
+// Moves `n` keys of `src` starting at `si` to `dst` starting at `di`, and the children to the right of them
+static void __inner_move(struct btree_inner *dst, size_t di, struct btree_inner *src, size_t si, size_t n) {
+    memmove(&dst->node.keys[di], &src->node.keys[si], n * sizeof(struct btree_box));
+    memmove(&dst->children[di + 1], &src->children[si + 1], n * sizeof(struct btree_node*));
+}
+
+//
+// ---
+
+
+// ---
+// comparator specialization
+//
+// As in map.c, the search is generated for every typed comparator from comparator.h
+// so a tree created with e.g. `cmp_sgn_u64` compares keys inline instead of calling `sgn_cmp` at every key
+
+// Generates __search_<name>(), the number of keys of `node` less than `key` (or not greater than it if `upper`),
+// halving the node without branching on the comparisons,
+// and __descend_<name>() which goes down to the leaf where `key` belongs, recording the way in `path` if it's not zero
+#define BTREE_SEARCH_DEFINE(name, cmp) \
+static inline size_t __search_##name(struct btree_node *node, cmp_item_t key, int upper, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), size_t *compares) { \
+    size_t base = 0, n = node->length, half; \
+    int c; \
+    (void)sgn_cmp; \
+    if (!n) return 0; \
+    while (n > 1) { \
+        half = n / 2; \
+        c = cmp(__box_item(&node->keys[base + half]), key); \
+        base = c < upper ? base + half : base; \
+        n -= half; \
+        ++*compares; \
+    } \
+    c = cmp(__box_item(&node->keys[base]), key); \
+    ++*compares; \
+    return base + (c < upper); \
+} \
+static struct btree_leaf *__descend_##name(btree_t *T, cmp_item_t key, struct btree_path *path, size_t *pos) { \
+    struct btree_node *node = T->root; \
+    int (*sgn_cmp)(cmp_item_t a, cmp_item_t b) = T->sgn_cmp; \
+    size_t hops = 1, compares = 0, depth = 0, i; \
+    while (!node->leaf) { \
+        i = __search_##name(node, key, 1, sgn_cmp, &compares); \
+        if (path) { \
+            path->nodes[depth] = (struct btree_inner*)node; \
+            path->index[depth] = i; \
+        } \
+        depth++; \
+        hops++; \
+        node = ((struct btree_inner*)node)->children[i]; \
+    } \
+    if (path) path->depth = depth; \
+    *pos = __search_##name(node, key, 0, sgn_cmp, &compares); \
+    STATS_ADD(T->stats, finds, 1); \
+    STATS_ADD(T->stats, visited, hops); \
+    STATS_ADD(T->stats, compares, compares); \
+    return (struct btree_leaf*)node; \
+}
+
+BTREE_SEARCH_DEFINE(generic, sgn_cmp)
+#define BTREE_SEARCH_TYPED(name, type) BTREE_SEARCH_DEFINE(name, __cmp_sgn_##name)
+CMP_TYPES(BTREE_SEARCH_TYPED)
+#undef BTREE_SEARCH_TYPED
+
+// Picks the descent specialized for the tree's comparator, the tree must not be empty
+static struct btree_leaf *__descend(btree_t *T, cmp_item_t key, struct btree_path *path, size_t *pos) {
+    #define BTREE_DISPATCH(name, type) if (T->sgn_cmp == cmp_sgn_##name) return __descend_##name(T, key, path, pos);
+    CMP_TYPES(BTREE_DISPATCH)
+    #undef BTREE_DISPATCH
+    return __descend_generic(T, key, path, pos);
+}
+
+// Is the key at `pos` of `leaf` equal to `key`?
+static int __found(btree_t *T, struct btree_leaf *leaf, size_t pos, cmp_item_t key) {
+    if (pos >= leaf->node.length) return 0;
+    STATS_ADD(T->stats, compares, 1);
+    return !T->sgn_cmp(__box_item(&leaf->node.keys[pos]), key);
+}
+
+//
+// ---
+
+// ---
+// btree_find
+
+cmp_item_t *btree_find(btree_t T, cmp_item_t key) {
+    struct btree_leaf *leaf;
+    size_t pos;
+
+    if (!T.root) return 0;
+    leaf = __descend(&T, key, 0, &pos);
+    return __found(&T, leaf, pos, key) ? &leaf->values[pos] : 0;
+}
+
+//
+// ---
+
+// ---
+// btree_insert
+//
+// A full node is split in two halves, the first key of the right half (or the middle key of an inner node) goes up.
+// Splits climb the recorded path, and a split root makes the tree one level taller.
+
+// Links `right` after the child `path->index[depth - 1]` of the inner node at `depth - 1`, separated by `sep`
+static void __insert_inner(btree_t *T, struct btree_path *path, size_t depth, struct btree_box sep, struct btree_node *right) {
+    struct btree_box keys[BTREE_ORDER + 1];
+    struct btree_node *children[BTREE_ORDER + 2];
+    struct btree_inner *node, *sibling;
+    size_t i, mid = (BTREE_ORDER + 1) / 2;
+
+    if (!depth) {
+        node = __inner_new(T);
+        node->node.keys[0] = sep;
+        node->children[0] = T->root;
+        node->children[1] = right;
+        node->node.length = 1;
+        T->root = &node->node;
+        return;
+    }
+
+    node = path->nodes[depth - 1];
+    i = path->index[depth - 1];
+    if (node->node.length < BTREE_ORDER) {
+        __inner_move(node, i + 1, node, i, node->node.length - i);
+        node->node.keys[i] = sep;
+        node->children[i + 1] = right;
+        node->node.length++;
+        return;
+    }
+
+    // Lay the overflowing node out in order, then share it between the two halves
+    memcpy(keys, node->node.keys, i * sizeof(struct btree_box));
+    memcpy(keys + i + 1, node->node.keys + i, (BTREE_ORDER - i) * sizeof(struct btree_box));
+    keys[i] = sep;
+    memcpy(children, node->children, (i + 1) * sizeof(struct btree_node*));
+    memcpy(children + i + 2, node->children + i + 1, (BTREE_ORDER - i) * sizeof(struct btree_node*));
+    children[i + 1] = right;
+
+    sibling = __inner_new(T);
+    memcpy(node->node.keys, keys, mid * sizeof(struct btree_box));
+    memcpy(node->children, children, (mid + 1) * sizeof(struct btree_node*));
+    node->node.length = mid;
+    memcpy(sibling->node.keys, keys + mid + 1, (BTREE_ORDER - mid) * sizeof(struct btree_box));
+    memcpy(sibling->children, children + mid + 1, (BTREE_ORDER - mid + 1) * sizeof(struct btree_node*));
+    sibling->node.length = BTREE_ORDER - mid;
+
+    __insert_inner(T, path, depth - 1, keys[mid], &sibling->node);
+}
+
+// Moves the upper half of a full leaf to a new one, returning the leaf which `pos` falls in and adjusting `pos`
+static struct btree_leaf *__split_leaf(btree_t *T, struct btree_path *path, struct btree_leaf *leaf, size_t *pos) {
+    struct btree_leaf *right = __leaf_new(T);
+    struct btree_box sep;
+    size_t half = BTREE_ORDER / 2;
+
+    __leaf_move(right, 0, leaf, half, BTREE_ORDER - half);
+    right->node.length = BTREE_ORDER - half;
+    leaf->node.length = half;
+
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) leaf->next->prev = right;
+    else T->last = right;
+    leaf->next = right;
+
+    // Separators own their data, the key they were copied from may be deleted before them
+    __box_set(T, &sep, __box_item(&right->node.keys[0]));
+    __insert_inner(T, path, path->depth, sep, &right->node);
+
+    // A key going right in front of the separator would be less than it, so it stays on the left
+    if (*pos <= half) return leaf;
+    *pos -= half;
+    return right;
+}
+
+void btree_insert(btree_t *T, cmp_item_t key, cmp_item_t value) {
+    struct btree_path path;
+    struct btree_leaf *leaf;
+    size_t pos;
+
+    if (!T->root) {
+        leaf = __leaf_new(T);
+        T->root = &leaf->node;
+        T->first = leaf;
+        T->last = leaf;
+    }
+
+    leaf = __descend(T, key, &path, &pos);
+    if (__found(T, leaf, pos, key)) return;
+
+    if (leaf->node.length == BTREE_ORDER) leaf = __split_leaf(T, &path, leaf, &pos);
+
+    __leaf_move(leaf, pos + 1, leaf, pos, leaf->node.length - pos);
+    __box_set(T, &leaf->node.keys[pos], key);
+    __value_set(T, leaf, pos, value);
+    leaf->node.length++;
+    T->size++;
+}
+
+//
+// ---
+
+// ---
+// btree_delete
+//
+// A node which drops below `BTREE_MIN` keys borrows one from a sibling through their parent,
+// or is merged with it if the sibling has none to spare, which may leave the parent short in turn.
+// An inner root left without keys is replaced by its only child.
+
+static void __rebalance_inner(btree_t *T, struct btree_path *path, size_t depth) {
+    struct btree_inner *node = path->nodes[depth], *parent, *left, *right;
+    size_t i, s;
+
+    if (!depth) {
+        if (!node->node.length) {
+            T->root = node->children[0];
+            __free(T, node, sizeof(struct btree_inner));
+        }
+        return;
+    }
+    if (node->node.length >= BTREE_MIN) return;
+
+    parent = path->nodes[depth - 1];
+    i = path->index[depth - 1];
+    left = i ? (struct btree_inner*)parent->children[i - 1] : 0;
+    right = i < parent->node.length ? (struct btree_inner*)parent->children[i + 1] : 0;
+
+    if (left && left->node.length > BTREE_MIN) {
+        // The separator comes down in front of the node, the left sibling's last key replaces it
+        __inner_move(node, 1, node, 0, node->node.length);
+        node->children[1] = node->children[0];
+        node->node.keys[0] = parent->node.keys[i - 1];
+        node->children[0] = left->children[left->node.length];
+        parent->node.keys[i - 1] = left->node.keys[left->node.length - 1];
+        left->node.length--;
+        node->node.length++;
+        return;
+    }
+    if (right && right->node.length > BTREE_MIN) {
+        node->node.keys[node->node.length] = parent->node.keys[i];
+        node->children[node->node.length + 1] = right->children[0];
+        parent->node.keys[i] = right->node.keys[0];
+        right->children[0] = right->children[1];
+        __inner_move(right, 0, right, 1, right->node.length - 1);
+        right->node.length--;
+        node->node.length++;
+        return;
+    }
+
+    // Merge with a sibling, pulling their separator down between them
+    if (left) {
+        right = node;
+        s = i - 1;
+    } else {
+        left = node;
+        s = i;
+    }
+    left->node.keys[left->node.length] = parent->node.keys[s];
+    left->children[left->node.length + 1] = right->children[0];
+    __inner_move(left, left->node.length + 1, right, 0, right->node.length);
+    left->node.length += right->node.length + 1;
+    __free(T, right, sizeof(struct btree_inner));
+
+    __inner_move(parent, s, parent, s + 1, parent->node.length - s - 1);
+    parent->node.length--;
+    __rebalance_inner(T, path, depth - 1);
+}
+
+static void __rebalance_leaf(btree_t *T, struct btree_path *path, struct btree_leaf *leaf) {
+    struct btree_inner *parent;
+    struct btree_leaf *left, *right;
+    size_t i, s;
+
+    if (!path->depth) {
+        if (!leaf->node.length) {
+            __free(T, leaf, sizeof(struct btree_leaf));
+            T->root = 0;
+            T->first = 0;
+            T->last = 0;
+        }
+        return;
+    }
+    if (leaf->node.length >= BTREE_MIN) return;
+
+    parent = path->nodes[path->depth - 1];
+    i = path->index[path->depth - 1];
+    left = i ? (struct btree_leaf*)parent->children[i - 1] : 0;
+    right = i < parent->node.length ? (struct btree_leaf*)parent->children[i + 1] : 0;
+
+    if (left && left->node.length > BTREE_MIN) {
+        __leaf_move(leaf, 1, leaf, 0, leaf->node.length);
+        __leaf_move(leaf, 0, left, left->node.length - 1, 1);
+        left->node.length--;
+        leaf->node.length++;
+        __box_free(T, &parent->node.keys[i - 1]);
+        __box_set(T, &parent->node.keys[i - 1], __box_item(&leaf->node.keys[0]));
+        return;
+    }
+    if (right && right->node.length > BTREE_MIN) {
+        __leaf_move(leaf, leaf->node.length, right, 0, 1);
+        __leaf_move(right, 0, right, 1, right->node.length - 1);
+        right->node.length--;
+        leaf->node.length++;
+        __box_free(T, &parent->node.keys[i]);
+        __box_set(T, &parent->node.keys[i], __box_item(&right->node.keys[0]));
+        return;
+    }
+
+    // Merge with a sibling, their separator is no longer needed
+    if (left) {
+        right = leaf;
+        s = i - 1;
+    } else {
+        left = leaf;
+        s = i;
+    }
+    __leaf_move(left, left->node.length, right, 0, right->node.length);
+    left->node.length += right->node.length;
+    left->next = right->next;
+    if (right->next) right->next->prev = left;
+    else T->last = left;
+    __free(T, right, sizeof(struct btree_leaf));
+
+    __box_free(T, &parent->node.keys[s]);
+    __inner_move(parent, s, parent, s + 1, parent->node.length - s - 1);
+    parent->node.length--;
+    __rebalance_inner(T, path, path->depth - 1);
+}
+
+void btree_delete(btree_t *T, cmp_item_t key) {
+    struct btree_path path;
+    struct btree_leaf *leaf;
+    size_t pos;
+
+    if (!T->root) return;
+
+    leaf = __descend(T, key, &path, &pos);
+    if (!__found(T, leaf, pos, key)) return;
+
+    __box_free(T, &leaf->node.keys[pos]);
+    __value_free(T, leaf, pos);
+    __leaf_move(leaf, pos, leaf, pos + 1, leaf->node.length - pos - 1);
+    leaf->node.length--;
+    T->size--;
+
+    __rebalance_leaf(T, &path, leaf);
+}
+
+//
+// ---
+
+// ---
+// iteration
+//
+// Only the root may be an empty leaf, and it's freed as soon as it is, so every chained leaf has keys
+
+btree_iter_t btree_first(btree_t T) {
+    return (btree_iter_t){T.first, 0};
+}
+
+btree_iter_t btree_last(btree_t T) {
+    return (btree_iter_t){T.last, T.last ? T.last->node.length - 1 : 0};
+}
+
+btree_iter_t btree_next(btree_iter_t it) {
+    if (++it.pos < it.leaf->node.length) return it;
+    return (btree_iter_t){it.leaf->next, 0};
+}
+
+btree_iter_t btree_prev(btree_iter_t it) {
+    if (it.pos) return (btree_iter_t){it.leaf, it.pos - 1};
+    it.leaf = it.leaf->prev;
+    return (btree_iter_t){it.leaf, it.leaf ? it.leaf->node.length - 1 : 0};
+}
+
+btree_iter_t btree_lower_bound(btree_t T, cmp_item_t key) {
+    struct btree_leaf *leaf;
+    size_t pos;
+
+    if (!T.root) return (btree_iter_t){0, 0};
+    leaf = __descend(&T, key, 0, &pos);
+    if (pos < leaf->node.length) return (btree_iter_t){leaf, pos};
+    return (btree_iter_t){leaf->next, 0};
+}
+
+btree_iter_t btree_upper_bound(btree_t T, cmp_item_t key) {
+    btree_iter_t it = btree_lower_bound(T, key);
+    if (it.leaf && __found(&T, it.leaf, it.pos, key)) return btree_next(it);
+    return it;
+}
+
+cmp_item_t btree_key(btree_iter_t it) {
+    return __box_item(&it.leaf->node.keys[it.pos]);
+}
+
+cmp_item_t *btree_value(btree_iter_t it) {
+    return &it.leaf->values[it.pos];
+}
+
+//
+// ---
+
+// ---
+// btree_free
+
+static void __btree_free(btree_t *T, struct btree_node *node) {
+    struct btree_leaf *leaf = (struct btree_leaf*)node;
+    struct btree_inner *inner = (struct btree_inner*)node;
+
+    for (size_t i = 0; i < node->length; i++) __box_free(T, &node->keys[i]);
+    if (node->leaf) {
+        for (size_t i = 0; i < node->length; i++) __value_free(T, leaf, i);
+        __free(T, leaf, sizeof(struct btree_leaf));
+        return;
+    }
+    for (size_t i = 0; i <= node->length; i++) __btree_free(T, inner->children[i]);
+    __free(T, inner, sizeof(struct btree_inner));
+}
+
+void btree_free(btree_t *T) {
+    if (T->root) __btree_free(T, T->root);
+
+    stats_free(T->stats);
+    T->root = 0;
+    T->size = 0;
+    T->first = 0;
+    T->last = 0;
+    T->stats = 0;
+}
+
+struct ctypes_stats btree_stats(btree_t T) {
+    return stats_read(T.stats);
+}
+
+//
+// ---
\ No newline at end of file
@@ -0,0 +1,122 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_BTREE_H
+#define _CTYPES_BTREE_H
+
+#include "comparator.h"
+#include "stats.h"
+
+#include <stdlib.h> // size_t
+#include <stdint.h> // uint8_t and uint32_t
+
+// The most keys a node holds, nodes are split when they overflow and merged once they drop below half of it
+// An inner node of this order spans about 1 KiB, so a lookup touches a handful of nodes instead of a path of ~log2(n) ones
+#define BTREE_ORDER 32
+
+// The deepest tree supported, enough for (BTREE_ORDER / 2 + 1) ^ (BTREE_MAX_DEPTH - 1) keys
+#define BTREE_MAX_DEPTH 16
+
+// A key stored by value, its data is kept inside the box when it fits
+struct btree_box {
+    size_t size;
+    union {
+        uint8_t small[CMP_INLINE];
+        void *data;
+    };
+};
+
+// The part shared by inner nodes and leaves, keys are contiguous so a node is searched without leaving it
+struct btree_node {
+    uint32_t length; // The number of keys
+    uint32_t leaf;
+    struct btree_box keys[BTREE_ORDER];
+};
+
+// `keys[i]` is not greater than any key under `children[i + 1]` and greater than every key under `children[i]`
+struct btree_inner {
+    struct btree_node node;
+    struct btree_node *children[BTREE_ORDER + 1];
+};
+
+struct btree_leaf {
+    struct btree_node node;
+    struct btree_leaf *prev; // The leaves are chained in key order
+    struct btree_leaf *next;
+    cmp_item_t values[BTREE_ORDER];
+    uint8_t small_values[BTREE_ORDER][CMP_INLINE]; // The values' data when it fits
+};
+
+struct btree {
+    struct btree_node *root;
+    int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
+    size_t size;
+    struct btree_leaf *first; // The ends of the leaf chain
+    struct btree_leaf *last;
+    struct ctypes_counters *stats; // Hot-path counters, zero unless built with CTYPES_STATS (see stats.h)
+};
+
+typedef struct btree btree_t;
+
+// A position in key order, `leaf` is zero past either end
+struct btree_iter {
+    struct btree_leaf *leaf;
+    size_t pos;
+};
+
+typedef struct btree_iter btree_iter_t;
+
+// Returns a properly initialised `btree_t`. Takes signum comparator as an argument
+extern btree_t btree_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// Returns the number of elements
+extern size_t btree_size(btree_t T);
+
+// Inserts an element with a specified key in the tree (nothing happens if the key is present)
+extern void btree_insert(btree_t *T, cmp_item_t key, cmp_item_t value);
+
+// Deletes an element with a specified key from the tree
+extern void btree_delete(btree_t *T, cmp_item_t key);
+
+// Accesses an element with a specified key in the tree (0 if the key is missing)
+// Unlike `map_find()` the pointer is only valid until the next insert or delete
+extern cmp_item_t *btree_find(btree_t T, cmp_item_t key);
+
+// ---
+// Iteration
+//
+// Positions are walked along the leaf chain, without allocations.
+// A position is only valid until the next insert or delete.
+
+// Returns the position of the smallest key (past the end if the tree is empty)
+extern btree_iter_t btree_first(btree_t T);
+
+// Returns the position of the greatest key (past the end if the tree is empty)
+extern btree_iter_t btree_last(btree_t T);
+
+// Returns the position following `it` in key order
+extern btree_iter_t btree_next(btree_iter_t it);
+
+// Returns the position preceding `it` in key order
+extern btree_iter_t btree_prev(btree_iter_t it);
+
+// Returns the position of the first key not less than `key`
+extern btree_iter_t btree_lower_bound(btree_t T, cmp_item_t key);
+
+// Returns the position of the first key greater than `key`
+extern btree_iter_t btree_upper_bound(btree_t T, cmp_item_t key);
+
+// Accesses the key at `it`
+extern cmp_item_t btree_key(btree_iter_t it);
+
+// Accesses the value at `it`
+extern cmp_item_t *btree_value(btree_iter_t it);
+
+//
+// ---
+
+// Returns the hot-path counters of `T` (all zero unless built with CTYPES_STATS)
+extern struct ctypes_stats btree_stats(btree_t T);
+
+// Removes all elements and releases the memory held by the tree
+extern void btree_free(btree_t *T);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+// It's licensed under MIT, btw
+#include "cmap.h"
+#include "epoch.h"
+
+#include <stddef.h> // size_t
+#include <string.h> // memcpy()
+#include <stdlib.h> // aligned_alloc() and free()
+#include <sched.h>  // sched_yield()
+
+// Failed attempts after which a reader stops spinning and yields to the writer
+#define CMAP_SPIN 64
+
+// ---
+// writer helpers
+//
+// The sequence is odd while the tree is being changed.
+// Writers look the key up under the lock first, so a no-op write doesn't make readers retry.
+
+static void __write_begin(cmap_t *C) {
+    atomic_store_explicit(&C->seq, atomic_load_explicit(&C->seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void __write_end(cmap_t *C) {
+    atomic_store_explicit(&C->seq, atomic_load_explicit(&C->seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+// The map has no slab, so its nodes and payloads come from `malloc()`
+static void __node_release(void *p) {
+    struct map_node *node = (struct map_node*)p;
+
+    if (node->value.data != node->small_value) free(node->value.data);
+    if (node->key.data != node->small_key) free(node->key.data);
+    free(node);
+}
+
+// ---
+
+// ---
+// reader helpers
+//
+// A reader may observe the tree halfway through a rotation, so every pointer is loaded atomically,
+// the descent gives up after `CMAP_MAX_HOPS` nodes, and the result only counts if `seq` didn't move.
+
+static struct map_node *__load(struct map_node **p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static struct map_node *__descend(cmap_t *C, cmp_item_t key) {
+    struct map_node *x = __load(&C->map.root);
+    int c;
+
+    for (size_t hops = 0; x && hops < CMAP_MAX_HOPS; hops++) {
+        c = C->map.sgn_cmp(x->key, key);
+        if (c < 0) x = __load(&x->right);
+        else if (c > 0) x = __load(&x->left);
+        else return x;
+    }
+    return 0;
+}
+
+// Returns the node holding `key` (or 0) as of some moment during the call, and copies its value out if asked to
+static int __read(cmap_t *C, cmp_item_t key, void *value, size_t *size) {
+    struct map_node *node;
+    size_t begin, found = 0, capacity = size ? *size : 0, real = 0;
+
+    epoch_enter();
+    for (size_t attempt = 1;; attempt++) {
+        begin = atomic_load_explicit(&C->seq, memory_order_acquire);
+
+        if (!(begin & 1)) {
+            node = __descend(C, key);
+            found = node != 0;
+
+            // Nodes are never modified in place, so the value is stable once the node is reached
+            if (node && value) {
+                // `*size` is only written once the read is known to be consistent, a retry copies with the same limit
+                real = node->value.size;
+                memcpy(value, node->value.data, real < capacity ? real : capacity);
+            }
+
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&C->seq, memory_order_relaxed) == begin) break;
+        }
+
+        if (attempt % CMAP_SPIN == 0) sched_yield();
+    }
+    epoch_exit();
+
+    if (found && value) *size = real;
+
+    return found;
+}
+
+// ---
+
+cmap_t *cmap_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    cmap_t *C = (cmap_t*)aligned_alloc(CMAP_CACHE_LINE, (sizeof(cmap_t) + CMAP_CACHE_LINE - 1) / CMAP_CACHE_LINE * CMAP_CACHE_LINE);
+
+    atomic_init(&C->seq, 0);
+    pthread_mutex_init(&C->lock, 0);
+    C->map = map_new(sgn_cmp);
+    return C;
+}
+
+size_t cmap_size(cmap_t *C) {
+    return __atomic_load_n(&C->map.size, __ATOMIC_RELAXED);
+}
+
+int cmap_find(cmap_t *C, cmp_item_t key, void *value, size_t *size) {
+    return __read(C, key, value, size);
+}
+
+int cmap_count(cmap_t *C, cmp_item_t key) {
+    return __read(C, key, 0, 0);
+}
+
+void cmap_insert(cmap_t *C, cmp_item_t key, cmp_item_t value) {
+    pthread_mutex_lock(&C->lock);
+    if (!map_find(C->map, key)) {
+        __write_begin(C);
+        map_insert(&C->map, key, value);
+        __write_end(C);
+    }
+    pthread_mutex_unlock(&C->lock);
+}
+
+void cmap_delete(cmap_t *C, cmp_item_t key) {
+    struct map_node *node = 0;
+
+    pthread_mutex_lock(&C->lock);
+    if (map_find(C->map, key)) {
+        __write_begin(C);
+        node = map_unlink(&C->map, key);
+        __write_end(C);
+    }
+    pthread_mutex_unlock(&C->lock);
+
+    if (node) epoch_retire(node, __node_release);
+}
+
+void cmap_free(cmap_t *C) {
+    map_free(&C->map);
+    pthread_mutex_destroy(&C->lock);
+    free(C);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_CMAP_H
+#define _CTYPES_CMAP_H
+
+#include <stddef.h>    // size_t
+#include <stdatomic.h> // atomic_size_t
+#include <pthread.h>   // pthread_mutex_t
+
+#include "map.h"
+
+// The size of a cache line, the sequence counter is kept away from the writer's lock
+#define CMAP_CACHE_LINE 64
+
+// The longest descent a reader attempts before assuming it ran into a rotation, twice the height of any red-black tree
+#define CMAP_MAX_HOPS 128
+
+// A `map_t` which can be read by any number of threads without locks while one writer at a time changes it
+// Obtained with `cmap_new()`
+//
+// Writers serialize on `lock` and make `seq` odd while they restructure the tree.
+// Readers descend optimistically and retry if `seq` changed under them,
+// and deleted nodes are freed through `epoch.h` once no reader can be looking at them.
+struct cmap {
+    _Alignas(CMAP_CACHE_LINE) atomic_size_t seq;
+
+    _Alignas(CMAP_CACHE_LINE) pthread_mutex_t lock;
+    map_t map;
+};
+
+typedef struct cmap cmap_t;
+
+
+// Returns an empty concurrent map ordered by `sgn_cmp`
+extern cmap_t *cmap_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// Returns the number of elements (only a snapshot under concurrent use)
+extern size_t cmap_size(cmap_t *C);
+
+// Copies the value of `key` into `value`, which has room for `*size` bytes, and stores its real size in `*size`
+// (Bigger values are truncated)
+// Never takes a lock, returns 0 if the key is missing
+extern int cmap_find(cmap_t *C, cmp_item_t key, void *value, size_t *size);
+
+// Returns a boolean value indicating whether or not `key` is present, without taking a lock
+extern int cmap_count(cmap_t *C, cmp_item_t key);
+
+// Inserts an element with a specified key, like `map_insert()` (keeps the existing value)
+extern void cmap_insert(cmap_t *C, cmp_item_t key, cmp_item_t value);
+
+// Deletes an element with a specified key, like `map_delete()`
+extern void cmap_delete(cmap_t *C, cmp_item_t key);
+
+// Releases the map and its elements
+// No other thread may be using the map
+extern void cmap_free(cmap_t *C);
+
+#endif
\ No newline at end of file
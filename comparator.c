@@ -1,9 +1,15 @@
 // It's licensed under MIT, btw
 #include "comparator.h"
-#include <string.h> // memcpy()
+#include <string.h> // memcpy() and memcmp()
 #include <stdio.h>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CMP_X86_SIMD
+#include <immintrin.h> // SSE2 and AVX2 intrinsics
+#endif
+
 #define sgn(a) ( (0 < (a)) - ((a) < 0) )
+#define sgn_order(a, b) ( ((a) > (b)) - ((a) < (b)) )
 
 void* cmp_item(cmp_item_t x) {
     return x.data;
@@ -22,23 +28,233 @@ cmp_item_t cmp_item_copy(void* data, size_t size) {
 }
 
 // ---
-// Boolean compare (byte-by-byte)
+// Hashing
+//
+// Mixes 8 bytes at a time with multiply-rotate rounds and finishes with an avalanche,
+// so both the low and the high bits of the result are usable
+
+#define CMP_HASH_P1 0x9E3779B185EBCA87ull
+#define CMP_HASH_P2 0xC2B2AE3D27D4EB4Full
+#define CMP_HASH_P3 0x165667B19E3779F9ull
+
+static uint64_t __rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t __hash_round(uint64_t h, uint64_t w) {
+    h ^= __rotl(w * CMP_HASH_P2, 31) * CMP_HASH_P1;
+    return __rotl(h, 27) * CMP_HASH_P1 + CMP_HASH_P3;
+}
+
+uint64_t cmp_hash(cmp_item_t x) {
+    const uint8_t *p = (const uint8_t*)x.data;
+    size_t n = x.size;
+    uint64_t h = CMP_HASH_P3 ^ (n * CMP_HASH_P2);
+    uint64_t w;
+
+    while (n >= sizeof(uint64_t)) {
+        memcpy(&w, p, sizeof(uint64_t));
+        h = __hash_round(h, w);
+        p += sizeof(uint64_t);
+        n -= sizeof(uint64_t);
+    }
+    if (n) {
+        w = 0;
+        memcpy(&w, p, n);
+        h = __hash_round(h, w);
+    }
+
+    h ^= h >> 33;
+    h *= CMP_HASH_P2;
+    h ^= h >> 29;
+    h *= CMP_HASH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+//
+// ---
+
+// ---
+// Byte scanning kernels
+//
+// Little-endian items are compared starting from their last (most significant) byte,
+// so the kernels below look for the highest differing byte and return its index + 1 (0 if equal).
+// Big-endian items are compared in memory order, which is exactly what `memcmp()` does.
+
+// Word-at-a-time scan, used for short items and on platforms without SIMD
+static size_t __diff_le_word(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint64_t wa, wb, x;
+
+    while (n >= sizeof(uint64_t)) {
+        n -= sizeof(uint64_t);
+        memcpy(&wa, a + n, sizeof(uint64_t));
+        memcpy(&wb, b + n, sizeof(uint64_t));
+
+        if (wa != wb) {
+            x = wa ^ wb;
+            #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                return n + (63 - __builtin_clzll(x)) / 8 + 1;
+            #else
+                return n + 7 - __builtin_ctzll(x) / 8 + 1;
+            #endif
+        }
+    }
+
+    if (n >= sizeof(uint32_t)) {
+        uint32_t ha, hb;
+
+        memcpy(&ha, a + n - sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&hb, b + n - sizeof(uint32_t), sizeof(uint32_t));
+        if (ha == hb) n -= sizeof(uint32_t);
+    }
+
+    while (n--) {
+        if (a[n] != b[n]) return n + 1;
+    }
+    return 0;
+}
+
+#ifdef CMP_X86_SIMD
+
+static size_t __diff_le_sse2(const uint8_t *a, const uint8_t *b, size_t n) {
+    unsigned mask;
+
+    while (n >= 16) {
+        n -= 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i*)(a + n)),
+            _mm_loadu_si128((const __m128i*)(b + n))
+        )) ^ 0xFFFF;
+
+        if (mask) return n + (31 - __builtin_clz(mask)) + 1;
+    }
+    return __diff_le_word(a, b, n);
+}
+
+__attribute__((target("avx2")))
+static size_t __diff_le_avx2(const uint8_t *a, const uint8_t *b, size_t n) {
+    unsigned mask;
+
+    while (n >= 32) {
+        n -= 32;
+        mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)(a + n)),
+            _mm256_loadu_si256((const __m256i*)(b + n))
+        ));
+
+        if (mask) return n + (31 - __builtin_clz(mask)) + 1;
+    }
+    return __diff_le_sse2(a, b, n);
+}
+
+// SSE2 is always available on x86-64, AVX2 is picked at load time if the CPU supports it
+static size_t (*__diff_le_simd)(const uint8_t *a, const uint8_t *b, size_t n) = __diff_le_sse2;
+
+__attribute__((constructor))
+static void __diff_le_resolve(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) __diff_le_simd = __diff_le_avx2;
+}
+
+#endif
+
+// Returns the index + 1 of the most significant differing byte of two little-endian items (0 if equal)
+static size_t __diff_le(const uint8_t *a, const uint8_t *b, size_t n) {
+    #ifdef CMP_X86_SIMD
+        if (n >= 16) return __diff_le_simd(a, b, n);
+    #endif
+    return __diff_le_word(a, b, n);
+}
+
+//
+// ---
+
+// ---
+// Sorting
+//
+// Bottom-up merge sort: short runs are insertion-sorted in place, then merged back and forth with a buffer
+
+#define CMP_SORT_RUN 16
+
+static cmp_item_t __key(const uint8_t *record) {
+    cmp_item_t key;
+
+    memcpy(&key, record, sizeof(cmp_item_t));
+    return key;
+}
+
+static void __insertion_sort(uint8_t *base, size_t n, size_t stride, uint8_t *tmp, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    size_t i, j;
+
+    for (i = 1; i < n; i++) {
+        for (j = i; j > 0 && sgn_cmp(__key(base + (j - 1) * stride), __key(base + i * stride)) > 0; j--) ;
+        if (j == i) continue;
+
+        memcpy(tmp, base + i * stride, stride);
+        memmove(base + (j + 1) * stride, base + j * stride, (i - j) * stride);
+        memcpy(base + j * stride, tmp, stride);
+    }
+}
+
+static void __merge(const uint8_t *a, size_t na, const uint8_t *b, size_t nb, uint8_t *out, size_t stride, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    while (na && nb) {
+        // Take from `a` on ties to keep the sort stable
+        if (sgn_cmp(__key(b), __key(a)) < 0) {
+            memcpy(out, b, stride);
+            b += stride;
+            nb--;
+        } else {
+            memcpy(out, a, stride);
+            a += stride;
+            na--;
+        }
+        out += stride;
+    }
+    memcpy(out, a, na * stride);
+    memcpy(out + na * stride, b, nb * stride);
+}
+
+void cmp_sort(void *base, size_t n, size_t stride, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    uint8_t *src = (uint8_t*)base;
+    uint8_t *buf, *dst, *swap;
+    size_t i, width, mid, end;
+
+    if (n < 2) return;
+
+    buf = (uint8_t*)malloc((n > CMP_SORT_RUN ? n : 1) * stride);
+    for (i = 0; i < n; i += CMP_SORT_RUN) {
+        __insertion_sort(src + i * stride, n - i < CMP_SORT_RUN ? n - i : CMP_SORT_RUN, stride, buf, sgn_cmp);
+    }
+
+    dst = buf;
+    for (width = CMP_SORT_RUN; width < n; width *= 2) {
+        for (i = 0; i < n; i += 2 * width) {
+            mid = i + width < n ? i + width : n;
+            end = i + 2 * width < n ? i + 2 * width : n;
+            __merge(src + i * stride, mid - i, src + mid * stride, end - mid, dst + i * stride, stride, sgn_cmp);
+        }
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != (uint8_t*)base) memcpy(base, src, n * stride);
+    free(buf);
+}
+
+//
+// ---
+
+// ---
+// Boolean compare
 
 // Platform-independent
 
 // Is `a` equal to `b`?
 int cmp_equal(cmp_item_t a, cmp_item_t b) {
     if (a.size != b.size) return 0;
-
-    uint8_t* aptr = (uint8_t*)a.data + a.size - 1;
-    uint8_t* bptr = (uint8_t*)b.data + b.size - 1;
-
-    while (aptr >= (uint8_t*)a.data && bptr >= (uint8_t*)b.data) {
-        if (*aptr != *bptr) return 0;
-        aptr--;
-        bptr--;
-    }
-    return 1;
+    return !memcmp(a.data, b.data, a.size);
 }
 
 
@@ -49,32 +265,18 @@ int cmp_equal(cmp_item_t a, cmp_item_t b) {
 int cmp_smaller_le(cmp_item_t a, cmp_item_t b) {
     if (a.size != b.size) return (a.size <= b.size);
 
-
-    uint8_t* aptr = (uint8_t*)a.data + a.size - 1;
-    uint8_t* bptr = (uint8_t*)b.data + b.size - 1;
-
-    while (aptr >= (uint8_t*)a.data && bptr >= (uint8_t*)b.data) {
-        if (*aptr != *bptr) return *aptr <= *bptr;
-        aptr--;
-        bptr--;
-    }
-    return 1; // if a == b;
+    size_t d = __diff_le((uint8_t*)a.data, (uint8_t*)b.data, a.size);
+    if (!d) return 1; // if a == b;
+    return ((uint8_t*)a.data)[d - 1] <= ((uint8_t*)b.data)[d - 1];
 }
 
 // Is `a` greater than `b`? (In little-endlian)
 int cmp_greater_le(cmp_item_t a, cmp_item_t b) {
     if (a.size != b.size) return (a.size > b.size);
 
-
-    uint8_t* aptr = (uint8_t*)a.data + a.size - 1;
-    uint8_t* bptr = (uint8_t*)b.data + b.size - 1;
-
-    while (aptr >= (uint8_t*)a.data && bptr >= (uint8_t*)b.data) {
-        if (*aptr != *bptr) return *aptr > *bptr;
-        aptr--;
-        bptr--;
-    }
-    return 1; // if a == b;
+    size_t d = __diff_le((uint8_t*)a.data, (uint8_t*)b.data, a.size);
+    if (!d) return 0; // if a == b;
+    return ((uint8_t*)a.data)[d - 1] > ((uint8_t*)b.data)[d - 1];
 }
 
 
@@ -84,33 +286,13 @@ int cmp_greater_le(cmp_item_t a, cmp_item_t b) {
 // Is `a` less or equal to `b`? (In big-endian)
 int cmp_smaller_be(cmp_item_t a, cmp_item_t b) {
     if (a.size != b.size) return (a.size <= b.size);
-
-    
-    uint8_t* aptr = (uint8_t*)a.data;
-    uint8_t* bptr = (uint8_t*)b.data;
-
-    while (aptr != (uint8_t*)a.data + a.size && bptr != (uint8_t*)b.data + b.size) {
-        if (*aptr != *bptr) return *aptr <= *bptr;
-        aptr++;
-        bptr++;
-    }
-    return 1; // if a == b;
+    return memcmp(a.data, b.data, a.size) <= 0;
 }
 
 // Is `a` greater than `b`? (In big-endian)
 int cmp_greater_be(cmp_item_t a, cmp_item_t b) {
     if (a.size != b.size) return (a.size > b.size);
-
-    
-    uint8_t* aptr = (uint8_t*)a.data;
-    uint8_t* bptr = (uint8_t*)b.data;
-
-    while (aptr != (uint8_t*)a.data + a.size && bptr != (uint8_t*)b.data + b.size) {
-        if (*aptr != *bptr) return *aptr > *bptr;
-        aptr++;
-        bptr++;
-    }
-    return 1; // if a == b;
+    return memcmp(a.data, b.data, a.size) > 0;
 }
 
 // Platform-dependent
@@ -139,7 +321,7 @@ int cmp_bigger(cmp_item_t a, cmp_item_t b) {
 // ---
 
 // ---
-// Signum-compare (byte-by-byte)
+// Signum-compare
 
 
 // What is the result of sgn(`a.size` - `b.size`) ?
@@ -147,7 +329,7 @@ int cmp_bigger(cmp_item_t a, cmp_item_t b) {
 // 0 if a.size == b.size
 // 1 if a.size > b.size
 int cmp_sgn_size(cmp_item_t a, cmp_item_t b) {
-    return sgn(a.size - b.size);
+    return sgn_order(a.size, b.size);
 }
 
 // What is the result of sgn(`a` - `b`) ?
@@ -156,18 +338,11 @@ int cmp_sgn_size(cmp_item_t a, cmp_item_t b) {
 // 1 if a > b
 // Compare in little-endian
 int cmp_sgn_le(cmp_item_t a, cmp_item_t b) {
-    if (a.size != b.size) return sgn(a.size - b.size);
+    if (a.size != b.size) return sgn_order(a.size, b.size);
 
-
-    uint8_t* aptr = (uint8_t*)a.data + a.size - 1;
-    uint8_t* bptr = (uint8_t*)b.data + b.size - 1;
-
-    while (aptr >= (uint8_t*)a.data && bptr >= (uint8_t*)b.data) {
-        if (*aptr != *bptr) return sgn(*aptr - *bptr);
-        aptr--;
-        bptr--;
-    }
-    return 0; // if a == b;
+    size_t d = __diff_le((uint8_t*)a.data, (uint8_t*)b.data, a.size);
+    if (!d) return 0; // if a == b;
+    return sgn(((uint8_t*)a.data)[d - 1] - ((uint8_t*)b.data)[d - 1]);
 }
 
 // What is the result of sgn(`a` - `b`) ?
@@ -176,18 +351,10 @@ int cmp_sgn_le(cmp_item_t a, cmp_item_t b) {
 // 1 if a > b
 // Compare in big-endian
 int cmp_sgn_be(cmp_item_t a, cmp_item_t b) {
-    if (a.size != b.size) return sgn(a.size - b.size);
+    if (a.size != b.size) return sgn_order(a.size, b.size);
 
-    
-    uint8_t* aptr = (uint8_t*)a.data;
-    uint8_t* bptr = (uint8_t*)b.data;
-
-    while (aptr != (uint8_t*)a.data + a.size && bptr != (uint8_t*)b.data + b.size) {
-        if (*aptr != *bptr) return sgn(*aptr - *bptr);
-        aptr++;
-        bptr++;
-    }
-    return 0; // if a == b;
+    int d = memcmp(a.data, b.data, a.size);
+    return sgn(d);
 }
 
 // What is the result of sgn(`a` - `b`) ?
@@ -203,4 +370,18 @@ int cmp_sgn(cmp_item_t a, cmp_item_t b) {
     #endif
 }
 
+//
+// ---
+
+// ---
+// Typed signum compare
+
+#define CMP_SGN_TYPED(name, type) \
+    int cmp_sgn_##name(cmp_item_t a, cmp_item_t b) { \
+        return __cmp_sgn_##name(a, b); \
+    }
+CMP_TYPES(CMP_SGN_TYPED)
+#undef CMP_SGN_TYPED
+
+#undef sgn_order
 #undef sgn
\ No newline at end of file
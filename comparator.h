@@ -4,6 +4,10 @@
 
 #include <stdlib.h> // size_t
 #include <stdint.h> // uint8_t
+#include <string.h> // memcpy()
+
+// Containers store copies of items up to this many bytes inside their own nodes
+#define CMP_INLINE 16
 
 // An element which can be compared independently of its type
 struct cmp_item {
@@ -21,6 +25,13 @@ extern cmp_item_t cmp_item_new(void* data, size_t size);
 // Initialises new comparable item and copies the data
 extern cmp_item_t cmp_item_copy(void* data, size_t size);
 
+// Hashes the bytes of the item, suitable for hash tables
+extern uint64_t cmp_hash(cmp_item_t x);
+
+// Sorts `n` records of `stride` bytes, each starting with a `cmp_item_t` key, with a signum comparator
+// The sort is stable, so records with equal keys keep their order
+extern void cmp_sort(void *base, size_t n, size_t stride, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
 // ---
 // Boolean compare
 //
@@ -93,4 +104,46 @@ extern int cmp_sgn(cmp_item_t a, cmp_item_t b);
 //
 // ---
 
+// ---
+// Typed signum compare
+//
+// Compare items holding a single value of a fixed-width type with one load per side.
+// Floating-point NaNs are ordered after every other value.
+// Items of any other size are compared with `cmp_sgn()`.
+
+// The types with a typed comparator, as X(name, type)
+#define CMP_TYPES(X) \
+    X(u8, uint8_t) X(u16, uint16_t) X(u32, uint32_t) X(u64, uint64_t) \
+    X(i8, int8_t) X(i16, int16_t) X(i32, int32_t) X(i64, int64_t) \
+    X(f32, float) X(f64, double)
+
+// Inlinable versions of the typed comparators, named __cmp_sgn_<name>()
+#define __CMP_SGN_TYPED(name, type) \
+    static inline int __cmp_sgn_##name(cmp_item_t a, cmp_item_t b) { \
+        type x, y; \
+        if (a.size != sizeof(type) || b.size != sizeof(type)) return cmp_sgn(a, b); \
+        memcpy(&x, a.data, sizeof(type)); \
+        memcpy(&y, b.data, sizeof(type)); \
+        if (x != x || y != y) return (x != x) - (y != y); \
+        return (x > y) - (x < y); \
+    }
+CMP_TYPES(__CMP_SGN_TYPED)
+#undef __CMP_SGN_TYPED
+
+extern int cmp_sgn_u8(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_u16(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_u32(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_u64(cmp_item_t a, cmp_item_t b);
+
+extern int cmp_sgn_i8(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_i16(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_i32(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_i64(cmp_item_t a, cmp_item_t b);
+
+extern int cmp_sgn_f32(cmp_item_t a, cmp_item_t b);
+extern int cmp_sgn_f64(cmp_item_t a, cmp_item_t b);
+
+//
+// ---
+
 #endif
\ No newline at end of file
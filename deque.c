@@ -1,169 +1,307 @@
 // It's licensed under MIT, btw
 #include "comparator.h"
 #include "deque.h"
+#include "pool.h"
 
 #include <stdlib.h> // malloc() and free()
-#include <string.h> // memcpy()
+#include <string.h> // memcpy() and memmove()
+#include <stdatomic.h> // atomic_int
+
+#define DEQUE_MAP_MIN 8
 
 deque_t deque_new() {
-    return (deque_t){0, 0, 0};
+    return (deque_t){0};
 }
 
 int deque_empty(deque_t L) {
-    return !(L.tail);
+    return !(L.size);
 }
 
 size_t deque_size(deque_t L) {
     return L.size;
 }
 
+// ---
+// block map
+
+static struct deque_item *__slot(deque_t L, size_t pos) {
+    return &L.map[pos / DEQUE_BLOCK][pos % DEQUE_BLOCK];
+}
+
+static struct deque_item *__block_new(deque_t *L) {
+    struct deque_item *block = L->spare;
+
+    if (block) L->spare = 0;
+    else block = (struct deque_item*)malloc(DEQUE_BLOCK * sizeof(struct deque_item));
+    return block;
+}
+
+static void __block_release(deque_t *L, size_t b) {
+    if (!L->map[b]) return;
+
+    if (!L->spare) L->spare = L->map[b];
+    else free(L->map[b]);
+    L->map[b] = 0;
+}
+
+// Moves the used blocks to the middle of the block map, with room on both ends
+// The map is only reallocated (twice as big) when the used blocks take more than half of it,
+// so a deque used as a queue keeps recentering the same map instead of growing it
+static void __map_grow(deque_t *L) {
+    size_t b0 = L->first / DEQUE_BLOCK;
+    size_t used = L->size ? (L->first + L->size - 1) / DEQUE_BLOCK - b0 + 1 : 0;
+    size_t blocks = L->blocks;
+    struct deque_item **map = L->map;
+    size_t start, b;
+
+    if (2 * (used + 2) > blocks) {
+        blocks = 2 * L->blocks;
+        if (blocks < 2 * (used + 2)) blocks = 2 * (used + 2);
+        if (blocks < DEQUE_MAP_MIN) blocks = DEQUE_MAP_MIN;
+        map = (struct deque_item**)calloc(blocks, sizeof(struct deque_item*));
+    }
+    start = (blocks - used) / 2;
+
+    for (b = 0; b < L->blocks; b++) {
+        if (b < b0 || b >= b0 + used) __block_release(L, b);
+    }
+    if (used) memmove(map + start, L->map + b0, used * sizeof(struct deque_item*));
+
+    if (map == L->map) {
+        // The old positions of the moved blocks are stale now
+        for (b = 0; b < blocks; b++) {
+            if (b < start || b >= start + used) map[b] = 0;
+        }
+    } else {
+        free(L->map);
+    }
+
+    L->map = map;
+    L->blocks = blocks;
+    L->first = L->size ? start * DEQUE_BLOCK + L->first % DEQUE_BLOCK : start * DEQUE_BLOCK + DEQUE_BLOCK / 2;
+}
+
+// Makes sure the position right before the first item is backed by a block
+static void __reserve_front(deque_t *L) {
+    if (L->first == 0) __map_grow(L);
+    if (!L->map[(L->first - 1) / DEQUE_BLOCK]) L->map[(L->first - 1) / DEQUE_BLOCK] = __block_new(L);
+}
+
+// Makes sure the position right after the last item is backed by a block
+static void __reserve_back(deque_t *L) {
+    size_t end = L->first + L->size;
+
+    if (end == L->blocks * DEQUE_BLOCK) {
+        __map_grow(L);
+        end = L->first + L->size;
+    }
+    if (!L->map[end / DEQUE_BLOCK]) L->map[end / DEQUE_BLOCK] = __block_new(L);
+}
+
+// Moves `n` items from position `src` to position `dst`, one in-block segment at a time
+static void __move(deque_t *L, size_t dst, size_t src, size_t n) {
+    size_t chunk;
+
+    if (dst < src) {
+        while (n) {
+            chunk = DEQUE_BLOCK - dst % DEQUE_BLOCK;
+            if (chunk > DEQUE_BLOCK - src % DEQUE_BLOCK) chunk = DEQUE_BLOCK - src % DEQUE_BLOCK;
+            if (chunk > n) chunk = n;
+
+            memmove(__slot(*L, dst), __slot(*L, src), chunk * sizeof(struct deque_item));
+            dst += chunk;
+            src += chunk;
+            n -= chunk;
+        }
+    } else {
+        dst += n;
+        src += n;
+        while (n) {
+            chunk = (dst - 1) % DEQUE_BLOCK + 1;
+            if (chunk > (src - 1) % DEQUE_BLOCK + 1) chunk = (src - 1) % DEQUE_BLOCK + 1;
+            if (chunk > n) chunk = n;
+
+            dst -= chunk;
+            src -= chunk;
+            n -= chunk;
+            memmove(__slot(*L, dst), __slot(*L, src), chunk * sizeof(struct deque_item));
+        }
+    }
+}
+
+//
+// ---
+
+// ---
+// items
+
+static void *__item_data(struct deque_item *x) {
+    return x->item.size <= CMP_INLINE ? x->small : cmp_item(x->item);
+}
+
+static void __item_store(struct deque_item *x, void *item, size_t size) {
+    x->item = cmp_item_new(size <= CMP_INLINE ? 0 : malloc(size), size);
+    memcpy(__item_data(x), item, size);
+}
+
+static void __item_release(struct deque_item *x) {
+    if (x->item.size > CMP_INLINE) free(cmp_item(x->item));
+}
+
+//
+// ---
+
 void* deque_front(deque_t L) {
     if (deque_empty(L)) return 0;
-    else return cmp_item(L.tail->item);
+    else return __item_data(__slot(L, L.first));
 }
 
 void* deque_back(deque_t L) {
     if (deque_empty(L)) return 0;
-    else return cmp_item(L.head->item);
+    else return __item_data(__slot(L, L.first + L.size - 1));
 }
 
 void deque_push_front(deque_t* L, void* item, size_t size) {
-    struct deque_item* newi = (struct deque_item*)malloc(sizeof(struct deque_item));
-    
-    newi->prev = 0;
-    newi->item = cmp_item_new(item, size);
-    
-    if (deque_empty(*L)) {
-        L->tail = newi;
-        L->head = L->tail;
-    } else {
-        newi->next = L->tail;
-        L->tail->prev  = newi;
-        L->tail = newi;
-    }
+    __reserve_front(L);
+
+    L->first--;
+    __item_store(__slot(*L, L->first), item, size);
     L->size++;
 }
 
 void deque_push_back(deque_t* L, void* item, size_t size) {
-    struct deque_item* newi = (struct deque_item*)malloc(sizeof(struct deque_item));
-    
-    newi->next = 0;
-    newi->item = cmp_item_new(item, size);
-
-    if (deque_empty(*L)) {
-        L->head = newi;
-        L->tail = L->head;
-    } else {
-        newi->prev = L->head;
-        L->head->next = newi;
-        L->head = newi;
-    }
+    __reserve_back(L);
+
+    __item_store(__slot(*L, L->first + L->size), item, size);
     L->size++;
 }
 
 void deque_pop_front(deque_t *L) {
     if (deque_empty(*L)) return;
-    struct deque_item* oldi = L->tail;
 
-    if (L->head == L->tail) {
-        L->head = 0;
-        L->tail = 0;
-    } else {
-        L->tail = L->tail->next;
-    }
-
-    free(cmp_item(oldi->item));
-    free(oldi);
+    __item_release(__slot(*L, L->first));
+    L->first++;
     L->size--;
+
+    if (L->size && L->first % DEQUE_BLOCK == 0) __block_release(L, L->first / DEQUE_BLOCK - 1);
 }
 
 void deque_pop_back(deque_t *L) {
     if (deque_empty(*L)) return;
-    struct deque_item* oldi = L->head;
 
-    if (L->head == L->tail) {
-        L->head = 0;
-        L->tail = 0;
-    } else {
-        L->head = L->head->prev;
-    }
-
-    free(cmp_item(oldi->item));
-    free(oldi);
+    __item_release(__slot(*L, L->first + L->size - 1));
     L->size--;
-}
 
-static struct deque_item* __deque_at(deque_t L, int at) {
-    if (deque_empty(L)) return 0;
-    struct deque_item* p = L.tail;
-    while (at--) {
-        p = p->next;
-        if (!p) return 0;
-    }
-    return p;
+    if (L->size && (L->first + L->size) % DEQUE_BLOCK == 0) __block_release(L, (L->first + L->size) / DEQUE_BLOCK);
 }
 
 void* deque_at(deque_t L, int at) {
-    if (deque_empty(L)) return 0;
-    struct deque_item* p = L.tail;
-    while (at--) {
-        p = p->next;
-        if (!p) return 0;
-    }
-    return cmp_item(p->item);
+    if (at < 0 || (size_t)at >= L.size) return 0;
+    return __item_data(__slot(L, L.first + at));
 }
 
 
 void deque_insert(deque_t* L, int at, void* item, size_t size) {
-    struct deque_item* p;
-    struct deque_item* newi;
+    if (at < 0) return;
 
     if (deque_empty(*L)) deque_push_back(L, item, size);
     else if (at == 0) deque_push_front(L, item, size);
-    else if (at >= L->size) deque_push_back(L, item, size);
-    else {
-        newi = (struct deque_item*)malloc(sizeof(struct deque_item));
-        newi->item = cmp_item_new(item, size);
+    else if ((size_t)at >= L->size) deque_push_back(L, item, size);
+    else if ((size_t)at < L->size - at) {
+        // Shift the items before `at` one position to the front
+        __reserve_front(L);
+        L->first--;
+        __move(L, L->first, L->first + 1, at);
 
-        p = __deque_at(*L, at-1);
-        
-        newi->prev = p;
-        newi->next = p->next;
-        newi->next->prev = newi;
-        newi->prev->next = newi;
+        __item_store(__slot(*L, L->first + at), item, size);
+        L->size++;
+    } else {
+        // Shift the items starting from `at` one position to the back
+        __reserve_back(L);
+        __move(L, L->first + at + 1, L->first + at, L->size - at);
 
+        __item_store(__slot(*L, L->first + at), item, size);
         L->size++;
     }
 }
 
 void deque_remove(deque_t* L, int at) {
-    struct deque_item* oldi;
-
-    if (deque_empty(*L)) return;
+    if (at < 0 || deque_empty(*L)) return;
     else if (at == 0) deque_pop_front(L);
-    else if (at == L->size-1) deque_pop_back(L);
-    else if (at >= L->size) return;
+    else if ((size_t)at == L->size - 1) deque_pop_back(L);
+    else if ((size_t)at >= L->size) return;
     else {
-        struct deque_item* p = __deque_at(*L, at-1);
-        oldi = p->next;
-
-        p->next = p->next->next;
-        p->next->prev = p;
-        
-        free(cmp_item(oldi->item));
-        free(oldi);
-        L->size--;
+        __item_release(__slot(*L, L->first + at));
+
+        if ((size_t)at < L->size - at - 1) {
+            // Close the gap by shifting the items before `at` to the back
+            __move(L, L->first + 1, L->first, at);
+            L->first++;
+            L->size--;
+            if (L->first % DEQUE_BLOCK == 0) __block_release(L, L->first / DEQUE_BLOCK - 1);
+        } else {
+            // Close the gap by shifting the items after `at` to the front
+            __move(L, L->first + at, L->first + at + 1, L->size - at - 1);
+            L->size--;
+            if ((L->first + L->size) % DEQUE_BLOCK == 0) __block_release(L, (L->first + L->size) / DEQUE_BLOCK);
+        }
     }
 }
 
-int deque_count(deque_t L, void* item, size_t size) {
-    struct deque_item *p = L.tail;
-    cmp_item_t x = {item, size};
+// Counts the items matching `x` between the positions `pos` and `end`
+static int __count(deque_t L, cmp_item_t x, size_t pos, size_t end) {
+    size_t i, n;
 
     int out = 0;
-    while (p != 0) {
-        if (cmp_equal(x, p->item)) out++;
-        p = p->next;
+    while (pos < end) {
+        // Scan the rest of the current block at once
+        struct deque_item *block = __slot(L, pos);
+        n = DEQUE_BLOCK - pos % DEQUE_BLOCK;
+        if (n > end - pos) n = end - pos;
+
+        for (i = 0; i < n; i++) {
+            if (block[i].item.size == x.size && cmp_equal(x, cmp_item_new(__item_data(&block[i]), x.size))) out++;
+        }
+        pos += n;
     }
     return out;
+}
+
+int deque_count(deque_t L, void* item, size_t size) {
+    return __count(L, cmp_item_new(item, size), L.first, L.first + L.size);
+}
+
+struct deque_count {
+    deque_t L;
+    cmp_item_t x;
+    atomic_int out;
+};
+
+static void __count_range(void *arg, size_t lo, size_t hi) {
+    struct deque_count *C = (struct deque_count*)arg;
+
+    atomic_fetch_add_explicit(&C->out, __count(C->L, C->x, C->L.first + lo, C->L.first + hi), memory_order_relaxed);
+}
+
+int deque_count_parallel(deque_t L, void* item, size_t size, pool_t *P) {
+    struct deque_count C;
+    // About `DEQUE_SPLIT` ranges per thread, of at least a block each
+    size_t blocks = (L.size + DEQUE_BLOCK - 1) / DEQUE_BLOCK / (pool_threads(P) * DEQUE_SPLIT) + 1;
+
+    C.L = L;
+    C.x = cmp_item_new(item, size);
+    atomic_init(&C.out, 0);
+    pool_for(P, L.size, blocks * DEQUE_BLOCK, __count_range, &C);
+    return atomic_load_explicit(&C.out, memory_order_relaxed);
+}
+
+void deque_free(deque_t* L) {
+    size_t b;
+
+    while (!deque_empty(*L)) deque_pop_back(L);
+
+    for (b = 0; b < L->blocks; b++) free(L->map[b]);
+    free(L->map);
+    free(L->spare);
+    *L = deque_new();
 }
\ No newline at end of file
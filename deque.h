@@ -6,22 +6,33 @@
 
 #include <stddef.h> // size_t
 
+// The thread pool the parallel calls run on, defined in pool.h
+typedef struct pool pool_t;
+
+// The number of items stored in every block of the deque
+#define DEQUE_BLOCK 32
+
+// The number of ranges per thread `deque_count_parallel()` cuts the deque into
+#define DEQUE_SPLIT 8
+
 // The item stored in the deque
+// Items move around inside the deque, so the payload is in `small` whenever its size is at most `CMP_INLINE`
 struct deque_item {
     cmp_item_t item;
-    //void *item;
-
-    struct deque_item *prev;
-    struct deque_item *next;
+    uint8_t small[CMP_INLINE];
 };
 
 
 // The deque itself, should be assigned the value of `deque_new()` or zeroed manually
+// Items live in fixed-size blocks of `DEQUE_BLOCK` items, addressed through the block map `map`
 struct deque {
     size_t size;
 
-    struct deque_item *tail;
-    struct deque_item *head;    
+    struct deque_item **map; // The block map, unused entries are either zero or spare blocks
+    size_t blocks;           // The number of entries in `map`
+    size_t first;            // The position of the first item, counted from the beginning of `map[0]`
+
+    struct deque_item *spare; // A released block kept around for the next allocation
 };
 
 typedef struct deque deque_t;
@@ -57,11 +68,11 @@ extern void deque_pop_front(deque_t* L);
 extern void deque_pop_back(deque_t* L);
 
 // Inserts an element at the specified index
-// (Acts as `deque_push_back()` if deque is too small)
+// (Acts as `deque_push_back()` if deque is too small, does nothing if `at` is negative)
 extern void deque_insert(deque_t* L, int at, void* item, size_t size);
 
 // Removes an element at the specified index
-// (Does `nothing` if deque is too small)
+// (Does `nothing` if deque is too small or `at` is negative)
 extern void deque_remove(deque_t* L, int at);
 
 // Accesses an element at the specified index
@@ -71,4 +82,10 @@ extern void* deque_at(deque_t L, int at);
 // Returns the number of elements mathing specific key
 extern int deque_count(deque_t L, void* item, size_t size);
 
+// Same as `deque_count()`, but the blocks are scanned by the threads of `P`
+extern int deque_count_parallel(deque_t L, void* item, size_t size, pool_t *P);
+
+// Removes all elements and releases the memory held by the deque
+extern void deque_free(deque_t* L);
+
 #endif
\ No newline at end of file
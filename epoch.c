@@ -0,0 +1,174 @@
+// It's licensed under MIT, btw
+#include "epoch.h"
+
+#include <stddef.h>    // size_t
+#include <stdlib.h>    // malloc(), realloc() and free()
+#include <stdatomic.h> // atomic_*
+#include <pthread.h>   // pthread_key_*() and pthread_once()
+#include <sched.h>     // sched_yield()
+
+// A retired pointer
+struct epoch_garbage {
+    void *ptr;
+    void (*release)(void*);
+};
+
+// Pointers retired during one epoch
+struct epoch_limbo {
+    size_t epoch;
+    size_t size;
+    size_t capacity;
+    struct epoch_garbage *items;
+};
+
+// The state of one thread, records are never freed but are reused by new threads
+struct epoch_record {
+    atomic_size_t state; // The epoch observed on entry shifted left by one, the lowest bit is set while active
+    atomic_int used;     // Whether a live thread owns the record
+    size_t depth;        // The nesting of `epoch_enter()`
+    size_t retired;      // Retirements since the last reclamation attempt
+    struct epoch_limbo limbo[3];
+    struct epoch_record *next;
+};
+
+static atomic_size_t __epoch = 1;
+static _Atomic(struct epoch_record*) __records;
+
+static _Thread_local struct epoch_record *__self;
+static pthread_key_t __key;
+static pthread_once_t __key_once = PTHREAD_ONCE_INIT;
+
+// ---
+// reclamation
+//
+// Garbage retired in epoch `e` may still be seen by threads which entered in `e - 1` or `e`,
+// so it's released once the global epoch reaches `e + 2`.
+// The epoch only advances when every active thread has observed the current one.
+
+static void __limbo_release(struct epoch_limbo *L) {
+    for (size_t i = 0; i < L->size; i++)
+        L->items[i].release(L->items[i].ptr);
+    L->size = 0;
+}
+
+static void __reclaim(struct epoch_record *R, size_t epoch) {
+    for (int i = 0; i < 3; i++) {
+        struct epoch_limbo *L = &R->limbo[i];
+        if (L->size && L->epoch + 2 <= epoch) __limbo_release(L);
+    }
+}
+
+// Moves the global epoch forward if no active thread lags behind, returns the current one
+static size_t __try_advance(void) {
+    size_t epoch = atomic_load_explicit(&__epoch, memory_order_seq_cst);
+
+    for (struct epoch_record *R = atomic_load_explicit(&__records, memory_order_acquire); R; R = R->next) {
+        size_t state = atomic_load_explicit(&R->state, memory_order_seq_cst);
+        if ((state & 1) && (state >> 1) != epoch) return epoch;
+    }
+
+    if (atomic_compare_exchange_strong_explicit(&__epoch, &epoch, epoch + 1, memory_order_seq_cst, memory_order_seq_cst))
+        return epoch + 1;
+    return epoch;
+}
+
+// ---
+
+// ---
+// thread records
+//
+// A thread claims a free record (or allocates a new one) the first time it enters.
+// On exit the thread waits for its own garbage to become safe, then gives the record up.
+
+static void __record_release(void *p) {
+    struct epoch_record *R = (struct epoch_record*)p;
+
+    __self = R;
+    epoch_synchronize();
+    for (int i = 0; i < 3; i++) {
+        free(R->limbo[i].items);
+        R->limbo[i] = (struct epoch_limbo){0};
+    }
+
+    __self = 0;
+    atomic_store_explicit(&R->used, 0, memory_order_release);
+}
+
+static void __key_create(void) {
+    pthread_key_create(&__key, __record_release);
+}
+
+static struct epoch_record *__record(void) {
+    struct epoch_record *R;
+    int unused = 0;
+
+    if (__self) return __self;
+
+    for (R = atomic_load_explicit(&__records, memory_order_acquire); R; R = R->next, unused = 0)
+        if (!atomic_load_explicit(&R->used, memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&R->used, &unused, 1, memory_order_acquire, memory_order_relaxed)) break;
+
+    if (!R) {
+        R = (struct epoch_record*)calloc(1, sizeof(struct epoch_record));
+        atomic_init(&R->state, 0);
+        atomic_init(&R->used, 1);
+
+        R->next = atomic_load_explicit(&__records, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&__records, &R->next, R, memory_order_release, memory_order_relaxed));
+    }
+
+    pthread_once(&__key_once, __key_create);
+    pthread_setspecific(__key, R);
+    __self = R;
+    return R;
+}
+
+// ---
+
+void epoch_enter(void) {
+    struct epoch_record *R = __record();
+
+    if (R->depth++) return;
+
+    atomic_store_explicit(&R->state, atomic_load_explicit(&__epoch, memory_order_relaxed) << 1 | 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void epoch_exit(void) {
+    struct epoch_record *R = __self;
+
+    if (--R->depth) return;
+    atomic_store_explicit(&R->state, 0, memory_order_release);
+}
+
+void epoch_retire(void *ptr, void (*release)(void*)) {
+    struct epoch_record *R = __record();
+    size_t epoch = atomic_load_explicit(&__epoch, memory_order_acquire);
+    struct epoch_limbo *L = &R->limbo[epoch % 3];
+
+    // The bucket was last filled three or more epochs ago
+    if (L->epoch != epoch) {
+        __limbo_release(L);
+        L->epoch = epoch;
+    }
+
+    if (L->size == L->capacity) {
+        L->capacity = L->capacity ? L->capacity * 2 : EPOCH_BATCH;
+        L->items = (struct epoch_garbage*)realloc(L->items, L->capacity * sizeof(struct epoch_garbage));
+    }
+    L->items[L->size++] = (struct epoch_garbage){ptr, release};
+
+    if (++R->retired >= EPOCH_BATCH) {
+        R->retired = 0;
+        __reclaim(R, __try_advance());
+    }
+}
+
+void epoch_synchronize(void) {
+    struct epoch_record *R = __record();
+    size_t target = atomic_load_explicit(&__epoch, memory_order_acquire) + 2;
+    size_t epoch;
+
+    while ((epoch = __try_advance()) < target) sched_yield();
+    __reclaim(R, epoch);
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_EPOCH_H
+#define _CTYPES_EPOCH_H
+
+#include <stddef.h> // size_t
+
+// Epoch-based memory reclamation for the concurrent containers
+//
+// A thread reads shared nodes only between `epoch_enter()` and `epoch_exit()`.
+// A node unlinked by a writer is handed to `epoch_retire()` instead of being freed,
+// and is released once every thread which could still see it has left its critical section.
+
+// Retired pointers are collected per thread, reclamation is attempted every this many retirements
+#define EPOCH_BATCH 64
+
+
+// Marks the calling thread as reading shared nodes (may be nested)
+extern void epoch_enter(void);
+
+// Ends the critical section started by the matching `epoch_enter()`
+extern void epoch_exit(void);
+
+// Releases `ptr` with `release` once no thread can be reading it anymore
+extern void epoch_retire(void *ptr, void (*release)(void*));
+
+// Waits until every critical section running at the time of the call has ended,
+// then releases everything the calling thread has retired
+// Must not be called between `epoch_enter()` and `epoch_exit()`
+extern void epoch_synchronize(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+// It's licensed under MIT, btw
+#include "comparator.h"
+#include "hashmap.h"
+
+#include <stdlib.h> // malloc() and free()
+#include <string.h> // memcpy() and memset()
+
+#ifdef __SSE2__
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#define CTRL_EMPTY   ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+#define HASHMAP_MIN 16
+
+hashmap_t hashmap_new(uint64_t (*hash)(cmp_item_t key)) {
+    hashmap_t H = {0};
+
+    H.hash = hash;
+    return H;
+}
+
+size_t hashmap_size(hashmap_t H) {
+    return H.size;
+}
+
+static uint64_t __hash(hashmap_t H, cmp_item_t key) {
+    return H.hash ? H.hash(key) : cmp_hash(key);
+}
+
+// ---
+// control bytes
+//
+// The low 7 bits of the hash are stored in the control byte of a full slot,
+// the rest select where probing starts. The first `HASHMAP_GROUP` control bytes
+// are mirrored after the last one, so a group can be loaded at any position.
+
+static int8_t __h2(uint64_t hash) {
+    return (int8_t)(hash & 0x7F);
+}
+
+static size_t __h1(uint64_t hash) {
+    return (size_t)(hash >> 7);
+}
+
+// Returns a bitmask of the control bytes of the group starting at `ctrl` which are equal to `c`
+static unsigned __group_match(const int8_t *ctrl, int8_t c) {
+    #ifdef __SSE2__
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)ctrl), _mm_set1_epi8(c)));
+    #else
+        unsigned mask = 0;
+        for (int i = 0; i < HASHMAP_GROUP; i++) {
+            if (ctrl[i] == c) mask |= 1u << i;
+        }
+        return mask;
+    #endif
+}
+
+// Returns a bitmask of the empty or deleted slots of the group starting at `ctrl`
+static unsigned __group_free(const int8_t *ctrl) {
+    #ifdef __SSE2__
+        return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+    #else
+        unsigned mask = 0;
+        for (int i = 0; i < HASHMAP_GROUP; i++) {
+            if (ctrl[i] < 0) mask |= 1u << i;
+        }
+        return mask;
+    #endif
+}
+
+static void __set_ctrl(hashmap_t *H, size_t i, int8_t c) {
+    H->ctrl[i] = c;
+    if (i < HASHMAP_GROUP) H->ctrl[H->capacity + i] = c;
+}
+
+//
+// ---
+
+// ---
+// probing
+
+static struct hashmap_slot *__find(hashmap_t H, cmp_item_t key, uint64_t hash) {
+    size_t mask = H.capacity - 1;
+    size_t pos = __h1(hash) & mask;
+    size_t step = 0;
+    unsigned match;
+    struct hashmap_slot *slot;
+
+    if (!H.capacity) return 0;
+    __builtin_prefetch(&H.slots[pos]);
+
+    while (1) {
+        match = __group_match(H.ctrl + pos, __h2(hash));
+        while (match) {
+            slot = &H.slots[(pos + __builtin_ctz(match)) & mask];
+            if (cmp_equal(slot->key, key)) return slot;
+            match &= match - 1;
+        }
+        if (__group_match(H.ctrl + pos, CTRL_EMPTY)) return 0;
+
+        step += HASHMAP_GROUP;
+        pos = (pos + step) & mask;
+    }
+}
+
+// Returns the index of the first empty or deleted slot on the probe sequence of `hash`
+static size_t __find_free(hashmap_t H, uint64_t hash) {
+    size_t mask = H.capacity - 1;
+    size_t pos = __h1(hash) & mask;
+    size_t step = 0;
+    unsigned empty;
+
+    while (!(empty = __group_free(H.ctrl + pos))) {
+        step += HASHMAP_GROUP;
+        pos = (pos + step) & mask;
+    }
+    return (pos + __builtin_ctz(empty)) & mask;
+}
+
+// Moves every element to a new table, doubling it unless most of the used slots are tombstones
+static void __rehash(hashmap_t *H) {
+    hashmap_t old = *H;
+    size_t capacity = old.capacity ? old.capacity : HASHMAP_MIN;
+    struct hashmap_slot *slot;
+    size_t i, j;
+
+    if (old.size * 2 >= capacity) capacity *= 2;
+
+    H->capacity = capacity;
+    H->ctrl = (int8_t*)malloc(capacity + HASHMAP_GROUP);
+    H->slots = (struct hashmap_slot*)malloc(capacity * sizeof(struct hashmap_slot));
+    H->deleted = 0;
+    memset(H->ctrl, CTRL_EMPTY, capacity + HASHMAP_GROUP);
+
+    for (i = 0; i < old.capacity; i++) {
+        if (old.ctrl[i] < 0) continue;
+
+        slot = &old.slots[i];
+        uint64_t hash = __hash(*H, slot->key);
+        j = __find_free(*H, hash);
+
+        __set_ctrl(H, j, __h2(hash));
+        H->slots[j] = *slot;
+        if (slot->key.data == slot->small) H->slots[j].key.data = H->slots[j].small;
+    }
+
+    free(old.ctrl);
+    free(old.slots);
+}
+
+//
+// ---
+
+void hashmap_insert(hashmap_t *H, cmp_item_t key, cmp_item_t value) {
+    uint64_t hash = __hash(*H, key);
+    struct hashmap_slot *slot;
+    size_t i;
+
+    if (__find(*H, key, hash)) return;
+
+    // Keep the load (including tombstones) under 7/8
+    if ((H->size + H->deleted + 1) * 8 > H->capacity * 7) __rehash(H);
+
+    i = __find_free(*H, hash);
+    if (H->ctrl[i] == CTRL_DELETED) H->deleted--;
+    __set_ctrl(H, i, __h2(hash));
+
+    slot = &H->slots[i];
+    if (key.size <= HASHMAP_INLINE) {
+        memcpy(slot->small, key.data, key.size);
+        slot->key = cmp_item_new(slot->small, key.size);
+    } else {
+        slot->key = cmp_item_copy(key.data, key.size);
+    }
+    slot->value = cmp_item_copy(value.data, value.size);
+
+    H->size++;
+}
+
+void hashmap_delete(hashmap_t *H, cmp_item_t key) {
+    struct hashmap_slot *slot = __find(*H, key, __hash(*H, key));
+
+    if (!slot) return;
+
+    if (slot->key.data != slot->small) free(cmp_item(slot->key));
+    free(cmp_item(slot->value));
+
+    __set_ctrl(H, slot - H->slots, CTRL_DELETED);
+    H->size--;
+    H->deleted++;
+}
+
+cmp_item_t *hashmap_find(hashmap_t H, cmp_item_t key) {
+    struct hashmap_slot *slot = __find(H, key, __hash(H, key));
+
+    if (slot) return &slot->value;
+    else return 0;
+}
+
+void hashmap_free(hashmap_t *H) {
+    size_t i;
+
+    for (i = 0; i < H->capacity; i++) {
+        if (H->ctrl[i] < 0) continue;
+
+        if (H->slots[i].key.data != H->slots[i].small) free(cmp_item(H->slots[i].key));
+        free(cmp_item(H->slots[i].value));
+    }
+
+    free(H->ctrl);
+    free(H->slots);
+    *H = hashmap_new(H->hash);
+}
\ No newline at end of file
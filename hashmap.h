@@ -0,0 +1,60 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_HASHMAP_H
+#define _CTYPES_HASHMAP_H
+#include "comparator.h"
+
+#include <stdlib.h> // size_t
+#include <stdint.h> // uint8_t and uint64_t
+
+// Keys up to this many bytes are stored inside the slot
+#define HASHMAP_INLINE CMP_INLINE
+
+// The number of control bytes probed at once
+#define HASHMAP_GROUP 16
+
+// The item stored in the hash map
+struct hashmap_slot {
+    cmp_item_t key;
+    cmp_item_t value;
+
+    uint8_t small[HASHMAP_INLINE]; // The key's data when it is small enough
+};
+
+// The hash map itself, should be assigned the value of `hashmap_new()` or zeroed manually
+// Uses open addressing: `ctrl` holds one control byte per slot (empty, deleted, or 7 bits of the hash),
+// which are matched a group at a time before any key is compared
+struct hashmap {
+    int8_t *ctrl;
+    struct hashmap_slot *slots;
+
+    size_t capacity; // The number of slots (a power of two, or 0)
+    size_t size;
+    size_t deleted;  // The number of tombstones
+
+    uint64_t (*hash)(cmp_item_t key);
+};
+
+typedef struct hashmap hashmap_t;
+
+// Returns an empty `hashmap_t`. Takes a hash function as an argument (0 for `cmp_hash()`)
+extern hashmap_t hashmap_new(uint64_t (*hash)(cmp_item_t key));
+
+// Returns the number of elements
+extern size_t hashmap_size(hashmap_t H);
+
+// Inserts an element with a specified key in the map
+// (Does nothing if the key is already present)
+extern void hashmap_insert(hashmap_t *H, cmp_item_t key, cmp_item_t value);
+
+// Deletes an element with a specified key from the map
+extern void hashmap_delete(hashmap_t *H, cmp_item_t key);
+
+// Accesses an element with a specified key in the map (0 if not found)
+// The pointer is invalidated by the next `hashmap_insert()`
+extern cmp_item_t *hashmap_find(hashmap_t H, cmp_item_t key);
+
+// Removes all elements and releases the memory held by the map
+extern void hashmap_free(hashmap_t *H);
+
+
+#endif
\ No newline at end of file
@@ -1,19 +1,45 @@
 // It's licensed under MIT, btw
 #include "map.h"
+#include "slab.h"
+#include "pool.h"
+
+#include <string.h>    // memcpy()
 
 map_t map_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
-    return (map_t){0, sgn_cmp};
+    return (map_t){0, sgn_cmp, 0, 0, 0, stats_new()};
+}
+
+map_t map_new_slab(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    return (map_t){0, sgn_cmp, 0, slab_new(), 0, stats_new()};
 }
 
 size_t map_size(map_t M) {
     return M.size;
 }
 
-static struct map_node *map_node_new(cmp_item_t key, cmp_item_t value) {
-    struct map_node *node = (struct map_node*)malloc(sizeof(struct map_node));
+// ---
+// node allocation
+
+static void *__alloc(map_t *M, size_t size) {
+    STATS_ADD(M->stats, allocs, 1);
+    STATS_ADD(M->stats, bytes, size);
+    return M->slab ? slab_alloc(M->slab, size) : malloc(size);
+}
+
+static void __free(map_t *M, void *ptr, size_t size) {
+    STATS_ADD(M->stats, frees, 1);
+    STATS_SUB(M->stats, bytes, size);
+    if (M->slab) slab_free(M->slab, ptr, size);
+    else free(ptr);
+}
+
+static struct map_node *map_node_new(map_t *M, cmp_item_t key, cmp_item_t value) {
+    struct map_node *node = (struct map_node*)__alloc(M, sizeof(struct map_node));
 
-    node->key = cmp_item_copy(key.data, key.size);
-    node->value = cmp_item_copy(value.data, value.size);
+    node->key = cmp_item_new(key.size <= CMP_INLINE ? node->small_key : __alloc(M, key.size), key.size);
+    node->value = cmp_item_new(value.size <= CMP_INLINE ? node->small_value : __alloc(M, value.size), value.size);
+    memcpy(node->key.data, key.data, key.size);
+    memcpy(node->value.data, value.data, value.size);
     node->parent = 0;
     node->left = 0;
     node->right = 0;
@@ -22,26 +48,137 @@ static struct map_node *map_node_new(cmp_item_t key, cmp_item_t value) {
     return node;
 }
 
+static void map_node_free(map_t *M, struct map_node *node) {
+    if (node->value.data != node->small_value) __free(M, cmp_item(node->value), node->value.size);
+    if (node->key.data != node->small_key) __free(M, cmp_item(node->key), node->key.size);
+    __free(M, node, sizeof(struct map_node));
+}
 
+//
 // ---
-// map_find
 
-static struct map_node *__map_find(struct map_node *root, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
-    if (!root) return 0;
-    switch (sgn_cmp(root->key, key)) {
-        case -1:
-            return __map_find(root->right, key, sgn_cmp);
-        case 0: 
-            return root;
-        case 1:
-            return __map_find(root->left, key, sgn_cmp);
-        default:
-            return 0;
-    }
+
+// ---
+// comparator specialization
+//
+// The descents below are generated for every typed comparator from comparator.h,
+// so a map created with e.g. `cmp_sgn_u64` compares keys inline instead of calling `sgn_cmp` at every node
+
+// Counts one descent visiting (and comparing at) `hops` nodes
+static inline void __stats_descent(struct ctypes_counters *stats, size_t hops) {
+    STATS_ADD(stats, finds, 1);
+    STATS_ADD(stats, visited, hops);
+    STATS_ADD(stats, compares, hops);
 }
 
+// Generates __map_find_<name>(), __find_parent_<name>() and __map_find_many_<name>() comparing keys with `cmp`
+// Both children are prefetched while the current key is compared, so the next level is on its way whichever side is taken.
+// The batched descent advances up to `MAP_BATCH` independent lookups one level at a time, overlapping their cache misses
+#define MAP_DESCENT_DEFINE(name, cmp) \
+static struct map_node *__map_find_##name(struct map_node *x, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) { \
+    size_t hops = 0; \
+    int c; \
+    (void)sgn_cmp; \
+    while (x) { \
+        hops++; \
+        __builtin_prefetch(x->left); \
+        __builtin_prefetch(x->right); \
+        c = cmp(x->key, key); \
+        if (c < 0) x = x->right; \
+        else if (c > 0) x = x->left; \
+        else break; \
+    } \
+    __stats_descent(stats, hops); \
+    return x; \
+} \
+static struct map_node *__find_parent_##name(struct map_node *x, cmp_item_t key, int *sign, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) { \
+    struct map_node *par = 0; \
+    size_t hops = 0; \
+    int c = 0; \
+    (void)sgn_cmp; \
+    while (x) { \
+        hops++; \
+        par = x; \
+        __builtin_prefetch(x->left); \
+        __builtin_prefetch(x->right); \
+        c = cmp(key, x->key); \
+        if (c < 0) x = x->left; \
+        else if (c > 0) x = x->right; \
+        else break; \
+    } \
+    __stats_descent(stats, hops); \
+    *sign = c; \
+    return par; \
+} \
+static void __map_find_many_##name(struct map_node *root, cmp_item_t *keys, size_t n, struct map_node **out, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) { \
+    struct map_node *x[MAP_BATCH]; \
+    size_t hops = 0, live = n, j; \
+    int c; \
+    (void)sgn_cmp; \
+    for (j = 0; j < n; j++) { \
+        x[j] = root; \
+        out[j] = 0; \
+    } \
+    while (live) { \
+        live = 0; \
+        for (j = 0; j < n; j++) { \
+            if (!x[j]) continue; \
+            hops++; \
+            c = cmp(x[j]->key, keys[j]); \
+            if (!c) { \
+                out[j] = x[j]; \
+                x[j] = 0; \
+                continue; \
+            } \
+            x[j] = c < 0 ? x[j]->right : x[j]->left; \
+            if (x[j]) { \
+                __builtin_prefetch(x[j]); \
+                live++; \
+            } \
+        } \
+    } \
+    STATS_ADD(stats, finds, n); \
+    STATS_ADD(stats, visited, hops); \
+    STATS_ADD(stats, compares, hops); \
+}
+
+#define MAP_DESCENT_TYPED(name, type) MAP_DESCENT_DEFINE(name, __cmp_sgn_##name)
+CMP_TYPES(MAP_DESCENT_TYPED)
+MAP_DESCENT_DEFINE(generic, sgn_cmp)
+#undef MAP_DESCENT_TYPED
+
+// Picks the descent specialized for `sgn_cmp`, falling back to the generic one
+static struct map_node *__map_find(struct map_node *root, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) {
+    #define MAP_DISPATCH(name, type) if (sgn_cmp == cmp_sgn_##name) return __map_find_##name(root, key, sgn_cmp, stats);
+    CMP_TYPES(MAP_DISPATCH)
+    #undef MAP_DISPATCH
+    return __map_find_generic(root, key, sgn_cmp, stats);
+}
+
+static void __map_find_many(map_t M, cmp_item_t *keys, size_t n, struct map_node **out) {
+    #define MAP_DISPATCH(name, type) if (M.sgn_cmp == cmp_sgn_##name) { __map_find_many_##name(M.root, keys, n, out, M.sgn_cmp, M.stats); return; }
+    CMP_TYPES(MAP_DISPATCH)
+    #undef MAP_DISPATCH
+    __map_find_many_generic(M.root, keys, n, out, M.sgn_cmp, M.stats);
+}
+
+// Descends from `x`, the root of the tree or of a subtree whose key range holds `key`
+// Stores the result of comparing `key` with the returned node in `*sign` (0 if the tree is empty)
+static struct map_node *__find_parent(map_t *M, struct map_node *x, cmp_item_t key, int *sign) {
+    #define MAP_DISPATCH(name, type) if (M->sgn_cmp == cmp_sgn_##name) return __find_parent_##name(x, key, sign, M->sgn_cmp, M->stats);
+    CMP_TYPES(MAP_DISPATCH)
+    #undef MAP_DISPATCH
+    return __find_parent_generic(x, key, sign, M->sgn_cmp, M->stats);
+}
+
+//
+// ---
+
+// ---
+// map_find
+
 struct map_node *_map_find(map_t M, cmp_item_t key) {
-    return __map_find(M.root, key, M.sgn_cmp);
+    return __map_find(M.root, key, M.sgn_cmp, M.stats);
 }
 
 
@@ -51,42 +188,78 @@ cmp_item_t *map_find(map_t M, cmp_item_t key) {
     else return 0;
 }
 
+size_t map_find_many(map_t M, cmp_item_t *keys, size_t n, cmp_item_t **values) {
+    struct map_node *nodes[MAP_BATCH];
+    size_t count = 0, m;
+
+    for (size_t i = 0; i < n; i += m) {
+        m = n - i < MAP_BATCH ? n - i : MAP_BATCH;
+        __map_find_many(M, keys + i, m, nodes);
+        for (size_t j = 0; j < m; j++) {
+            count += nodes[j] != 0;
+            values[i + j] = nodes[j] ? &nodes[j]->value : 0;
+        }
+    }
+    return count;
+}
+
 //
 // ---
 
 // ---
 // rotation functions
 
+// Stores a tree link, lock-free readers (see cmap.h) load the links while the tree is being rebalanced
+#define __store(link, node) __atomic_store_n(&(link), (node), __ATOMIC_RELAXED)
+
+static size_t __weight(struct map_node *node) {
+    return node ? node->weight : 0;
+}
+
 static void __rotate_left(map_t *M, struct map_node *node) {
+    STATS_ADD(M->stats, rotations, 1);
+
     struct map_node *child = node->right;
-    node->right = child->left;
+    __store(node->right, child->left);
 
     if (node->right) node->right->parent = node;
 
     child->parent = node->parent;
 
-    if (!node->parent) M->root = child;
-    else if (node == node->parent->left) node->parent->left = child;
-    else node->parent->right = child;
+    if (!node->parent) __store(M->root, child);
+    else if (node == node->parent->left) __store(node->parent->left, child);
+    else __store(node->parent->right, child);
 
-    child->left = node;
+    __store(child->left, node);
     node->parent = child;
+
+    if (M->ranked) {
+        child->weight = node->weight;
+        node->weight = __weight(node->left) + __weight(node->right) + 1;
+    }
 }
 
 static void __rotate_right(map_t *M, struct map_node *node) {
+    STATS_ADD(M->stats, rotations, 1);
+
     struct map_node *child = node->left;
-    node->left = child->right;
+    __store(node->left, child->right);
 
     if (node->left) node->left->parent = node;
 
     child->parent = node->parent;
 
-    if (!node->parent) M->root = child;
-    else if (node == node->parent->left) node->parent->left = child;
-    else node->parent->right = child;
+    if (!node->parent) __store(M->root, child);
+    else if (node == node->parent->left) __store(node->parent->left, child);
+    else __store(node->parent->right, child);
 
-    child->right = node;
+    __store(child->right, node);
     node->parent = child;
+
+    if (M->ranked) {
+        child->weight = node->weight;
+        node->weight = __weight(node->left) + __weight(node->right) + 1;
+    }
 }
 
 //
@@ -95,27 +268,6 @@ static void __rotate_right(map_t *M, struct map_node *node) {
 // ---
 // map_insert
 
-static struct map_node *__find_parent(map_t *M, struct map_node *node) {
-    struct map_node *x = M->root;
-    struct map_node *par = 0;
-    
-    while (x != 0) {
-        par = x;
-        switch (M->sgn_cmp(node->key, x->key)) {
-        case -1:
-            x = x->left;
-            break;
-        default: // + case 0:
-            return x;
-        case 1:
-            x = x->right;
-            break;
-        }
-    }
-    
-    return par;
-}
-
 static void __insert_fix(map_t *M, struct map_node *node) {
     struct map_node *u; // uncle
 
@@ -157,35 +309,34 @@ static void __insert_fix(map_t *M, struct map_node *node) {
     M->root->color = 0;
 }
 
-static void map_insert_node(map_t *M, struct map_node *node) {
-    // Insert `item` into tree
-    struct map_node *par = __find_parent(M, node);
-
+// Links a new node for `key` as the child of `par` on the side of `c` (the sign of `key` - `par->key`)
+static struct map_node *__link(map_t *M, struct map_node *par, int c, cmp_item_t key, cmp_item_t value) {
+    struct map_node *node = map_node_new(M, key, value);
     node->parent = par;
 
-    if (!par) M->root = node;
-    else {
-        switch (M->sgn_cmp(par->key, node->key)) {
-        case -1:
-            par->right = node;
-            break;
-        default: // + case 0:
-            free(cmp_item(node->value));
-            free(cmp_item(node->key));
-            free(node);
-            return;
-        case 1:
-            par->left = node;
-            break;
-        }
+    // Lock-free readers (see cmap.h) may reach the node as soon as it's linked, so the link releases its contents
+    if (!par) __atomic_store_n(&M->root, node, __ATOMIC_RELEASE);
+    else if (c < 0) __atomic_store_n(&par->left, node, __ATOMIC_RELEASE);
+    else __atomic_store_n(&par->right, node, __ATOMIC_RELEASE);
+
+    if (M->ranked) {
+        node->weight = 1;
+        for (; par; par = par->parent) par->weight++;
     }
 
     __insert_fix(M, node);
-    M->size++;
+    __store(M->size, M->size + 1);
+    return node;
 }
 
 void map_insert(map_t *M, cmp_item_t key, cmp_item_t value) {
-    map_insert_node(M, map_node_new(key, value));
+    // Only allocate the node once the key is known to be missing
+    int c;
+    struct map_node *par = __find_parent(M, M->root, key, &c);
+
+    if (par && !c) return;
+
+    __link(M, par, c, key, value);
 }
 
 //
@@ -201,111 +352,686 @@ static struct map_node *__minimum(struct map_node *node) {
 }
 
 static void __transplant(map_t *M, struct map_node *u, struct map_node *v) {
-    if (!u->parent) M->root = v;
-    else if (u == u->parent->left) u->parent->left = v;
-    else u->parent->right = v;
+    if (!u->parent) __store(M->root, v);
+    else if (u == u->parent->left) __store(u->parent->left, v);
+    else __store(u->parent->right, v);
 
     if (v) v->parent = u->parent;
 }
 
-static void __delete_fix(map_t *M, struct map_node *node) {
-    struct map_node *u;
+#define __red(n) ((n) && (n)->color)
 
-    if (!node) return;
+// `node` may be zero (an empty leaf), so its parent is passed separately
+static void __delete_fix(map_t *M, struct map_node *node, struct map_node *parent) {
+    struct map_node *u;
 
-    while (node != M->root && !node->color) {
-        if (node == node->parent->left) {
-            u = node->parent->right;
+    while (node != M->root && !__red(node)) {
+        if (node == parent->left) {
+            u = parent->right;
             if (u->color) {
                 u->color = 0;
-                node->parent->color = 1;
-                __rotate_left(M, node->parent);
-                u = node->parent->right;
+                parent->color = 1;
+                __rotate_left(M, parent);
+                u = parent->right;
             }
-            if (!u->left->color && !u->right->color) {
+            if (!__red(u->left) && !__red(u->right)) {
                 u->color = 1;
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (!u->right->color) {
+                if (!__red(u->right)) {
                     u->left->color = 0;
                     u->color = 1;
                     __rotate_right(M, u);
-                    u = node->parent->right;
+                    u = parent->right;
                 }
-                u->color = node->parent->color;
-                node->parent->color = 0;
+                u->color = parent->color;
+                parent->color = 0;
                 u->right->color = 0;
-                __rotate_left(M, node->parent);
+                __rotate_left(M, parent);
                 node = M->root;
             }
         } else {
-            u = node->parent->left;
+            u = parent->left;
             if (u->color) {
                 u->color = 0;
-                node->parent->color = 1;
-                __rotate_right(M, node->parent);
-                u = node->parent->left;
+                parent->color = 1;
+                __rotate_right(M, parent);
+                u = parent->left;
             }
-            if (!u->left->color && !u->right->color) {
+            if (!__red(u->left) && !__red(u->right)) {
                 u->color = 1;
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (!u->left->color) {
+                if (!__red(u->left)) {
                     u->right->color = 0;
                     u->color = 1;
                     __rotate_left(M, u);
-                    u = node->parent->left;
+                    u = parent->left;
                 }
-                u->color = node->parent->color;
-                node->parent->color = 0;
+                u->color = parent->color;
+                parent->color = 0;
                 u->left->color = 0;
-                __rotate_right(M, node->parent);
+                __rotate_right(M, parent);
                 node = M->root;
             }
         }
     }
-    node->color = 0;
+    if (node) node->color = 0;
 }
 
+#undef __red
 
-void map_delete(map_t *M, cmp_item_t key) {
-    struct map_node *node = (struct map_node*)_map_find(*M, key);
-    struct map_node *u, *v;
+// Detaches `node` from the tree and rebalances it
+static void __unlink(map_t *M, struct map_node *node) {
+    struct map_node *u, *v, *vp; // `v` takes the place of `u`, `vp` is its new parent
     int color;
 
-    if (!node) return;
+    if (M->ranked) {
+        // Every ancestor of the node which is physically removed loses one descendant
+        u = node->left && node->right ? __minimum(node->right) : node;
+        for (u = u->parent; u; u = u->parent) u->weight--;
+    }
 
     u = node;
     color = u->color;
     if (!node->left) {
         v = node->right;
+        vp = node->parent;
         __transplant(M, node, node->right);
     } else if (!node->right) {
         v = node->left;
+        vp = node->parent;
         __transplant(M, node, node->left);
     } else {
         u = __minimum(node->right);
         color = u->color;
         v = u->right;
-        if (u->parent == node) v->parent = u;
+        if (u->parent == node) vp = u;
         else {
+            vp = u->parent;
             __transplant(M, u, u->right);
-            u->right = node->right;
+            __store(u->right, node->right);
             u->right->parent = u;
         }
         __transplant(M, node, u);
-        u->left = node->left;
+        __store(u->left, node->left);
         u->left->parent = u;
         u->color = node->color;
+        u->weight = node->weight;
     }
 
-    if (!color) __delete_fix(M, v);
+    if (!color) __delete_fix(M, v, vp);
+
+    __store(M->size, M->size - 1);
+}
+
+struct map_node *map_unlink(map_t *M, cmp_item_t key) {
+    struct map_node *node = _map_find(*M, key);
+
+    if (node) __unlink(M, node);
+    return node;
+}
+
+void map_delete(map_t *M, cmp_item_t key) {
+    struct map_node *node = map_unlink(M, key);
+    if (node) map_node_free(M, node);
+}
+
+//
+// ---
+
+// ---
+// iteration
+
+static struct map_node *__maximum(struct map_node *node) {
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+struct map_node *map_first(map_t M) {
+    return __minimum(M.root);
+}
+
+struct map_node *map_last(map_t M) {
+    return __maximum(M.root);
+}
+
+struct map_node *map_next(struct map_node *node) {
+    if (node->right) return __minimum(node->right);
+
+    // Climb until we come from a left subtree
+    while (node->parent && node == node->parent->right) node = node->parent;
+    return node->parent;
+}
+
+struct map_node *map_prev(struct map_node *node) {
+    if (node->left) return __maximum(node->left);
+
+    // Climb until we come from a right subtree
+    while (node->parent && node == node->parent->left) node = node->parent;
+    return node->parent;
+}
+
+// Returns the first node whose key is greater than `key`, or greater or equal if `equal` is set
+static struct map_node *__bound(map_t M, cmp_item_t key, int equal) {
+    struct map_node *x = M.root;
+    struct map_node *out = 0;
+    size_t hops = 0;
+    int c;
+
+    while (x) {
+        hops++;
+        c = M.sgn_cmp(x->key, key);
+        if (c > 0 || (equal && c == 0)) {
+            out = x;
+            x = x->left;
+        } else {
+            x = x->right;
+        }
+    }
+
+    __stats_descent(M.stats, hops);
+    return out;
+}
+
+struct map_node *map_lower_bound(map_t M, cmp_item_t key) {
+    return __bound(M, key, 1);
+}
+
+struct map_node *map_upper_bound(map_t M, cmp_item_t key) {
+    return __bound(M, key, 0);
+}
+
+map_range_t map_range(map_t M, cmp_item_t lo, cmp_item_t hi) {
+    map_range_t R = {0, 0};
+    struct map_node *end;
+
+    R.first = __bound(M, lo, 1);
+    end = __bound(M, hi, 0);
+
+    // Empty unless the first node is before the end
+    if (!R.first || R.first == end || M.sgn_cmp(R.first->key, hi) > 0) {
+        R.first = 0;
+        return R;
+    }
+    R.last = end ? map_prev(end) : map_last(M);
+    return R;
+}
+
+struct map_node *map_range_next(map_range_t R, struct map_node *node) {
+    return node == R.last ? 0 : map_next(node);
+}
+
+struct map_node *map_range_prev(map_range_t R, struct map_node *node) {
+    return node == R.first ? 0 : map_prev(node);
+}
+
+//
+// ---
+
+// ---
+// order statistics
+
+static size_t __rank_init(struct map_node *node) {
+    if (!node) return 0;
+
+    node->weight = __rank_init(node->left) + __rank_init(node->right) + 1;
+    return node->weight;
+}
+
+void map_enable_rank(map_t *M) {
+    __rank_init(M->root);
+    M->ranked = 1;
+}
+
+struct map_node *map_select(map_t M, size_t k) {
+    struct map_node *x = M.root;
+    size_t w;
+
+    if (!M.ranked) {
+        for (x = map_first(M); x && k; k--) x = map_next(x);
+        return x;
+    }
+
+    while (x) {
+        w = __weight(x->left);
+        if (k < w) x = x->left;
+        else if (k == w) return x;
+        else {
+            k -= w + 1;
+            x = x->right;
+        }
+    }
+    return 0;
+}
 
-    free(cmp_item(node->value));
-    free(cmp_item(node->key));
-    free(node);
+size_t map_rank(map_t M, cmp_item_t key) {
+    struct map_node *x = M.root;
+    size_t out = 0;
+
+    if (!M.ranked) {
+        for (x = map_first(M); x && M.sgn_cmp(x->key, key) < 0; x = map_next(x)) out++;
+        return out;
+    }
+
+    while (x) {
+        if (M.sgn_cmp(x->key, key) < 0) {
+            out += __weight(x->left) + 1;
+            x = x->right;
+        } else {
+            x = x->left;
+        }
+    }
+    return out;
+}
+
+//
+// ---
+
+// ---
+// bulk loading
+
+// A key with its value, sorted by the key with `cmp_sort()`
+struct map_pair {
+    cmp_item_t key;
+    cmp_item_t value;
+};
+
+// Links `nodes[lo..hi)`, which are in key order, into a balanced subtree
+// Nodes at depth `red` are colored red, so that every path has the same number of black nodes
+static struct map_node *__build(struct map_node **nodes, size_t lo, size_t hi, struct map_node *parent, size_t depth, size_t red) {
+    struct map_node *node;
+    size_t mid;
+
+    if (lo == hi) return 0;
+
+    mid = lo + (hi - lo) / 2;
+    node = nodes[mid];
+    node->parent = parent;
+    node->color = depth == red;
+    node->weight = hi - lo;
+    node->left = __build(nodes, lo, mid, node, depth + 1, red);
+    node->right = __build(nodes, mid + 1, hi, node, depth + 1, red);
+    return node;
+}
+
+// Makes `nodes`, which are in key order, the whole tree of `M`
+// Halving the range keeps all empty leaves within the two deepest levels,
+// so coloring the deepest level of nodes red balances the tree without rotations
+static void __map_build(map_t *M, struct map_node **nodes, size_t n) {
+    size_t h = 0;
+
+    while ((n >> h) > 1) h++;
+
+    M->root = __build(nodes, 0, n, 0, 0, h ? h : (size_t)-1);
+    M->size = n;
+}
+
+// The number of pieces work is cut into, `MAP_SPLIT` per thread so that the threads which finish early steal the rest
+static size_t __split(pool_t *P) {
+    return pool_threads(P) > 1 ? pool_threads(P) * MAP_SPLIT : 1;
+}
+
+// A subtree left to the pool by `__build_top()`, its root is stored in `*link`
+struct map_subtree {
+    size_t lo;
+    size_t hi;
+    size_t depth;
+    struct map_node *parent;
+    struct map_node **link;
+};
+
+struct map_bulk {
+    cmp_item_t *keys;
+    cmp_item_t *values;
+    int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
+    uint8_t *keep;            // Whether each key is the first of its equals
+    size_t *at;               // The key of every node
+    struct map_node **nodes;  // Allocated on the calling thread, filled by the pool
+    size_t red;
+    struct map_subtree *subtrees;
+    size_t count;
+};
+
+static void __dedupe(void *arg, size_t lo, size_t hi) {
+    struct map_bulk *B = (struct map_bulk*)arg;
+
+    for (size_t i = lo; i < hi; i++) B->keep[i] = !i || B->sgn_cmp(B->keys[i - 1], B->keys[i]);
+}
+
+static void __fill(struct map_bulk *B, size_t i) {
+    cmp_item_t key = B->keys[B->at[i]], value = B->values[B->at[i]];
+
+    memcpy(B->nodes[i]->key.data, key.data, key.size);
+    memcpy(B->nodes[i]->value.data, value.data, value.size);
+}
+
+// Links the nodes above depth `cut` like `__build()` does, the subtrees at depth `cut` are only recorded
+static void __build_top(struct map_bulk *B, size_t lo, size_t hi, struct map_node *parent, struct map_node **link, size_t depth, size_t cut) {
+    struct map_node *node;
+    size_t mid;
+
+    if (lo == hi) {
+        *link = 0;
+        return;
+    }
+    if (depth == cut) {
+        B->subtrees[B->count++] = (struct map_subtree){lo, hi, depth, parent, link};
+        return;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    node = B->nodes[mid];
+    __fill(B, mid);
+    node->parent = parent;
+    node->color = depth == B->red;
+    node->weight = hi - lo;
+    *link = node;
+    __build_top(B, lo, mid, node, &node->left, depth + 1, cut);
+    __build_top(B, mid + 1, hi, node, &node->right, depth + 1, cut);
+}
+
+static void __build_subtrees(void *arg, size_t lo, size_t hi) {
+    struct map_bulk *B = (struct map_bulk*)arg;
+
+    for (size_t j = lo; j < hi; j++) {
+        struct map_subtree *T = &B->subtrees[j];
+
+        for (size_t i = T->lo; i < T->hi; i++) __fill(B, i);
+        *T->link = __build(B->nodes, T->lo, T->hi, T->parent, T->depth, B->red);
+    }
+}
+
+map_t map_from_sorted_parallel(cmp_item_t *keys, cmp_item_t *values, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), pool_t *P) {
+    map_t M = map_new_slab(sgn_cmp);
+    struct map_bulk B;
+    size_t i, m = 0, cut = 0, h = 0;
+    struct map_node *node;
+
+    B.keys = keys;
+    B.values = values;
+    B.sgn_cmp = sgn_cmp;
+    B.count = 0;
+    B.keep = (uint8_t*)malloc(n ? n : 1);
+    B.at = (size_t*)malloc((n ? n : 1) * sizeof(size_t));
+    B.nodes = (struct map_node**)malloc((n ? n : 1) * sizeof(struct map_node*));
+
+    // Keep the first of equal keys, like `map_insert()` does
+    pool_for(P, n, n / __split(P) + 1, __dedupe, &B);
+
+    // The slab isn't thread-safe, so only the allocations stay on the calling thread
+    slab_reserve(M.slab, sizeof(struct map_node), n);
+    for (i = 0; i < n; i++) {
+        if (!B.keep[i]) continue;
+
+        node = (struct map_node*)__alloc(&M, sizeof(struct map_node));
+        node->key = cmp_item_new(keys[i].size <= CMP_INLINE ? node->small_key : __alloc(&M, keys[i].size), keys[i].size);
+        node->value = cmp_item_new(values[i].size <= CMP_INLINE ? node->small_value : __alloc(&M, values[i].size), values[i].size);
+        B.nodes[m] = node;
+        B.at[m++] = i;
+    }
+
+    while ((m >> h) > 1) h++;
+    while (((size_t)1 << cut) < __split(P)) cut++;
+
+    B.red = h ? h : (size_t)-1;
+    B.subtrees = (struct map_subtree*)malloc(((size_t)1 << cut) * sizeof(struct map_subtree));
+    __build_top(&B, 0, m, 0, &M.root, 0, cut);
+    pool_for(P, B.count, 1, __build_subtrees, &B);
+    M.size = m;
+
+    free(B.subtrees);
+    free(B.nodes);
+    free(B.at);
+    free(B.keep);
+    return M;
+}
+
+map_t map_from_sorted(cmp_item_t *keys, cmp_item_t *values, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    return map_from_sorted_parallel(keys, values, n, sgn_cmp, 0);
+}
+
+map_t map_from_array(cmp_item_t *keys, cmp_item_t *values, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    struct map_pair *pairs = (struct map_pair*)malloc(n * sizeof(struct map_pair));
+    cmp_item_t *sorted = (cmp_item_t*)malloc(2 * n * sizeof(cmp_item_t));
+    size_t i;
+    map_t M;
+
+    for (i = 0; i < n; i++) {
+        pairs[i].key = keys[i];
+        pairs[i].value = values[i];
+    }
+    cmp_sort(pairs, n, sizeof(struct map_pair), sgn_cmp);
+
+    for (i = 0; i < n; i++) {
+        sorted[i] = pairs[i].key;
+        sorted[n + i] = pairs[i].value;
+    }
+
+    M = map_from_sorted(sorted, sorted + n, n, sgn_cmp);
+    free(sorted);
+    free(pairs);
+    return M;
+}
+
+//
+// ---
+
+// ---
+// batch updates
+//
+// A batch is sorted first, so each key is searched from the node of the previous one (a finger) instead of from the root:
+// the search climbs only as far as the smallest subtree which can hold the key, which costs O(log d) for keys d apart.
+// A batch at least as big as the tree is merged with it and the tree is rebuilt, without any rotation.
+
+// Returns the root of a small subtree whose key range holds `key`, starting from `x`
+// Keys come in ascending order, so `key` is greater than everything left of `x` and only the upper bounds are checked:
+// a key before the successor of `x` is found below `x`, otherwise the climb goes on from the successor
+static struct map_node *__finger(map_t *M, struct map_node *x, cmp_item_t key) {
+    struct map_node *next;
+    int c;
+
+    STATS_ADD(M->stats, compares, 1);
+    if (M->sgn_cmp(key, x->key) <= 0) return x;
+
+    next = map_next(x);
+    if (!next) return x;
+    STATS_ADD(M->stats, compares, 1);
+    if ((c = M->sgn_cmp(key, next->key)) < 0) return x;
+    if (!c) return next;
+
+    for (x = next; x->parent; x = x->parent) {
+        if (x == x->parent->left) {
+            STATS_ADD(M->stats, compares, 1);
+            if (M->sgn_cmp(key, x->parent->key) < 0) break;
+        }
+    }
+    return x;
+}
+
+// Merges sorted keys into the nodes of `M` and rebuilds it, in O(n + k)
+static void __merge_insert(map_t *M, struct map_pair *pairs, size_t k) {
+    struct map_node **nodes = (struct map_node**)malloc((M->size + k) * sizeof(struct map_node*));
+    struct map_node *x = map_first(*M);
+    size_t i = 0, m = 0;
+    int c;
+
+    while (x || i < k) {
+        c = !x ? 1 : i == k ? -1 : M->sgn_cmp(x->key, pairs[i].key);
+        if (c <= 0) {
+            // Present keys win over equal ones of the batch, as with `map_insert()`
+            nodes[m++] = x;
+            x = map_next(x);
+            i += !c;
+            continue;
+        }
+        if (!m || M->sgn_cmp(nodes[m - 1]->key, pairs[i].key)) nodes[m++] = map_node_new(M, pairs[i].key, pairs[i].value);
+        i++;
+    }
+
+    __map_build(M, nodes, m);
+    free(nodes);
+}
+
+void map_insert_batch(map_t *M, cmp_item_t *keys, cmp_item_t *values, size_t k) {
+    struct map_pair *pairs;
+    struct map_node *finger = 0, *par;
+    int c;
+
+    if (!k) return;
+    pairs = (struct map_pair*)malloc(k * sizeof(struct map_pair));
+    for (size_t i = 0; i < k; i++) {
+        pairs[i].key = keys[i];
+        pairs[i].value = values[i];
+    }
+    cmp_sort(pairs, k, sizeof(struct map_pair), M->sgn_cmp);
+
+    if (M->slab) slab_reserve(M->slab, sizeof(struct map_node), k);
+
+    if (k >= M->size) __merge_insert(M, pairs, k);
+    else for (size_t i = 0; i < k; i++) {
+        par = __find_parent(M, finger ? __finger(M, finger, pairs[i].key) : M->root, pairs[i].key, &c);
+        if (!c) finger = par;
+        else finger = __link(M, par, c, pairs[i].key, pairs[i].value);
+    }
+
+    free(pairs);
+}
+
+// Drops the nodes whose keys are among the sorted `keys` and rebuilds `M` from the rest, in O(n + k)
+static void __merge_delete(map_t *M, cmp_item_t *keys, size_t k) {
+    struct map_node **nodes = (struct map_node**)malloc(M->size * sizeof(struct map_node*));
+    struct map_node *x = map_first(*M);
+    size_t i = 0, m = 0, d = M->size;
+    int c = 1;
+
+    // Deleted nodes are collected at the end of `nodes`, the walk still needs their parent pointers
+    for (; x; x = map_next(x)) {
+        while (i < k && (c = M->sgn_cmp(keys[i], x->key)) < 0) i++;
+        if (i < k && !c) nodes[--d] = x;
+        else nodes[m++] = x;
+    }
+
+    for (i = d; i < M->size; i++) map_node_free(M, nodes[i]);
+    __map_build(M, nodes, m);
+    free(nodes);
+}
+
+void map_delete_batch(map_t *M, cmp_item_t *keys, size_t k) {
+    cmp_item_t *sorted;
+    struct map_node *finger = 0, *node;
+
+    if (!k || !M->root) return;
+    sorted = (cmp_item_t*)malloc(k * sizeof(cmp_item_t));
+    memcpy(sorted, keys, k * sizeof(cmp_item_t));
+    cmp_sort(sorted, k, sizeof(cmp_item_t), M->sgn_cmp);
+
+    if (k >= M->size) __merge_delete(M, sorted, k);
+    else for (size_t i = 0; i < k; i++) {
+        node = __map_find(finger ? __finger(M, finger, sorted[i]) : M->root, sorted[i], M->sgn_cmp, M->stats);
+        if (!node) continue;
+
+        // Deleting relinks nodes instead of moving keys between them, so the successor stays valid as the next finger
+        finger = map_next(node);
+        __unlink(M, node);
+        map_node_free(M, node);
+        if (!finger) break;
+    }
+
+    free(sorted);
+}
+
+//
+// ---
+
+// ---
+// for_each
+//
+// A tree is cut at the depth which leaves about `MAP_SPLIT` subtrees per thread. Each subtree is a piece of work,
+// and so is each node above them, so threads which finish early steal whole subtrees.
+
+struct map_piece {
+    struct map_node *node;
+    int whole; // Whether the piece is the subtree of `node` or `node` alone
+};
+
+static size_t __cut(struct map_node *x, size_t depth, struct map_piece *pieces, size_t n) {
+    if (!x) return n;
+    if (!depth) {
+        pieces[n++] = (struct map_piece){x, 1};
+        return n;
+    }
+
+    n = __cut(x->left, depth - 1, pieces, n);
+    pieces[n++] = (struct map_piece){x, 0};
+    return __cut(x->right, depth - 1, pieces, n);
+}
+
+static void __walk(struct map_node *x, void (*fn)(struct map_node *node, void *arg), void *arg) {
+    if (!x) return;
+    __walk(x->left, fn, arg);
+    fn(x, arg);
+    __walk(x->right, fn, arg);
+}
+
+struct map_each {
+    struct map_piece *pieces;
+    void (*fn)(struct map_node *node, void *arg);
+    void *arg;
+};
+
+static void __each(void *arg, size_t lo, size_t hi) {
+    struct map_each *E = (struct map_each*)arg;
+
+    for (size_t i = lo; i < hi; i++) {
+        if (E->pieces[i].whole) __walk(E->pieces[i].node, E->fn, E->arg);
+        else E->fn(E->pieces[i].node, E->arg);
+    }
+}
+
+void map_for_each(map_t M, void (*fn)(struct map_node *node, void *arg), void *arg, pool_t *P) {
+    struct map_each E = {0, fn, arg};
+    size_t n, depth = 0;
+
+    while (((size_t)1 << depth) < __split(P)) depth++;
+
+    E.pieces = (struct map_piece*)malloc(((size_t)2 << depth) * sizeof(struct map_piece));
+    n = __cut(M.root, depth, E.pieces, 0);
+    pool_for(P, n, 1, __each, &E);
+    free(E.pieces);
+}
+
+//
+// ---
+
+// ---
+// map_free
+
+static void __map_free(map_t *M, struct map_node *node) {
+    if (!node) return;
+    __map_free(M, node->left);
+    __map_free(M, node->right);
+    map_node_free(M, node);
+}
+
+void map_free(map_t *M) {
+    // A slab releases all of its nodes at once
+    if (M->slab) slab_destroy(M->slab);
+    else __map_free(M, M->root);
+
+    stats_free(M->stats);
+    M->root = 0;
+    M->size = 0;
+    M->slab = 0;
+    M->stats = 0;
+}
 
-    M->size--;
+struct ctypes_stats map_stats(map_t M) {
+    return stats_read(M.stats);
 }
 
 //
@@ -2,30 +2,60 @@
 #ifndef _MAP_PAVA_H
 #define _MAP_PAVA_H
 #include "comparator.h"
+#include "slab.h"
+#include "stats.h"
 
 #include <stdlib.h> // size_t
+#include <limits.h> // CHAR_BIT
+
+// The thread pool the parallel calls run on, defined in pool.h
+typedef struct pool pool_t;
+
+// The number of lookups `map_find_many()` keeps in flight
+#define MAP_BATCH 16
+
+// The number of pieces per thread the parallel calls cut their work into, so threads which finish early steal the rest
+#define MAP_SPLIT 8
 
 struct map_node {
     struct map_node *left;
     struct map_node *right;
     struct map_node *parent;
-    int color;
+    size_t color : 1;
+    size_t weight : sizeof(size_t) * CHAR_BIT - 1; // The number of nodes in this subtree, maintained if the tree is ranked
 
     cmp_item_t key;
     cmp_item_t value;
+
+    uint8_t small_key[CMP_INLINE];   // The key's data when it fits
+    uint8_t small_value[CMP_INLINE]; // The value's data when it fits
 };
 
 struct map {
     struct map_node *root;
     int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
     size_t size;
+    slab_t *slab; // Nodes, keys and values are allocated from here if it's not zero
+    int ranked;   // Whether subtree weights are maintained, see `map_enable_rank()`
+    struct ctypes_counters *stats; // Hot-path counters, zero unless built with CTYPES_STATS (see stats.h)
 };
 
 typedef struct map map_t;
 
+// A range of nodes in key order, from `first` to `last` (both included, or both zero if the range is empty)
+struct map_range {
+    struct map_node *first;
+    struct map_node *last;
+};
+
+typedef struct map_range map_range_t;
+
 // Returns a properly initialised `map_t`. Takes signum comparator as an argument
 extern map_t map_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
 
+// Returns a properly initialised `map_t` which allocates its nodes from its own slab allocator
+extern map_t map_new_slab(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
 // Returns the number of elements
 extern size_t map_size(map_t M);
 
@@ -35,8 +65,99 @@ extern void map_insert(map_t *M, cmp_item_t key, cmp_item_t value);
 // Deletes an element with a specified key from the map
 extern void map_delete(map_t *M, cmp_item_t key);
 
+// Same as `map_delete()`, but returns the detached node instead of freeing it (0 if the key is missing)
+// The node's key and value stay allocated the way `map_insert()` left them
+extern struct map_node *map_unlink(map_t *M, cmp_item_t key);
+
+// Inserts `k` keys with their values at once, sorting them first (the first of equal keys is inserted, as with `map_insert()`)
+// Each key is searched from the node of the previous one, and a batch at least as big as the map rebuilds it without rotations
+extern void map_insert_batch(map_t *M, cmp_item_t *keys, cmp_item_t *values, size_t k);
+
+// Deletes `k` keys at once, the same way `map_insert_batch()` inserts them
+extern void map_delete_batch(map_t *M, cmp_item_t *keys, size_t k);
+
 // Accesses an an element with a specified key in the tree
 extern cmp_item_t *map_find(map_t M, cmp_item_t key);
 
+// Looks up `n` keys at once, storing the value of each of them in `values` (0 for missing keys)
+// Returns the number of keys present. Lookups are interleaved `MAP_BATCH` at a time to overlap their cache misses
+extern size_t map_find_many(map_t M, cmp_item_t *keys, size_t n, cmp_item_t **values);
+
+// ---
+// Order statistics
+//
+// Ranked trees keep the size of every subtree, so selecting and ranking take O(log n).
+// Without it both functions fall back to walking the nodes in order.
+
+// Starts maintaining subtree weights, in O(n)
+extern void map_enable_rank(map_t *M);
+
+// Accesses the node with the `k`-th smallest key, counting from 0 (0 if there are not enough nodes)
+extern struct map_node *map_select(map_t M, size_t k);
+
+// Returns the number of keys less than `key`
+extern size_t map_rank(map_t M, cmp_item_t key);
+
+//
+// ---
+
+// ---
+// Iteration
+//
+// Nodes are visited in key order through their parent pointers, without allocations.
+// A node stays valid until it is deleted.
+
+// Accesses the node with the smallest key (0 if the map is empty)
+extern struct map_node *map_first(map_t M);
+
+// Accesses the node with the greatest key (0 if the map is empty)
+extern struct map_node *map_last(map_t M);
+
+// Accesses the node following `node` in key order (0 if it's the last one)
+extern struct map_node *map_next(struct map_node *node);
+
+// Accesses the node preceding `node` in key order (0 if it's the first one)
+extern struct map_node *map_prev(struct map_node *node);
+
+// Accesses the first node whose key is not less than `key` (0 if there is none)
+extern struct map_node *map_lower_bound(map_t M, cmp_item_t key);
+
+// Accesses the first node whose key is greater than `key` (0 if there is none)
+extern struct map_node *map_upper_bound(map_t M, cmp_item_t key);
+
+// Returns the range of nodes whose keys are between `lo` and `hi` (both included)
+extern map_range_t map_range(map_t M, cmp_item_t lo, cmp_item_t hi);
+
+// Accesses the node following `node` in the range (0 if it's the last one)
+extern struct map_node *map_range_next(map_range_t R, struct map_node *node);
+
+// Accesses the node preceding `node` in the range (0 if it's the first one)
+extern struct map_node *map_range_prev(map_range_t R, struct map_node *node);
+
+// Calls `fn(node, arg)` on every node, spread over the threads of `P` by subtree (a zero pool visits them in key order)
+// `fn` may run on several nodes at once, it may change values in place but must not insert or delete
+extern void map_for_each(map_t M, void (*fn)(struct map_node *node, void *arg), void *arg, pool_t *P);
+
+//
+// ---
+
+// Builds a map from `n` keys sorted in ascending order and their values, in O(n) and without rotations
+// The nodes are allocated contiguously from the map's own slab, and only the first of equal keys is inserted
+extern map_t map_from_sorted(cmp_item_t *keys, cmp_item_t *values, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// Same as `map_from_sorted()`, but spreads comparing, copying and linking the keys over the threads of `P`
+// (The nodes are still allocated on the calling thread, the slab isn't thread-safe)
+extern map_t map_from_sorted_parallel(cmp_item_t *keys, cmp_item_t *values, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), pool_t *P);
+
+// Same as `map_from_sorted()`, but sorts the keys (with their values) first
+extern map_t map_from_array(cmp_item_t *keys, cmp_item_t *values, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// Returns the hot-path counters of `M` (all zero unless built with CTYPES_STATS)
+extern struct ctypes_stats map_stats(map_t M);
+
+// Removes all elements and releases the memory held by the map
+// (Releases the whole slab at once if the map has one)
+extern void map_free(map_t *M);
+
 
 #endif
\ No newline at end of file
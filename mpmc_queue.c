@@ -0,0 +1,251 @@
+// It's licensed under MIT, btw
+#define _GNU_SOURCE
+#include "mpmc_queue.h"
+
+#include <stddef.h> // size_t
+#include <string.h> // memcpy() and memset()
+#include <stdlib.h> // aligned_alloc(), malloc() and free()
+#include <limits.h> // INT_MAX
+
+#ifdef __linux__
+#include <unistd.h>        // syscall()
+#include <sys/syscall.h>   // SYS_futex
+#include <linux/futex.h>   // FUTEX_WAIT_PRIVATE and FUTEX_WAKE_PRIVATE
+#endif
+
+#define MPMC_QUEUE_MIN 2
+
+// ---
+// event helpers
+//
+// A sleeper reads the epoch, registers itself in `waiters` and re-checks the queue before sleeping.
+// A waker changes the queue first and only touches the epoch when someone is registered,
+// so the fast path never writes to a shared line.
+
+static void __event_init(struct mpmc_event *E) {
+    atomic_init(&E->epoch, 0);
+    atomic_init(&E->waiters, 0);
+#ifndef __linux__
+    pthread_mutex_init(&E->lock, 0);
+    pthread_cond_init(&E->cond, 0);
+#endif
+}
+
+static void __event_destroy(struct mpmc_event *E) {
+#ifndef __linux__
+    pthread_mutex_destroy(&E->lock);
+    pthread_cond_destroy(&E->cond);
+#else
+    (void)E;
+#endif
+}
+
+// Returns the epoch to sleep on, the caller must re-check its condition afterwards
+static unsigned __event_prepare(struct mpmc_event *E) {
+    unsigned epoch = atomic_load_explicit(&E->epoch, memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&E->waiters, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    return epoch;
+}
+
+static void __event_cancel(struct mpmc_event *E) {
+    atomic_fetch_sub_explicit(&E->waiters, 1, memory_order_relaxed);
+}
+
+static void __event_wait(struct mpmc_event *E, unsigned epoch) {
+#ifdef __linux__
+    syscall(SYS_futex, (unsigned*)&E->epoch, FUTEX_WAIT_PRIVATE, epoch, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&E->lock);
+    while (atomic_load_explicit(&E->epoch, memory_order_relaxed) == epoch)
+        pthread_cond_wait(&E->cond, &E->lock);
+    pthread_mutex_unlock(&E->lock);
+#endif
+    __event_cancel(E);
+}
+
+static void __event_signal(struct mpmc_event *E) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&E->waiters, memory_order_relaxed)) return;
+
+#ifdef __linux__
+    atomic_fetch_add_explicit(&E->epoch, 1, memory_order_relaxed);
+    syscall(SYS_futex, (unsigned*)&E->epoch, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&E->lock);
+    atomic_fetch_add_explicit(&E->epoch, 1, memory_order_relaxed);
+    pthread_cond_broadcast(&E->cond);
+    pthread_mutex_unlock(&E->lock);
+#endif
+}
+
+// ---
+
+// ---
+// cell helpers
+//
+// Every cell starts with its sequence number and the size of its item, followed by the payload.
+// A cell at position `pos` is free for a push when its sequence is `pos`,
+// and holds an item for a pop when its sequence is `pos + 1`.
+
+struct mpmc_cell {
+    atomic_size_t seq;
+    size_t size;
+};
+
+static struct mpmc_cell *__cell_at(mpmc_queue_t *Q, size_t pos) {
+    return (struct mpmc_cell*)(Q->cells + (pos & (Q->capacity - 1)) * Q->stride);
+}
+
+static uint8_t *__cell_data(struct mpmc_cell *cell) {
+    return (uint8_t*)cell + sizeof(struct mpmc_cell);
+}
+
+static size_t __round_up(size_t x, size_t to) {
+    return (x + to - 1) / to * to;
+}
+
+// ---
+
+mpmc_queue_t *mpmc_queue_new(size_t capacity, size_t slot) {
+    mpmc_queue_t *Q = (mpmc_queue_t*)aligned_alloc(MPMC_CACHE_LINE, __round_up(sizeof(mpmc_queue_t), MPMC_CACHE_LINE));
+    size_t n = MPMC_QUEUE_MIN;
+
+    while (n < capacity) n <<= 1;
+    if (slot < sizeof(void*)) slot = sizeof(void*);
+
+    atomic_init(&Q->head, 0);
+    atomic_init(&Q->tail, 0);
+    Q->capacity = n;
+    Q->slot = slot;
+    Q->stride = sizeof(struct mpmc_cell) + __round_up(slot, sizeof(size_t));
+    Q->cells = (uint8_t*)aligned_alloc(MPMC_CACHE_LINE, __round_up(n * Q->stride, MPMC_CACHE_LINE));
+
+    for (size_t i = 0; i < n; i++)
+        atomic_init(&__cell_at(Q, i)->seq, i);
+
+    __event_init(&Q->not_empty);
+    __event_init(&Q->not_full);
+    return Q;
+}
+
+size_t mpmc_queue_size(mpmc_queue_t *Q) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&Q->head, memory_order_relaxed);
+
+    // The indices are read one after another, so they may briefly look inverted
+    if (head <= tail) return 0;
+    if (head - tail > Q->capacity) return Q->capacity;
+    return head - tail;
+}
+
+int mpmc_queue_try_push(mpmc_queue_t *Q, void *item, size_t size) {
+    size_t pos = atomic_load_explicit(&Q->head, memory_order_relaxed);
+    struct mpmc_cell *cell;
+
+    for (;;) {
+        cell = __cell_at(Q, pos);
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)(seq - pos);
+
+        if (!diff) {
+            if (atomic_compare_exchange_weak_explicit(&Q->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return 0; // The cell still holds an item from the previous lap
+        } else {
+            pos = atomic_load_explicit(&Q->head, memory_order_relaxed);
+        }
+    }
+
+    cell->size = size;
+    if (size > Q->slot) {
+        void *copy = malloc(size);
+        memcpy(copy, item, size);
+        memcpy(__cell_data(cell), &copy, sizeof(void*));
+    } else {
+        memcpy(__cell_data(cell), item, size);
+    }
+
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    __event_signal(&Q->not_empty);
+    return 1;
+}
+
+int mpmc_queue_try_pop(mpmc_queue_t *Q, void *item, size_t *size) {
+    size_t pos = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+    struct mpmc_cell *cell;
+
+    for (;;) {
+        cell = __cell_at(Q, pos);
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)(seq - (pos + 1));
+
+        if (!diff) {
+            if (atomic_compare_exchange_weak_explicit(&Q->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return 0; // No item has been published in this cell yet
+        } else {
+            pos = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+        }
+    }
+
+    size_t n = cell->size < *size ? cell->size : *size;
+    if (cell->size > Q->slot) {
+        void *copy;
+        memcpy(&copy, __cell_data(cell), sizeof(void*));
+        memcpy(item, copy, n);
+        free(copy);
+    } else {
+        memcpy(item, __cell_data(cell), n);
+    }
+    *size = cell->size;
+
+    // Hand the cell over to the push one lap ahead
+    atomic_store_explicit(&cell->seq, pos + Q->capacity, memory_order_release);
+    __event_signal(&Q->not_full);
+    return 1;
+}
+
+void mpmc_queue_push(mpmc_queue_t *Q, void *item, size_t size) {
+    while (!mpmc_queue_try_push(Q, item, size)) {
+        unsigned epoch = __event_prepare(&Q->not_full);
+
+        if (mpmc_queue_try_push(Q, item, size)) {
+            __event_cancel(&Q->not_full);
+            return;
+        }
+        __event_wait(&Q->not_full, epoch);
+    }
+}
+
+void mpmc_queue_pop(mpmc_queue_t *Q, void *item, size_t *size) {
+    while (!mpmc_queue_try_pop(Q, item, size)) {
+        unsigned epoch = __event_prepare(&Q->not_empty);
+
+        if (mpmc_queue_try_pop(Q, item, size)) {
+            __event_cancel(&Q->not_empty);
+            return;
+        }
+        __event_wait(&Q->not_empty, epoch);
+    }
+}
+
+void mpmc_queue_free(mpmc_queue_t *Q) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&Q->head, memory_order_relaxed);
+
+    for (size_t pos = tail; pos != head; pos++) {
+        struct mpmc_cell *cell = __cell_at(Q, pos);
+        if (cell->size > Q->slot) {
+            void *copy;
+            memcpy(&copy, __cell_data(cell), sizeof(void*));
+            free(copy);
+        }
+    }
+
+    __event_destroy(&Q->not_empty);
+    __event_destroy(&Q->not_full);
+    free(Q->cells);
+    free(Q);
+}
\ No newline at end of file
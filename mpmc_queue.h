@@ -0,0 +1,71 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_MPMC_QUEUE_H
+#define _CTYPES_MPMC_QUEUE_H
+
+#include <stdlib.h>    // size_t
+#include <stdint.h>    // uint8_t
+#include <stdatomic.h> // atomic_size_t and atomic_uint
+
+#ifndef __linux__
+#include <pthread.h>   // pthread_mutex_t and pthread_cond_t
+#endif
+
+// The size of a cache line, hot indices are kept on separate ones
+#define MPMC_CACHE_LINE 64
+
+// Lets blocked threads sleep until something changes, without a lock on the fast path
+struct mpmc_event {
+    atomic_uint epoch;   // Changes whenever sleeping threads should re-check
+    atomic_uint waiters; // The number of threads which are about to sleep or sleeping
+#ifndef __linux__
+    pthread_mutex_t lock; // Sleeping goes through a condition variable where there is no futex
+    pthread_cond_t cond;
+#endif
+};
+
+// A bounded multi-producer/multi-consumer queue, obtained with `mpmc_queue_new()`
+// Every cell carries a sequence number telling whether it's ready to be written or read,
+// so producers and consumers only contend on their own index
+struct mpmc_queue {
+    _Alignas(MPMC_CACHE_LINE) atomic_size_t head; // The position of the next push
+    _Alignas(MPMC_CACHE_LINE) atomic_size_t tail; // The position of the next pop
+
+    _Alignas(MPMC_CACHE_LINE) size_t capacity; // The number of cells (a power of two)
+    size_t slot;   // The number of payload bytes stored inline in every cell
+    size_t stride; // The size of a cell
+    uint8_t *cells;
+
+    struct mpmc_event not_empty;
+    struct mpmc_event not_full;
+};
+
+typedef struct mpmc_queue mpmc_queue_t;
+
+
+// Returns a new queue with room for at least `capacity` items
+// Items up to `slot` bytes are stored inline, bigger ones are allocated separately
+extern mpmc_queue_t *mpmc_queue_new(size_t capacity, size_t slot);
+
+// Returns the number of elements (only a snapshot if other threads are using the queue)
+extern size_t mpmc_queue_size(mpmc_queue_t *Q);
+
+// Copies an element to the end of the queue
+// Returns 0 if the queue is full
+extern int mpmc_queue_try_push(mpmc_queue_t *Q, void *item, size_t size);
+
+// Moves the first element into `item`, which has room for `*size` bytes, and stores its real size in `*size`
+// (Bigger elements are truncated)
+// Returns 0 if the queue is empty
+extern int mpmc_queue_try_pop(mpmc_queue_t *Q, void *item, size_t *size);
+
+// Same as `mpmc_queue_try_push()`, but sleeps while the queue is full
+extern void mpmc_queue_push(mpmc_queue_t *Q, void *item, size_t size);
+
+// Same as `mpmc_queue_try_pop()`, but sleeps while the queue is empty
+extern void mpmc_queue_pop(mpmc_queue_t *Q, void *item, size_t *size);
+
+// Releases the queue and the elements left in it
+// No other thread may be using the queue
+extern void mpmc_queue_free(mpmc_queue_t *Q);
+
+#endif
\ No newline at end of file
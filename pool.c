@@ -0,0 +1,209 @@
+// It's licensed under MIT, btw
+#define _POSIX_C_SOURCE 200809L // sysconf()
+
+#include "pool.h"
+
+#include <stdlib.h> // aligned_alloc() and free()
+#include <unistd.h> // sysconf()
+#include <sched.h>  // sched_yield()
+
+// A call of `pool_for()`, living on the stack of its caller until every index is done
+struct pool_job {
+    void (*fn)(void *arg, size_t lo, size_t hi);
+    void *arg;
+    size_t grain;
+    atomic_size_t pending; // The number of indices not done yet
+};
+
+// A range of a job, copied in and out of the deques
+struct pool_task {
+    struct pool_job *job;
+    size_t lo;
+    size_t hi;
+};
+
+// The worker the current thread runs as, zero outside of any pool
+static _Thread_local struct pool_worker *__self;
+
+// ---
+// sleeping
+//
+// A worker registers as a sleeper before its last look at the deques, and a thread pushing work
+// checks for sleepers after publishing it. Either the worker sees the work or the pusher sees the worker.
+
+static int __has_work(pool_t *P) {
+    for (size_t i = 0; i < P->threads; i++) {
+        if (!ws_deque_empty(P->workers[i].tasks)) return 1;
+    }
+    return 0;
+}
+
+static void __wake(pool_t *P) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&P->sleepers, memory_order_relaxed)) return;
+
+    pthread_mutex_lock(&P->lock);
+    P->epoch++;
+    pthread_cond_signal(&P->wake);
+    pthread_mutex_unlock(&P->lock);
+}
+
+static void __sleep(pool_t *P) {
+    unsigned epoch;
+
+    pthread_mutex_lock(&P->lock);
+    epoch = P->epoch;
+    atomic_fetch_add(&P->sleepers, 1);
+    while (!atomic_load(&P->stop) && epoch == P->epoch && !__has_work(P)) pthread_cond_wait(&P->wake, &P->lock);
+    atomic_fetch_sub(&P->sleepers, 1);
+    pthread_mutex_unlock(&P->lock);
+}
+
+//
+// ---
+
+// ---
+// running
+
+// Splits `t` in halves until it fits the grain, leaving the upper halves to thieves, then runs it
+static void __run(pool_t *P, struct pool_worker *W, struct pool_task t) {
+    struct pool_task right;
+    size_t n;
+
+    while (t.hi - t.lo > t.job->grain) {
+        right = (struct pool_task){t.job, t.lo + (t.hi - t.lo) / 2, t.hi};
+        ws_deque_push_back(W->tasks, &right, sizeof(right));
+        __wake(P);
+        t.hi = right.lo;
+    }
+
+    n = t.hi - t.lo;
+    t.job->fn(t.job->arg, t.lo, t.hi);
+    // Releases the results of `fn` to the thread waiting for the job
+    atomic_fetch_sub_explicit(&t.job->pending, n, memory_order_acq_rel);
+}
+
+// Takes the newest range of `W`, or steals the oldest (and biggest) one of another worker
+static int __find(pool_t *P, struct pool_worker *W, struct pool_task *t) {
+    size_t size = sizeof(*t);
+
+    if (ws_deque_pop_back(W->tasks, t, &size)) return 1;
+    for (size_t i = 1; i < P->threads; i++) {
+        size = sizeof(*t);
+        if (ws_deque_pop_front(P->workers[(W->id + i) % P->threads].tasks, t, &size)) return 1;
+    }
+    return 0;
+}
+
+static void *__worker(void *arg) {
+    struct pool_worker *W = (struct pool_worker*)arg;
+    pool_t *P = W->pool;
+    struct pool_task t;
+    size_t idle = 0;
+
+    __self = W;
+    while (!atomic_load_explicit(&P->stop, memory_order_acquire)) {
+        if (__find(P, W, &t)) {
+            __run(P, W, t);
+            idle = 0;
+        } else if (++idle < POOL_SPIN) {
+            sched_yield();
+        } else {
+            __sleep(P);
+            idle = 0;
+        }
+    }
+    return 0;
+}
+
+//
+// ---
+
+pool_t *pool_new(size_t threads) {
+    pool_t *P = (pool_t*)malloc(sizeof(pool_t));
+    long cpus;
+    size_t i;
+
+    // sysconf() returns -1 when the number of CPUs is unknown
+    if (!threads) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : (size_t)cpus;
+    }
+
+    P->threads = threads;
+    P->workers = (struct pool_worker*)aligned_alloc(POOL_CACHE_LINE, threads * sizeof(struct pool_worker));
+    pthread_mutex_init(&P->caller, 0);
+    pthread_mutex_init(&P->lock, 0);
+    pthread_cond_init(&P->wake, 0);
+    P->epoch = 0;
+    atomic_init(&P->sleepers, 0);
+    atomic_init(&P->stop, 0);
+
+    for (i = 0; i < threads; i++) {
+        P->workers[i].tasks = ws_deque_new_inline(0, sizeof(struct pool_task));
+        P->workers[i].pool = P;
+        P->workers[i].id = i;
+    }
+    for (i = 0; i + 1 < threads; i++) pthread_create(&P->workers[i].thread, 0, __worker, &P->workers[i]);
+    return P;
+}
+
+size_t pool_threads(pool_t *P) {
+    return P ? P->threads : 1;
+}
+
+void pool_for(pool_t *P, size_t n, size_t grain, void (*fn)(void *arg, size_t lo, size_t hi), void *arg) {
+    struct pool_job job;
+    struct pool_worker *W = __self && __self->pool == P ? __self : 0;
+    struct pool_worker *outer = __self;
+    struct pool_task t;
+
+    if (!n) return;
+    if (!P || P->threads == 1) {
+        fn(arg, 0, n);
+        return;
+    }
+
+    // Outside threads share the last slot, one at a time
+    if (!W) {
+        pthread_mutex_lock(&P->caller);
+        W = &P->workers[P->threads - 1];
+        __self = W;
+    }
+    job.fn = fn;
+    job.arg = arg;
+    job.grain = grain ? grain : 1;
+    atomic_init(&job.pending, n);
+
+    __run(P, W, (struct pool_task){&job, 0, n});
+    // Help with whatever is left, which may include ranges of other jobs when nested
+    while (atomic_load_explicit(&job.pending, memory_order_acquire)) {
+        if (__find(P, W, &t)) __run(P, W, t);
+        else sched_yield();
+    }
+
+    if (__self != outer) {
+        __self = outer;
+        pthread_mutex_unlock(&P->caller);
+    }
+}
+
+void pool_free(pool_t *P) {
+    size_t i;
+
+    if (!P) return;
+
+    pthread_mutex_lock(&P->lock);
+    atomic_store_explicit(&P->stop, 1, memory_order_release);
+    pthread_cond_broadcast(&P->wake);
+    pthread_mutex_unlock(&P->lock);
+
+    for (i = 0; i + 1 < P->threads; i++) pthread_join(P->workers[i].thread, 0);
+    for (i = 0; i < P->threads; i++) ws_deque_free(P->workers[i].tasks);
+
+    pthread_mutex_destroy(&P->caller);
+    pthread_mutex_destroy(&P->lock);
+    pthread_cond_destroy(&P->wake);
+    free(P->workers);
+    free(P);
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_POOL_H
+#define _CTYPES_POOL_H
+
+#include <stddef.h>    // size_t
+#include <stdatomic.h> // atomic_size_t, atomic_uint and atomic_int
+#include <pthread.h>   // pthread_t, pthread_mutex_t and pthread_cond_t
+
+#include "ws_deque.h"
+
+// The size of a cache line, every worker starts on its own
+#define POOL_CACHE_LINE 64
+
+// The number of times an idle worker looks for work before it goes to sleep
+#define POOL_SPIN 64
+
+// One thread of the pool with the deque of ranges it splits and runs, thieves take from the front
+struct pool_worker {
+    _Alignas(POOL_CACHE_LINE) ws_deque_t *tasks;
+    pthread_t thread;
+    struct pool *pool;
+    size_t id;
+};
+
+// A fixed set of worker threads running `pool_for()` ranges, obtained with `pool_new()`
+struct pool {
+    size_t threads;              // The number of workers, the calling thread included
+    struct pool_worker *workers; // `threads - 1` threads, then the slot of the thread calling `pool_for()` from outside
+    pthread_mutex_t caller;      // Held by the thread calling `pool_for()` from outside
+    pthread_mutex_t lock;        // Guards sleeping
+    pthread_cond_t wake;
+    unsigned epoch;              // Bumped under `lock` whenever sleepers are woken up
+    atomic_size_t sleepers;
+    atomic_int stop;
+};
+
+typedef struct pool pool_t;
+
+// Starts a pool of `threads` threads, the thread calling `pool_for()` counts as one of them
+// 0 stands for the number of online CPUs
+extern pool_t *pool_new(size_t threads);
+
+// Returns the number of threads working on every `pool_for()` call, 1 for a zero pool
+extern size_t pool_threads(pool_t *P);
+
+// Calls `fn(arg, lo, hi)` on ranges covering [0, `n`) of at most `grain` indices (1 if it's 0), then returns
+// The ranges are split in halves on demand and idle threads steal the biggest ones left, the caller works too.
+// A zero pool runs `fn(arg, 0, n)` on the calling thread. Calls may be nested from inside `fn`,
+// outside threads calling at the same time take turns
+extern void pool_for(pool_t *P, size_t n, size_t grain, void (*fn)(void *arg, size_t lo, size_t hi), void *arg);
+
+// Stops the threads and releases the pool, no `pool_for()` may be running
+extern void pool_free(pool_t *P);
+
+#endif
\ No newline at end of file
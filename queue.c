@@ -5,14 +5,67 @@
 #include <string.h> // memcpy()
 #include <stdlib.h> // malloc() and free()
 
+#define QUEUE_RING_MIN 16
 
+// ---
+// ring-buffer helpers
+//
+// Every slot starts with the size of its item, followed by the payload.
+// Items that do not fit into `slot` bytes keep a pointer to a separate copy instead.
+
+static size_t __stride(queue_t Q) {
+    return sizeof(size_t) + (Q.slot + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+}
+
+static uint8_t *__slot_at(queue_t Q, size_t i) {
+    return Q.ring + ((Q.first + i) & (Q.capacity - 1)) * __stride(Q);
+}
+
+static void *__slot_item(queue_t Q, uint8_t *slot) {
+    size_t size;
+
+    memcpy(&size, slot, sizeof(size_t));
+    if (size > Q.slot) return *(void**)(slot + sizeof(size_t));
+    return slot + sizeof(size_t);
+}
+
+static void __ring_grow(queue_t *Q) {
+    size_t stride = __stride(*Q);
+    size_t capacity = Q->capacity ? Q->capacity * 2 : QUEUE_RING_MIN;
+    uint8_t *ring = (uint8_t*)malloc(capacity * stride);
+
+    // Unwrap the elements so that the first one lands at index 0
+    if (Q->size) {
+        size_t n = Q->capacity - Q->first;
+        if (n > Q->size) n = Q->size;
+
+        memcpy(ring, Q->ring + Q->first * stride, n * stride);
+        memcpy(ring + n * stride, Q->ring, (Q->size - n) * stride);
+    }
+
+    free(Q->ring);
+    Q->ring = ring;
+    Q->capacity = capacity;
+    Q->first = 0;
+}
+
+//
+// ---
 
 queue_t queue_new() {
-    return (queue_t){0, 0, 0};
+    return (queue_t){0};
+}
+
+queue_t queue_new_ring(size_t slot) {
+    queue_t Q = queue_new();
+
+    // An oversized item stores a pointer in its slot, so there must be room for one
+    Q.slot = slot < sizeof(void*) ? sizeof(void*) : slot;
+    return Q;
 }
 
 int queue_empty(queue_t Q) {
-    return !(Q.head);
+    return !(Q.size);
 }
 
 size_t queue_size(queue_t Q) {
@@ -22,19 +75,46 @@ size_t queue_size(queue_t Q) {
 
 void *queue_front(queue_t Q) {
     if (queue_empty(Q)) return 0;
+    if (Q.slot) return __slot_item(Q, __slot_at(Q, 0));
     return Q.tail->item;
 }
 
 void *queue_back(queue_t Q) {
     if (queue_empty(Q)) return 0;
+    if (Q.slot) return __slot_item(Q, __slot_at(Q, Q.size - 1));
     return Q.head->item;
 }
 
 
+static void queue_push_ring(queue_t *Q, void *item, size_t size) {
+    uint8_t *slot;
+    void *copy;
+
+    if (Q->size == Q->capacity) __ring_grow(Q);
+
+    slot = __slot_at(*Q, Q->size);
+    memcpy(slot, &size, sizeof(size_t));
+
+    if (size > Q->slot) {
+        copy = malloc(size);
+        memcpy(copy, item, size);
+        memcpy(slot + sizeof(size_t), &copy, sizeof(void*));
+    } else {
+        memcpy(slot + sizeof(size_t), item, size);
+    }
+
+    Q->size++;
+}
+
 void queue_push(queue_t *Q, void *item, size_t size) {
+    if (Q->slot) {
+        queue_push_ring(Q, item, size);
+        return;
+    }
+
     struct queue_item *newi = (struct queue_item*)malloc(sizeof(struct queue_item));
 
-    newi->item = malloc(size);
+    newi->item = size <= QUEUE_INLINE ? newi->small : malloc(size);
     memcpy(newi->item, item, size);
 
     if (queue_empty(*Q)) {
@@ -42,6 +122,7 @@ void queue_push(queue_t *Q, void *item, size_t size) {
         Q->tail = Q->head;
         Q->head->next = 0;
     } else {
+        newi->next = 0;
         Q->head->next = newi;
         Q->head = newi;
     }
@@ -49,12 +130,27 @@ void queue_push(queue_t *Q, void *item, size_t size) {
     Q->size++;
 }
 
+static void queue_pop_ring(queue_t *Q) {
+    uint8_t *slot = __slot_at(*Q, 0);
+    size_t size;
+
+    memcpy(&size, slot, sizeof(size_t));
+    if (size > Q->slot) free(*(void**)(slot + sizeof(size_t)));
+
+    Q->first = (Q->first + 1) & (Q->capacity - 1);
+    Q->size--;
+}
+
 void queue_pop(queue_t *Q) {
     struct queue_item *p;
     
     if (queue_empty(*Q)) return;
+    if (Q->slot) {
+        queue_pop_ring(Q);
+        return;
+    }
 
-    free(Q->tail->item);
+    if (Q->tail->item != Q->tail->small) free(Q->tail->item);
     if (Q->tail == Q->head) {
         free(Q->tail);
         Q->tail = 0;
@@ -66,4 +162,13 @@ void queue_pop(queue_t *Q) {
     }
 
     Q->size--;
+}
+
+void queue_free(queue_t *Q) {
+    while (!queue_empty(*Q)) queue_pop(Q);
+
+    free(Q->ring);
+    Q->ring = 0;
+    Q->capacity = 0;
+    Q->first = 0;
 }
\ No newline at end of file
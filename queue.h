@@ -3,12 +3,18 @@
 #define _CTYPES_QUEUE_H
 
 #include <stdlib.h> // size_t
+#include <stdint.h> // uint8_t
+
+// Items up to this many bytes are stored inside the queue item
+#define QUEUE_INLINE 16
 
 // The item stored in the queue
 struct queue_item
 {
-    void *item;
+    void *item; // Points to `small` if the item fits
     struct queue_item *next;
+
+    uint8_t small[QUEUE_INLINE];
 };
 
 // The queue type. should be assigned the value of queue_new() or zeroed manually
@@ -17,15 +23,25 @@ struct queue
     size_t size;
     struct queue_item *tail;
     struct queue_item *head;
+
+    // Ring-buffer storage, only used when `slot` is not zero (see `queue_new_ring()`)
+    size_t slot;     // The number of payload bytes stored inline in every slot
+    size_t capacity; // The number of slots in `ring` (always a power of two)
+    size_t first;    // The index of the first element in `ring`
+    uint8_t *ring;
 };
 
 typedef struct queue queue_t;
 
 
 // Returns `queue_t` filled with zeroes
-// Can be replaced with {0, 0, 0}
+// Can be replaced with {0}
 queue_t queue_new();
 
+// Returns an empty `queue_t` backed by a growable circular array
+// Items up to `slot` bytes are stored inline, bigger ones are allocated separately
+queue_t queue_new_ring(size_t slot);
+
 // Returns a boolean value indicating whether or not `Q` is empty
 extern int queue_empty(queue_t q);
 
@@ -37,7 +53,7 @@ extern size_t queue_size(queue_t q);
 extern void* queue_front(queue_t q);
 
 // Accesses the last element
-extern void* qeque_back(queue_t q);
+extern void* queue_back(queue_t q);
 
 
 // Inserts an element at the end
@@ -46,4 +62,7 @@ extern void queue_push(queue_t* q, void* item, size_t size);
 // Removes the last element
 extern void queue_pop(queue_t* q);
 
+// Removes all elements and releases the memory held by the queue
+extern void queue_free(queue_t* q);
+
 #endif
\ No newline at end of file
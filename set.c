@@ -1,18 +1,43 @@
 // It's licensed under MIT, btw
 #include "comparator.h"
 #include "set.h"
+#include "slab.h"
+#include "pool.h"
+
+#include <string.h> // memcpy()
 
 set_t set_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
-    return (set_t){0, sgn_cmp, 0};
+    return (set_t){0, sgn_cmp, 0, 0, 0, stats_new()};
+}
+
+set_t set_new_slab(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    return (set_t){0, sgn_cmp, 0, slab_new(), 0, stats_new()};
 }
 
 size_t set_size(set_t S) {
     return S.size;
 }
 
-static struct set_node *set_node_new(cmp_item_t key) {
-    struct set_node *node = (struct set_node*)malloc(sizeof(struct set_node)); 
-    node->key = cmp_item_copy(key.data, key.size);
+// ---
+// node allocation
+
+static void *__alloc(set_t *S, size_t size) {
+    STATS_ADD(S->stats, allocs, 1);
+    STATS_ADD(S->stats, bytes, size);
+    return S->slab ? slab_alloc(S->slab, size) : malloc(size);
+}
+
+static void __free(set_t *S, void *ptr, size_t size) {
+    STATS_ADD(S->stats, frees, 1);
+    STATS_SUB(S->stats, bytes, size);
+    if (S->slab) slab_free(S->slab, ptr, size);
+    else free(ptr);
+}
+
+static struct set_node *set_node_new(set_t *S, cmp_item_t key) {
+    struct set_node *node = (struct set_node*)__alloc(S, sizeof(struct set_node));
+    node->key = cmp_item_new(key.size <= CMP_INLINE ? node->small : __alloc(S, key.size), key.size);
+    memcpy(node->key.data, key.data, key.size);
     node->parent = 0;
     node->left = 0;
     node->right = 0;
@@ -21,39 +46,170 @@ static struct set_node *set_node_new(cmp_item_t key) {
     return node;
 }
 
+static void set_node_free(set_t *S, struct set_node *node) {
+    if (node->key.data != node->small) __free(S, cmp_item(node->key), node->key.size);
+    __free(S, node, sizeof(struct set_node));
+}
 
+//
 // ---
-// set_find
 
-static struct set_node *__set_find(struct set_node *root, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
-    if (!root) return 0;
-    switch (sgn_cmp(root->key, key)) {
-        case -1:
-            return __set_find(root->right, key, sgn_cmp);
-        case 0: 
-            return root;
-        case 1:
-            return __set_find(root->left, key, sgn_cmp);
-        default:
-            return 0;
-    }
+
+// ---
+// comparator specialization
+//
+// The descents below are generated for every typed comparator from comparator.h,
+// so a set created with e.g. `cmp_sgn_u64` compares keys inline instead of calling `sgn_cmp` at every node
+
+// Counts one descent visiting (and comparing at) `hops` nodes
+static inline void __stats_descent(struct ctypes_counters *stats, size_t hops) {
+    STATS_ADD(stats, finds, 1);
+    STATS_ADD(stats, visited, hops);
+    STATS_ADD(stats, compares, hops);
 }
 
+// Generates __set_find_<name>(), __find_parent_<name>() and __set_find_many_<name>() comparing keys with `cmp`
+// Both children are prefetched while the current key is compared, so the next level is on its way whichever side is taken.
+// The batched descent advances up to `SET_BATCH` independent lookups one level at a time, overlapping their cache misses
+#define SET_DESCENT_DEFINE(name, cmp) \
+static struct set_node *__set_find_##name(struct set_node *x, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) { \
+    size_t hops = 0; \
+    int c; \
+    (void)sgn_cmp; \
+    while (x) { \
+        hops++; \
+        __builtin_prefetch(x->left); \
+        __builtin_prefetch(x->right); \
+        c = cmp(x->key, key); \
+        if (c < 0) x = x->right; \
+        else if (c > 0) x = x->left; \
+        else break; \
+    } \
+    __stats_descent(stats, hops); \
+    return x; \
+} \
+static struct set_node *__find_parent_##name(struct set_node *x, cmp_item_t key, int *sign, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) { \
+    struct set_node *par = 0; \
+    size_t hops = 0; \
+    int c = 0; \
+    (void)sgn_cmp; \
+    while (x) { \
+        hops++; \
+        par = x; \
+        __builtin_prefetch(x->left); \
+        __builtin_prefetch(x->right); \
+        c = cmp(key, x->key); \
+        if (c < 0) x = x->left; \
+        else if (c > 0) x = x->right; \
+        else break; \
+    } \
+    __stats_descent(stats, hops); \
+    *sign = c; \
+    return par; \
+} \
+static void __set_find_many_##name(struct set_node *root, cmp_item_t *keys, size_t n, struct set_node **out, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) { \
+    struct set_node *x[SET_BATCH]; \
+    size_t hops = 0, live = n, j; \
+    int c; \
+    (void)sgn_cmp; \
+    for (j = 0; j < n; j++) { \
+        x[j] = root; \
+        out[j] = 0; \
+    } \
+    while (live) { \
+        live = 0; \
+        for (j = 0; j < n; j++) { \
+            if (!x[j]) continue; \
+            hops++; \
+            c = cmp(x[j]->key, keys[j]); \
+            if (!c) { \
+                out[j] = x[j]; \
+                x[j] = 0; \
+                continue; \
+            } \
+            x[j] = c < 0 ? x[j]->right : x[j]->left; \
+            if (x[j]) { \
+                __builtin_prefetch(x[j]); \
+                live++; \
+            } \
+        } \
+    } \
+    STATS_ADD(stats, finds, n); \
+    STATS_ADD(stats, visited, hops); \
+    STATS_ADD(stats, compares, hops); \
+}
+
+#define SET_DESCENT_TYPED(name, type) SET_DESCENT_DEFINE(name, __cmp_sgn_##name)
+CMP_TYPES(SET_DESCENT_TYPED)
+SET_DESCENT_DEFINE(generic, sgn_cmp)
+#undef SET_DESCENT_TYPED
+
+// Picks the descent specialized for `sgn_cmp`, falling back to the generic one
+static struct set_node *__set_find(struct set_node *root, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), struct ctypes_counters *stats) {
+    #define SET_DISPATCH(name, type) if (sgn_cmp == cmp_sgn_##name) return __set_find_##name(root, key, sgn_cmp, stats);
+    CMP_TYPES(SET_DISPATCH)
+    #undef SET_DISPATCH
+    return __set_find_generic(root, key, sgn_cmp, stats);
+}
+
+static void __set_find_many(set_t S, cmp_item_t *keys, size_t n, struct set_node **out) {
+    #define SET_DISPATCH(name, type) if (S.sgn_cmp == cmp_sgn_##name) { __set_find_many_##name(S.root, keys, n, out, S.sgn_cmp, S.stats); return; }
+    CMP_TYPES(SET_DISPATCH)
+    #undef SET_DISPATCH
+    __set_find_many_generic(S.root, keys, n, out, S.sgn_cmp, S.stats);
+}
+
+// Descends from `x`, the root of the tree or of a subtree whose key range holds `key`
+// Stores the result of comparing `key` with the returned node in `*sign` (0 if the tree is empty)
+static struct set_node *__find_parent(set_t *S, struct set_node *x, cmp_item_t key, int *sign) {
+    #define SET_DISPATCH(name, type) if (S->sgn_cmp == cmp_sgn_##name) return __find_parent_##name(x, key, sign, S->sgn_cmp, S->stats);
+    CMP_TYPES(SET_DISPATCH)
+    #undef SET_DISPATCH
+    return __find_parent_generic(x, key, sign, S->sgn_cmp, S->stats);
+}
+
+//
+// ---
+
+// ---
+// set_find
+
 static struct set_node *_set_find(set_t S, cmp_item_t key) {
-    return __set_find(S.root, key, S.sgn_cmp);
+    return __set_find(S.root, key, S.sgn_cmp, S.stats);
 }
 
 int set_count(set_t S, cmp_item_t key) {
     return _set_find(S, key) ? 1 : 0;
 }
 
+size_t set_count_many(set_t S, cmp_item_t *keys, size_t n, int *found) {
+    struct set_node *nodes[SET_BATCH];
+    size_t count = 0, m;
+
+    for (size_t i = 0; i < n; i += m) {
+        m = n - i < SET_BATCH ? n - i : SET_BATCH;
+        __set_find_many(S, keys + i, m, nodes);
+        for (size_t j = 0; j < m; j++) {
+            count += nodes[j] != 0;
+            if (found) found[i + j] = nodes[j] != 0;
+        }
+    }
+    return count;
+}
+
 //
 // ---
 
 // ---
 // rotation functions
 
+static size_t __weight(struct set_node *node) {
+    return node ? node->weight : 0;
+}
+
 static void __rotate_left(set_t *S, struct set_node *node) {
+    STATS_ADD(S->stats, rotations, 1);
+
     struct set_node *child = node->right;
     node->right = child->left;
 
@@ -67,9 +223,16 @@ static void __rotate_left(set_t *S, struct set_node *node) {
 
     child->left = node;
     node->parent = child;
+
+    if (S->ranked) {
+        child->weight = node->weight;
+        node->weight = __weight(node->left) + __weight(node->right) + 1;
+    }
 }
 
 static void __rotate_right(set_t *S, struct set_node *node) {
+    STATS_ADD(S->stats, rotations, 1);
+
     struct set_node *child = node->left;
     node->left = child->right;
 
@@ -83,6 +246,11 @@ static void __rotate_right(set_t *S, struct set_node *node) {
 
     child->right = node;
     node->parent = child;
+
+    if (S->ranked) {
+        child->weight = node->weight;
+        node->weight = __weight(node->left) + __weight(node->right) + 1;
+    }
 }
 
 //
@@ -91,27 +259,6 @@ static void __rotate_right(set_t *S, struct set_node *node) {
 // ---
 // set_insert
 
-static struct set_node *__find_parent(set_t *S, struct set_node *node) {
-    struct set_node *x = S->root;
-    struct set_node *par = 0;
-    
-    while (x != 0) {
-        par = x;
-        switch (S->sgn_cmp(node->key, x->key)) {
-        case -1:
-            x = x->left;
-            break;
-        default: // + case 0:
-            return x;
-        case 1:
-            x = x->right;
-            break;
-        }
-    }
-    
-    return par;
-}
-
 static void __insert_fix(set_t *S, struct set_node *node) {
     struct set_node *u; // uncle
 
@@ -153,34 +300,33 @@ static void __insert_fix(set_t *S, struct set_node *node) {
     S->root->color = 0;
 }
 
-static void set_insert_node(set_t *S, struct set_node *node) {
-    // Insert `item` into tree
-    struct set_node *par = __find_parent(S, node);
-
+// Links a new node for `key` as the child of `par` on the side of `c` (the sign of `key` - `par->key`)
+static struct set_node *__link(set_t *S, struct set_node *par, int c, cmp_item_t key) {
+    struct set_node *node = set_node_new(S, key);
     node->parent = par;
 
     if (!par) S->root = node;
-    else {
-        switch (S->sgn_cmp(par->key, node->key)) {
-        case -1:
-            par->right = node;
-            break;
-        default: // + case 0:
-            free(cmp_item(node->key));
-            free(node);
-            return;
-        case 1:
-            par->left = node;
-            break;
-        }
+    else if (c < 0) par->left = node;
+    else par->right = node;
+
+    if (S->ranked) {
+        node->weight = 1;
+        for (; par; par = par->parent) par->weight++;
     }
 
     __insert_fix(S, node);
     S->size++;
+    return node;
 }
 
-void set_insert(set_t *S, cmp_item_t item) {
-    set_insert_node(S, set_node_new(item));
+void set_insert(set_t *S, cmp_item_t key) {
+    // Only allocate the node once the key is known to be missing
+    int c;
+    struct set_node *par = __find_parent(S, S->root, key, &c);
+
+    if (par && !c) return;
+
+    __link(S, par, c, key);
 }
 
 //
@@ -203,87 +349,98 @@ static void __transplant(set_t *S, struct set_node *u, struct set_node *v) {
     if (v) v->parent = u->parent;
 }
 
-static void __delete_fix(set_t *S, struct set_node *node) {
-    struct set_node *u;
+#define __red(n) ((n) && (n)->color)
 
-    if (!node) return;
+// `node` may be zero (an empty leaf), so its parent is passed separately
+static void __delete_fix(set_t *S, struct set_node *node, struct set_node *parent) {
+    struct set_node *u;
 
-    while (node != S->root && !node->color) {
-        if (node == node->parent->left) {
-            u = node->parent->right;
+    while (node != S->root && !__red(node)) {
+        if (node == parent->left) {
+            u = parent->right;
             if (u->color) {
                 u->color = 0;
-                node->parent->color = 1;
-                __rotate_left(S, node->parent);
-                u = node->parent->right;
+                parent->color = 1;
+                __rotate_left(S, parent);
+                u = parent->right;
             }
-            if (!u->left->color && !u->right->color) {
+            if (!__red(u->left) && !__red(u->right)) {
                 u->color = 1;
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (!u->right->color) {
+                if (!__red(u->right)) {
                     u->left->color = 0;
                     u->color = 1;
                     __rotate_right(S, u);
-                    u = node->parent->right;
+                    u = parent->right;
                 }
-                u->color = node->parent->color;
-                node->parent->color = 0;
+                u->color = parent->color;
+                parent->color = 0;
                 u->right->color = 0;
-                __rotate_left(S, node->parent);
+                __rotate_left(S, parent);
                 node = S->root;
             }
         } else {
-            u = node->parent->left;
+            u = parent->left;
             if (u->color) {
                 u->color = 0;
-                node->parent->color = 1;
-                __rotate_right(S, node->parent);
-                u = node->parent->left;
+                parent->color = 1;
+                __rotate_right(S, parent);
+                u = parent->left;
             }
-            if (!u->left->color && !u->right->color) {
+            if (!__red(u->left) && !__red(u->right)) {
                 u->color = 1;
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (!u->left->color) {
+                if (!__red(u->left)) {
                     u->right->color = 0;
                     u->color = 1;
                     __rotate_left(S, u);
-                    u = node->parent->left;
+                    u = parent->left;
                 }
-                u->color = node->parent->color;
-                node->parent->color = 0;
+                u->color = parent->color;
+                parent->color = 0;
                 u->left->color = 0;
-                __rotate_right(S, node->parent);
+                __rotate_right(S, parent);
                 node = S->root;
             }
         }
     }
-    node->color = 0;
+    if (node) node->color = 0;
 }
 
+#undef __red
 
-void set_delete(set_t *S, cmp_item_t key) {
-    struct set_node *node = _set_find(*S, key);
-    struct set_node *u, *v;
+// Detaches `node` from the tree and rebalances it
+static void __unlink(set_t *S, struct set_node *node) {
+    struct set_node *u, *v, *vp; // `v` takes the place of `u`, `vp` is its new parent
     int color;
 
-    if (!node) return;
+    if (S->ranked) {
+        // Every ancestor of the node which is physically removed loses one descendant
+        u = node->left && node->right ? __minimum(node->right) : node;
+        for (u = u->parent; u; u = u->parent) u->weight--;
+    }
 
     u = node;
     color = u->color;
     if (!node->left) {
         v = node->right;
+        vp = node->parent;
         __transplant(S, node, node->right);
     } else if (!node->right) {
         v = node->left;
+        vp = node->parent;
         __transplant(S, node, node->left);
     } else {
         u = __minimum(node->right);
         color = u->color;
         v = u->right;
-        if (u->parent == node) v->parent = u;
+        if (u->parent == node) vp = u;
         else {
+            vp = u->parent;
             __transplant(S, u, u->right);
             u->right = node->right;
             u->right->parent = u;
@@ -292,14 +449,830 @@ void set_delete(set_t *S, cmp_item_t key) {
         u->left = node->left;
         u->left->parent = u;
         u->color = node->color;
+        u->weight = node->weight;
     }
 
-    if (!color) __delete_fix(S, v);
+    if (!color) __delete_fix(S, v, vp);
 
-    free(cmp_item(node->key));
-    free(node);
     S->size--;
 }
 
+void set_delete(set_t *S, cmp_item_t key) {
+    struct set_node *node = _set_find(*S, key);
+
+    if (!node) return;
+    __unlink(S, node);
+    set_node_free(S, node);
+}
+
+//
+// ---
+
+// ---
+// iteration
+
+static struct set_node *__maximum(struct set_node *node) {
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+struct set_node *set_first(set_t S) {
+    return __minimum(S.root);
+}
+
+struct set_node *set_last(set_t S) {
+    return __maximum(S.root);
+}
+
+struct set_node *set_next(struct set_node *node) {
+    if (node->right) return __minimum(node->right);
+
+    // Climb until we come from a left subtree
+    while (node->parent && node == node->parent->right) node = node->parent;
+    return node->parent;
+}
+
+struct set_node *set_prev(struct set_node *node) {
+    if (node->left) return __maximum(node->left);
+
+    // Climb until we come from a right subtree
+    while (node->parent && node == node->parent->left) node = node->parent;
+    return node->parent;
+}
+
+// Returns the first node whose key is greater than `key`, or greater or equal if `equal` is set
+static struct set_node *__bound(set_t S, cmp_item_t key, int equal) {
+    struct set_node *x = S.root;
+    struct set_node *out = 0;
+    size_t hops = 0;
+    int c;
+
+    while (x) {
+        hops++;
+        c = S.sgn_cmp(x->key, key);
+        if (c > 0 || (equal && c == 0)) {
+            out = x;
+            x = x->left;
+        } else {
+            x = x->right;
+        }
+    }
+
+    __stats_descent(S.stats, hops);
+    return out;
+}
+
+struct set_node *set_lower_bound(set_t S, cmp_item_t key) {
+    return __bound(S, key, 1);
+}
+
+struct set_node *set_upper_bound(set_t S, cmp_item_t key) {
+    return __bound(S, key, 0);
+}
+
+set_range_t set_range(set_t S, cmp_item_t lo, cmp_item_t hi) {
+    set_range_t R = {0, 0};
+    struct set_node *end;
+
+    R.first = __bound(S, lo, 1);
+    end = __bound(S, hi, 0);
+
+    // Empty unless the first node is before the end
+    if (!R.first || R.first == end || S.sgn_cmp(R.first->key, hi) > 0) {
+        R.first = 0;
+        return R;
+    }
+    R.last = end ? set_prev(end) : set_last(S);
+    return R;
+}
+
+struct set_node *set_range_next(set_range_t R, struct set_node *node) {
+    return node == R.last ? 0 : set_next(node);
+}
+
+struct set_node *set_range_prev(set_range_t R, struct set_node *node) {
+    return node == R.first ? 0 : set_prev(node);
+}
+
+//
+// ---
+
+// ---
+// order statistics
+
+static size_t __rank_init(struct set_node *node) {
+    if (!node) return 0;
+
+    node->weight = __rank_init(node->left) + __rank_init(node->right) + 1;
+    return node->weight;
+}
+
+void set_enable_rank(set_t *S) {
+    __rank_init(S->root);
+    S->ranked = 1;
+}
+
+struct set_node *set_select(set_t S, size_t k) {
+    struct set_node *x = S.root;
+    size_t w;
+
+    if (!S.ranked) {
+        for (x = set_first(S); x && k; k--) x = set_next(x);
+        return x;
+    }
+
+    while (x) {
+        w = __weight(x->left);
+        if (k < w) x = x->left;
+        else if (k == w) return x;
+        else {
+            k -= w + 1;
+            x = x->right;
+        }
+    }
+    return 0;
+}
+
+size_t set_rank(set_t S, cmp_item_t key) {
+    struct set_node *x = S.root;
+    size_t out = 0;
+
+    if (!S.ranked) {
+        for (x = set_first(S); x && S.sgn_cmp(x->key, key) < 0; x = set_next(x)) out++;
+        return out;
+    }
+
+    while (x) {
+        if (S.sgn_cmp(x->key, key) < 0) {
+            out += __weight(x->left) + 1;
+            x = x->right;
+        } else {
+            x = x->left;
+        }
+    }
+    return out;
+}
+
+//
+// ---
+
+// ---
+// bulk loading
+
+// Links `nodes[lo..hi)`, which are in key order, into a balanced subtree
+// Nodes at depth `red` are colored red, so that every path has the same number of black nodes
+static struct set_node *__build(struct set_node **nodes, size_t lo, size_t hi, struct set_node *parent, size_t depth, size_t red) {
+    struct set_node *node;
+    size_t mid;
+
+    if (lo == hi) return 0;
+
+    mid = lo + (hi - lo) / 2;
+    node = nodes[mid];
+    node->parent = parent;
+    node->color = depth == red;
+    node->weight = hi - lo;
+    node->left = __build(nodes, lo, mid, node, depth + 1, red);
+    node->right = __build(nodes, mid + 1, hi, node, depth + 1, red);
+    return node;
+}
+
+// Makes `nodes`, which are in key order, the whole tree of `S`
+// Halving the range keeps all empty leaves within the two deepest levels,
+// so coloring the deepest level of nodes red balances the tree without rotations
+static void __set_build(set_t *S, struct set_node **nodes, size_t n) {
+    size_t h = 0;
+
+    while ((n >> h) > 1) h++;
+
+    S->root = __build(nodes, 0, n, 0, 0, h ? h : (size_t)-1);
+    S->size = n;
+}
+
+// The number of pieces work is cut into, `SET_SPLIT` per thread so that the threads which finish early steal the rest
+static size_t __split(pool_t *P) {
+    return pool_threads(P) > 1 ? pool_threads(P) * SET_SPLIT : 1;
+}
+
+// A subtree left to the pool by `__build_top()`, its root is stored in `*link`
+struct set_subtree {
+    size_t lo;
+    size_t hi;
+    size_t depth;
+    struct set_node *parent;
+    struct set_node **link;
+};
+
+struct set_bulk {
+    cmp_item_t *keys;
+    int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
+    uint8_t *keep;            // Whether each key is the first of its equals
+    size_t *at;               // The key of every node
+    struct set_node **nodes;  // Allocated on the calling thread, filled by the pool
+    size_t red;
+    struct set_subtree *subtrees;
+    size_t count;
+};
+
+static void __dedupe(void *arg, size_t lo, size_t hi) {
+    struct set_bulk *B = (struct set_bulk*)arg;
+
+    for (size_t i = lo; i < hi; i++) B->keep[i] = !i || B->sgn_cmp(B->keys[i - 1], B->keys[i]);
+}
+
+static void __fill(struct set_bulk *B, size_t i) {
+    cmp_item_t key = B->keys[B->at[i]];
+    memcpy(B->nodes[i]->key.data, key.data, key.size);
+}
+
+// Links the nodes above depth `cut` like `__build()` does, the subtrees at depth `cut` are only recorded
+static void __build_top(struct set_bulk *B, size_t lo, size_t hi, struct set_node *parent, struct set_node **link, size_t depth, size_t cut) {
+    struct set_node *node;
+    size_t mid;
+
+    if (lo == hi) {
+        *link = 0;
+        return;
+    }
+    if (depth == cut) {
+        B->subtrees[B->count++] = (struct set_subtree){lo, hi, depth, parent, link};
+        return;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    node = B->nodes[mid];
+    __fill(B, mid);
+    node->parent = parent;
+    node->color = depth == B->red;
+    node->weight = hi - lo;
+    *link = node;
+    __build_top(B, lo, mid, node, &node->left, depth + 1, cut);
+    __build_top(B, mid + 1, hi, node, &node->right, depth + 1, cut);
+}
+
+static void __build_subtrees(void *arg, size_t lo, size_t hi) {
+    struct set_bulk *B = (struct set_bulk*)arg;
+
+    for (size_t j = lo; j < hi; j++) {
+        struct set_subtree *T = &B->subtrees[j];
+
+        for (size_t i = T->lo; i < T->hi; i++) __fill(B, i);
+        *T->link = __build(B->nodes, T->lo, T->hi, T->parent, T->depth, B->red);
+    }
+}
+
+set_t set_from_sorted_parallel(cmp_item_t *keys, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), pool_t *P) {
+    set_t S = set_new_slab(sgn_cmp);
+    struct set_bulk B;
+    size_t i, m = 0, cut = 0, h = 0;
+
+    B.keys = keys;
+    B.sgn_cmp = sgn_cmp;
+    B.count = 0;
+    B.keep = (uint8_t*)malloc(n ? n : 1);
+    B.at = (size_t*)malloc((n ? n : 1) * sizeof(size_t));
+    B.nodes = (struct set_node**)malloc((n ? n : 1) * sizeof(struct set_node*));
+
+    // Keep the first of equal keys, like `set_insert()` does
+    pool_for(P, n, n / __split(P) + 1, __dedupe, &B);
+
+    // The slab isn't thread-safe, so only the allocations stay on the calling thread
+    slab_reserve(S.slab, sizeof(struct set_node), n);
+    for (i = 0; i < n; i++) {
+        if (!B.keep[i]) continue;
+
+        B.nodes[m] = (struct set_node*)__alloc(&S, sizeof(struct set_node));
+        B.nodes[m]->key = cmp_item_new(keys[i].size <= CMP_INLINE ? B.nodes[m]->small : __alloc(&S, keys[i].size), keys[i].size);
+        B.at[m++] = i;
+    }
+
+    while ((m >> h) > 1) h++;
+    while (((size_t)1 << cut) < __split(P)) cut++;
+
+    B.red = h ? h : (size_t)-1;
+    B.subtrees = (struct set_subtree*)malloc(((size_t)1 << cut) * sizeof(struct set_subtree));
+    __build_top(&B, 0, m, 0, &S.root, 0, cut);
+    pool_for(P, B.count, 1, __build_subtrees, &B);
+    S.size = m;
+
+    free(B.subtrees);
+    free(B.nodes);
+    free(B.at);
+    free(B.keep);
+    return S;
+}
+
+set_t set_from_sorted(cmp_item_t *keys, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    return set_from_sorted_parallel(keys, n, sgn_cmp, 0);
+}
+
+set_t set_from_array(cmp_item_t *keys, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    cmp_item_t *sorted = (cmp_item_t*)malloc(n * sizeof(cmp_item_t));
+    set_t S;
+
+    memcpy(sorted, keys, n * sizeof(cmp_item_t));
+    cmp_sort(sorted, n, sizeof(cmp_item_t), sgn_cmp);
+
+    S = set_from_sorted(sorted, n, sgn_cmp);
+    free(sorted);
+    return S;
+}
+
+//
+// ---
+
+// ---
+// batch updates
+//
+// A batch is sorted first, so each key is searched from the node of the previous one (a finger) instead of from the root:
+// the search climbs only as far as the smallest subtree which can hold the key, which costs O(log d) for keys d apart.
+// A batch at least as big as the tree is merged with it and the tree is rebuilt, without any rotation.
+
+// Returns the root of a small subtree whose key range holds `key`, starting from `x`
+// Keys come in ascending order, so `key` is greater than everything left of `x` and only the upper bounds are checked:
+// a key before the successor of `x` is found below `x`, otherwise the climb goes on from the successor
+static struct set_node *__finger(set_t *S, struct set_node *x, cmp_item_t key) {
+    struct set_node *next;
+    int c;
+
+    STATS_ADD(S->stats, compares, 1);
+    if (S->sgn_cmp(key, x->key) <= 0) return x;
+
+    next = set_next(x);
+    if (!next) return x;
+    STATS_ADD(S->stats, compares, 1);
+    if ((c = S->sgn_cmp(key, next->key)) < 0) return x;
+    if (!c) return next;
+
+    for (x = next; x->parent; x = x->parent) {
+        if (x == x->parent->left) {
+            STATS_ADD(S->stats, compares, 1);
+            if (S->sgn_cmp(key, x->parent->key) < 0) break;
+        }
+    }
+    return x;
+}
+
+// Merges sorted keys into the nodes of `S` and rebuilds it, in O(n + k)
+static void __merge_insert(set_t *S, cmp_item_t *sorted, size_t k) {
+    struct set_node **nodes = (struct set_node**)malloc((S->size + k) * sizeof(struct set_node*));
+    struct set_node *x = set_first(*S);
+    size_t i = 0, m = 0;
+    int c;
+
+    while (x || i < k) {
+        c = !x ? 1 : i == k ? -1 : S->sgn_cmp(x->key, sorted[i]);
+        if (c <= 0) {
+            // Present keys win over equal ones of the batch, as with `set_insert()`
+            nodes[m++] = x;
+            x = set_next(x);
+            i += !c;
+            continue;
+        }
+        if (!m || S->sgn_cmp(nodes[m - 1]->key, sorted[i])) nodes[m++] = set_node_new(S, sorted[i]);
+        i++;
+    }
+
+    __set_build(S, nodes, m);
+    free(nodes);
+}
+
+void set_insert_batch(set_t *S, cmp_item_t *keys, size_t k) {
+    cmp_item_t *sorted;
+    struct set_node *finger = 0, *par;
+    int c;
+
+    if (!k) return;
+    sorted = (cmp_item_t*)malloc(k * sizeof(cmp_item_t));
+    memcpy(sorted, keys, k * sizeof(cmp_item_t));
+    cmp_sort(sorted, k, sizeof(cmp_item_t), S->sgn_cmp);
+
+    if (S->slab) slab_reserve(S->slab, sizeof(struct set_node), k);
+
+    if (k >= S->size) __merge_insert(S, sorted, k);
+    else for (size_t i = 0; i < k; i++) {
+        par = __find_parent(S, finger ? __finger(S, finger, sorted[i]) : S->root, sorted[i], &c);
+        if (!c) finger = par;
+        else finger = __link(S, par, c, sorted[i]);
+    }
+
+    free(sorted);
+}
+
+// Drops the nodes whose keys are among the sorted `keys` and rebuilds `S` from the rest, in O(n + k)
+static void __merge_delete(set_t *S, cmp_item_t *keys, size_t k) {
+    struct set_node **nodes = (struct set_node**)malloc(S->size * sizeof(struct set_node*));
+    struct set_node *x = set_first(*S);
+    size_t i = 0, m = 0, d = S->size;
+    int c = 1;
+
+    // Deleted nodes are collected at the end of `nodes`, the walk still needs their parent pointers
+    for (; x; x = set_next(x)) {
+        while (i < k && (c = S->sgn_cmp(keys[i], x->key)) < 0) i++;
+        if (i < k && !c) nodes[--d] = x;
+        else nodes[m++] = x;
+    }
+
+    for (i = d; i < S->size; i++) set_node_free(S, nodes[i]);
+    __set_build(S, nodes, m);
+    free(nodes);
+}
+
+void set_delete_batch(set_t *S, cmp_item_t *keys, size_t k) {
+    cmp_item_t *sorted;
+    struct set_node *finger = 0, *node;
+
+    if (!k || !S->root) return;
+    sorted = (cmp_item_t*)malloc(k * sizeof(cmp_item_t));
+    memcpy(sorted, keys, k * sizeof(cmp_item_t));
+    cmp_sort(sorted, k, sizeof(cmp_item_t), S->sgn_cmp);
+
+    if (k >= S->size) __merge_delete(S, sorted, k);
+    else for (size_t i = 0; i < k; i++) {
+        node = __set_find(finger ? __finger(S, finger, sorted[i]) : S->root, sorted[i], S->sgn_cmp, S->stats);
+        if (!node) continue;
+
+        // Deleting relinks nodes instead of moving keys between them, so the successor stays valid as the next finger
+        finger = set_next(node);
+        __unlink(S, node);
+        set_node_free(S, node);
+        if (!finger) break;
+    }
+
+    free(sorted);
+}
+
+//
+// ---
+
+// ---
+// for_each
+//
+// A tree is cut at the depth which leaves about `SET_SPLIT` subtrees per thread. Each subtree is a piece of work,
+// and so is each node above them, so threads which finish early steal whole subtrees. Pieces are in key order.
+
+struct set_piece {
+    struct set_node *node;
+    int whole; // Whether the piece is the subtree of `node` or `node` alone
+};
+
+static size_t __cut(struct set_node *x, size_t depth, struct set_piece *pieces, size_t n) {
+    if (!x) return n;
+    if (!depth) {
+        pieces[n++] = (struct set_piece){x, 1};
+        return n;
+    }
+
+    n = __cut(x->left, depth - 1, pieces, n);
+    pieces[n++] = (struct set_piece){x, 0};
+    return __cut(x->right, depth - 1, pieces, n);
+}
+
+// Cuts `S` into pieces for the threads of `P`, stores their number in `*n`
+static struct set_piece *__pieces(set_t S, pool_t *P, size_t *n) {
+    size_t depth = 0;
+
+    while (((size_t)1 << depth) < __split(P)) depth++;
+
+    struct set_piece *pieces = (struct set_piece*)malloc(((size_t)2 << depth) * sizeof(struct set_piece));
+    *n = __cut(S.root, depth, pieces, 0);
+    return pieces;
+}
+
+static void __walk(struct set_node *x, void (*fn)(struct set_node *node, void *arg), void *arg) {
+    if (!x) return;
+    __walk(x->left, fn, arg);
+    fn(x, arg);
+    __walk(x->right, fn, arg);
+}
+
+struct set_each {
+    struct set_piece *pieces;
+    void (*fn)(struct set_node *node, void *arg);
+    void *arg;
+};
+
+static void __each(void *arg, size_t lo, size_t hi) {
+    struct set_each *E = (struct set_each*)arg;
+
+    for (size_t i = lo; i < hi; i++) {
+        if (E->pieces[i].whole) __walk(E->pieces[i].node, E->fn, E->arg);
+        else E->fn(E->pieces[i].node, E->arg);
+    }
+}
+
+void set_for_each(set_t S, void (*fn)(struct set_node *node, void *arg), void *arg, pool_t *P) {
+    struct set_each E = {0, fn, arg};
+    size_t n;
+
+    E.pieces = __pieces(S, P, &n);
+    pool_for(P, n, 1, __each, &E);
+    free(E.pieces);
+}
+
+//
+// ---
+
+// ---
+// set algebra
+//
+// Both sets are walked in key order at once and the result is built from the merged keys with `set_from_sorted()`,
+// which takes O(n + m) and allocates its nodes contiguously. When one set is much smaller than the other,
+// its keys probe the bigger one with `set_count_many()` instead, in O(m log n).
+// With a pool both sets are flattened piece by piece, and the merge is cut into chunks of `A` which binary search
+// where they start in `B`, so every chunk is merged and packed independently.
+
+enum { __UNION, __INTERSECT, __DIFFERENCE };
+
+// Is probing a set of `n` keys `m` times cheaper than walking both sets?
+static int __probe(size_t m, size_t n) {
+    size_t depth = 1;
+
+    while (n >> depth) depth++;
+    return m * depth < m + n;
+}
+
+static size_t __count(struct set_node *x) {
+    return x ? __count(x->left) + 1 + __count(x->right) : 0;
+}
+
+static size_t __collect(struct set_node *x, cmp_item_t *keys, size_t i) {
+    if (!x) return i;
+    i = __collect(x->left, keys, i);
+    keys[i++] = x->key;
+    return __collect(x->right, keys, i);
+}
+
+struct set_flat {
+    set_t S;
+    struct set_piece *pieces;
+    size_t *offsets; // Where the keys of every piece start
+    cmp_item_t *keys;
+};
+
+static void __measure(void *arg, size_t lo, size_t hi) {
+    struct set_flat *F = (struct set_flat*)arg;
+
+    for (size_t i = lo; i < hi; i++) {
+        struct set_node *x = F->pieces[i].node;
+        F->offsets[i] = !F->pieces[i].whole ? 1 : F->S.ranked ? x->weight : __count(x);
+    }
+}
+
+static void __flatten(void *arg, size_t lo, size_t hi) {
+    struct set_flat *F = (struct set_flat*)arg;
+
+    for (size_t i = lo; i < hi; i++) {
+        if (F->pieces[i].whole) __collect(F->pieces[i].node, F->keys, F->offsets[i]);
+        else F->keys[F->offsets[i]] = F->pieces[i].node->key;
+    }
+}
+
+// Collects the keys of `S` in order, the result points into the nodes
+static cmp_item_t *__keys(set_t S, pool_t *P) {
+    struct set_flat F;
+    size_t i, n, sum = 0, size;
+
+    F.S = S;
+    F.pieces = __pieces(S, P, &n);
+    F.offsets = (size_t*)malloc((n + 1) * sizeof(size_t));
+    F.keys = (cmp_item_t*)malloc((S.size ? S.size : 1) * sizeof(cmp_item_t));
+
+    // A single piece is the whole tree
+    if (n == 1) F.offsets[0] = S.size;
+    else pool_for(P, n, 1, __measure, &F);
+
+    for (i = 0; i < n; i++) {
+        size = F.offsets[i];
+        F.offsets[i] = sum;
+        sum += size;
+    }
+    pool_for(P, n, 1, __flatten, &F);
+
+    free(F.offsets);
+    free(F.pieces);
+    return F.keys;
+}
+
+struct set_probe {
+    set_t B;
+    cmp_item_t *keys;
+    int *found;
+};
+
+static void __probe_range(void *arg, size_t lo, size_t hi) {
+    struct set_probe *Q = (struct set_probe*)arg;
+
+    set_count_many(Q->B, Q->keys + lo, hi - lo, Q->found + lo);
+}
+
+// Keeps the keys of `A` which are present in `B` (or missing from it, unless `present`)
+static set_t __filter(set_t A, set_t B, int present, pool_t *P) {
+    struct set_probe Q = {B, __keys(A, P), (int*)malloc((A.size ? A.size : 1) * sizeof(int))};
+    size_t i, m = 0;
+    set_t S;
+
+    pool_for(P, A.size, A.size / __split(P) + 1, __probe_range, &Q);
+    for (i = 0; i < A.size; i++) {
+        if (Q.found[i] == present) Q.keys[m++] = Q.keys[i];
+    }
+
+    S = set_from_sorted_parallel(Q.keys, m, A.sgn_cmp, P);
+    free(Q.found);
+    free(Q.keys);
+    return S;
+}
+
+// Merges the sorted keys `a` and `b` into `out` for `op`, returns the number of keys written
+static size_t __merge_keys(cmp_item_t *a, size_t na, cmp_item_t *b, size_t nb, int op, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), cmp_item_t *out) {
+    size_t i = 0, j = 0, m = 0;
+    int c;
+
+    while (i < na && j < nb) {
+        c = sgn_cmp(a[i], b[j]);
+        if (c > 0) {
+            if (op == __UNION) out[m++] = b[j];
+            j++;
+            continue;
+        }
+        // Equal keys are kept for union and intersection, smaller ones for union and difference
+        if (op == __UNION || (op == __INTERSECT) == !c) out[m++] = a[i];
+        i++;
+        if (!c) j++;
+    }
+    for (; i < na && op != __INTERSECT; i++) out[m++] = a[i];
+    for (; j < nb && op == __UNION; j++) out[m++] = b[j];
+    return m;
+}
+
+// Returns the position of the first of the sorted keys `b` which is not less than `key`
+static size_t __lower(cmp_item_t *b, size_t nb, cmp_item_t key, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    size_t lo = 0, hi = nb, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (sgn_cmp(b[mid], key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// The keys of `A` are cut into chunks, and each chunk is merged with the keys of `B` between its first key and the next chunk's
+struct set_merge {
+    cmp_item_t *a, *b;
+    size_t na, nb;
+    size_t chunk;
+    int op;
+    int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
+    cmp_item_t *out;    // Every chunk writes from `starts[j]`, and there is room for all of its keys
+    size_t *starts;
+    size_t *counts;
+    size_t *offsets;    // Where every chunk goes in `packed`
+    cmp_item_t *packed; // The results of all chunks, back to back
+};
+
+static void __merge_chunks(void *arg, size_t lo, size_t hi) {
+    struct set_merge *G = (struct set_merge*)arg;
+
+    for (size_t j = lo; j < hi; j++) {
+        size_t alo = j * G->chunk, ahi = alo + G->chunk < G->na ? alo + G->chunk : G->na;
+        size_t blo = j ? __lower(G->b, G->nb, G->a[alo], G->sgn_cmp) : 0;
+        size_t bhi = ahi < G->na ? __lower(G->b, G->nb, G->a[ahi], G->sgn_cmp) : G->nb;
+
+        G->starts[j] = alo + blo;
+        G->counts[j] = __merge_keys(G->a + alo, ahi - alo, G->b + blo, bhi - blo, G->op, G->sgn_cmp, G->out + alo + blo);
+    }
+}
+
+static void __pack(void *arg, size_t lo, size_t hi) {
+    struct set_merge *G = (struct set_merge*)arg;
+
+    for (size_t j = lo; j < hi; j++) memcpy(G->packed + G->offsets[j], G->out + G->starts[j], G->counts[j] * sizeof(cmp_item_t));
+}
+
+static set_t __merge(set_t A, set_t B, int op, pool_t *P) {
+    struct set_merge G;
+    size_t j, c, m = 0;
+    set_t S;
+
+    G.a = __keys(A, P);
+    G.b = __keys(B, P);
+    G.na = A.size;
+    G.nb = B.size;
+    G.chunk = A.size / __split(P) + 1;
+    G.op = op;
+    G.sgn_cmp = A.sgn_cmp;
+    G.out = (cmp_item_t*)malloc((A.size + B.size ? A.size + B.size : 1) * sizeof(cmp_item_t));
+
+    c = A.size ? (A.size + G.chunk - 1) / G.chunk : 1;
+    G.starts = (size_t*)malloc(c * sizeof(size_t));
+    G.counts = (size_t*)malloc(c * sizeof(size_t));
+    G.offsets = (size_t*)malloc(c * sizeof(size_t));
+    pool_for(P, c, 1, __merge_chunks, &G);
+
+    for (j = 0; j < c; j++) {
+        G.offsets[j] = m;
+        m += G.counts[j];
+    }
+
+    // A single chunk is already in place
+    G.packed = G.out;
+    if (c > 1) {
+        G.packed = (cmp_item_t*)malloc((m ? m : 1) * sizeof(cmp_item_t));
+        pool_for(P, c, 1, __pack, &G);
+    }
+
+    S = set_from_sorted_parallel(G.packed, m, A.sgn_cmp, P);
+    if (G.packed != G.out) free(G.packed);
+    free(G.offsets);
+    free(G.counts);
+    free(G.starts);
+    free(G.out);
+    free(G.b);
+    free(G.a);
+    return S;
+}
+
+set_t set_union_parallel(set_t A, set_t B, pool_t *P) {
+    return __merge(A, B, __UNION, P);
+}
+
+set_t set_intersect_parallel(set_t A, set_t B, pool_t *P) {
+    // The result is the same either way, the smaller set probes the bigger one
+    if (B.size < A.size && __probe(B.size, A.size)) return __filter(B, A, 1, P);
+    if (__probe(A.size, B.size)) return __filter(A, B, 1, P);
+    return __merge(A, B, __INTERSECT, P);
+}
+
+set_t set_difference_parallel(set_t A, set_t B, pool_t *P) {
+    if (__probe(A.size, B.size)) return __filter(A, B, 0, P);
+    return __merge(A, B, __DIFFERENCE, P);
+}
+
+set_t set_union(set_t A, set_t B) {
+    return set_union_parallel(A, B, 0);
+}
+
+set_t set_intersect(set_t A, set_t B) {
+    return set_intersect_parallel(A, B, 0);
+}
+
+set_t set_difference(set_t A, set_t B) {
+    return set_difference_parallel(A, B, 0);
+}
+
+int set_is_subset(set_t A, set_t B) {
+    struct set_node *a, *b;
+    cmp_item_t *keys;
+    size_t found;
+    int c = 1;
+
+    if (A.size > B.size) return 0;
+
+    if (__probe(A.size, B.size)) {
+        keys = __keys(A, 0);
+        found = set_count_many(B, keys, A.size, 0);
+        free(keys);
+        return found == A.size;
+    }
+
+    for (a = set_first(A), b = set_first(B); a; a = set_next(a), b = set_next(b)) {
+        while (b && (c = A.sgn_cmp(b->key, a->key)) < 0) b = set_next(b);
+        if (!b || c) return 0;
+    }
+    return 1;
+}
+
+//
+// ---
+
+// ---
+// set_free
+
+static void __set_free(set_t *S, struct set_node *node) {
+    if (!node) return;
+    __set_free(S, node->left);
+    __set_free(S, node->right);
+    set_node_free(S, node);
+}
+
+void set_free(set_t *S) {
+    // A slab releases all of its nodes at once
+    if (S->slab) slab_destroy(S->slab);
+    else __set_free(S, S->root);
+
+    stats_free(S->stats);
+    S->root = 0;
+    S->size = 0;
+    S->slab = 0;
+    S->stats = 0;
+}
+
+struct ctypes_stats set_stats(set_t S) {
+    return stats_read(S.stats);
+}
+
 //
 // ---
\ No newline at end of file
@@ -2,16 +2,30 @@
 #ifndef _PAVA_SET_H
 #define _PAVA_SET_H
 #include "comparator.h"
+#include "slab.h"
+#include "stats.h"
 
 #include <stdlib.h> // size_t
+#include <limits.h> // CHAR_BIT
+
+// The thread pool the parallel calls run on, defined in pool.h
+typedef struct pool pool_t;
+
+// The number of lookups `set_count_many()` keeps in flight
+#define SET_BATCH 16
+
+// The number of pieces per thread the parallel calls cut their work into, so threads which finish early steal the rest
+#define SET_SPLIT 8
 
 struct set_node {
     struct set_node *left;
     struct set_node *right;
     struct set_node *parent;
-    int color;
+    size_t color : 1;
+    size_t weight : sizeof(size_t) * CHAR_BIT - 1; // The number of nodes in this subtree, maintained if the tree is ranked
 
     cmp_item_t key;
+    uint8_t small[CMP_INLINE]; // The key's data when it fits
 };
 
 struct set {
@@ -19,13 +33,27 @@ struct set {
     int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
 
     size_t size;
+    slab_t *slab; // Nodes and keys are allocated from here if it's not zero
+    int ranked;   // Whether subtree weights are maintained, see `set_enable_rank()`
+    struct ctypes_counters *stats; // Hot-path counters, zero unless built with CTYPES_STATS (see stats.h)
 };
 
 typedef struct set set_t;
 
+// A range of nodes in key order, from `first` to `last` (both included, or both zero if the range is empty)
+struct set_range {
+    struct set_node *first;
+    struct set_node *last;
+};
+
+typedef struct set_range set_range_t;
+
 // Returns a properly initialised `set_t`. Takes signum comparator as an argument
 extern set_t set_new(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
 
+// Returns a properly initialised `set_t` which allocates its nodes from its own slab allocator
+extern set_t set_new_slab(int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
 // Returns the number of elements
 extern size_t set_size(set_t S);
 
@@ -35,8 +63,122 @@ extern void set_insert(set_t *S, cmp_item_t key);
 // Deletes an element from the set
 extern void set_delete(set_t *S, cmp_item_t key);
 
+// Inserts `k` keys at once, sorting them first
+// Each key is searched from the node of the previous one, and a batch at least as big as the set rebuilds it without rotations
+extern void set_insert_batch(set_t *S, cmp_item_t *keys, size_t k);
+
+// Deletes `k` keys at once, the same way `set_insert_batch()` inserts them
+extern void set_delete_batch(set_t *S, cmp_item_t *keys, size_t k);
+
 // Returns the number of elements in the set
 extern int set_count(set_t S, cmp_item_t key);
 
+// Looks up `n` keys at once, storing whether each of them is present in `found` (if it's not zero)
+// Returns the number of keys present. Lookups are interleaved `SET_BATCH` at a time to overlap their cache misses
+extern size_t set_count_many(set_t S, cmp_item_t *keys, size_t n, int *found);
+
+// ---
+// Order statistics
+//
+// Ranked trees keep the size of every subtree, so selecting and ranking take O(log n).
+// Without it both functions fall back to walking the nodes in order.
+
+// Starts maintaining subtree weights, in O(n)
+extern void set_enable_rank(set_t *S);
+
+// Accesses the node with the `k`-th smallest key, counting from 0 (0 if there are not enough nodes)
+extern struct set_node *set_select(set_t S, size_t k);
+
+// Returns the number of keys less than `key`
+extern size_t set_rank(set_t S, cmp_item_t key);
+
+//
+// ---
+
+// ---
+// Iteration
+//
+// Nodes are visited in key order through their parent pointers, without allocations.
+// A node stays valid until it is deleted.
+
+// Accesses the node with the smallest key (0 if the set is empty)
+extern struct set_node *set_first(set_t S);
+
+// Accesses the node with the greatest key (0 if the set is empty)
+extern struct set_node *set_last(set_t S);
+
+// Accesses the node following `node` in key order (0 if it's the last one)
+extern struct set_node *set_next(struct set_node *node);
+
+// Accesses the node preceding `node` in key order (0 if it's the first one)
+extern struct set_node *set_prev(struct set_node *node);
+
+// Accesses the first node whose key is not less than `key` (0 if there is none)
+extern struct set_node *set_lower_bound(set_t S, cmp_item_t key);
+
+// Accesses the first node whose key is greater than `key` (0 if there is none)
+extern struct set_node *set_upper_bound(set_t S, cmp_item_t key);
+
+// Returns the range of nodes whose keys are between `lo` and `hi` (both included)
+extern set_range_t set_range(set_t S, cmp_item_t lo, cmp_item_t hi);
+
+// Accesses the node following `node` in the range (0 if it's the last one)
+extern struct set_node *set_range_next(set_range_t R, struct set_node *node);
+
+// Accesses the node preceding `node` in the range (0 if it's the first one)
+extern struct set_node *set_range_prev(set_range_t R, struct set_node *node);
+
+// Calls `fn(node, arg)` on every node, spread over the threads of `P` by subtree (a zero pool visits them in key order)
+// `fn` may run on several nodes at once, and must not insert or delete
+extern void set_for_each(set_t S, void (*fn)(struct set_node *node, void *arg), void *arg, pool_t *P);
+
+//
+// ---
+
+// Builds a set from `n` keys sorted in ascending order, in O(n) and without rotations
+// The nodes are allocated contiguously from the set's own slab, and equal keys are only inserted once
+extern set_t set_from_sorted(cmp_item_t *keys, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// Same as `set_from_sorted()`, but spreads comparing, copying and linking the keys over the threads of `P`
+// (The nodes are still allocated on the calling thread, the slab isn't thread-safe)
+extern set_t set_from_sorted_parallel(cmp_item_t *keys, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), pool_t *P);
+
+// Same as `set_from_sorted()`, but sorts the keys first
+extern set_t set_from_array(cmp_item_t *keys, size_t n, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// ---
+// Set algebra
+//
+// The results are new sets built like `set_from_sorted()` does, with the comparator of `A`.
+// Both sets must use the same comparator. Each operation walks both sets in order, in O(n + m),
+// or probes the bigger set with the keys of a much smaller one, in O(m log n).
+
+// Returns the keys present in `A` or in `B`
+extern set_t set_union(set_t A, set_t B);
+
+// Returns the keys present in both `A` and `B`
+extern set_t set_intersect(set_t A, set_t B);
+
+// Returns the keys of `A` which are missing from `B`
+extern set_t set_difference(set_t A, set_t B);
+
+// Returns a boolean value indicating whether or not every key of `A` is present in `B`
+extern int set_is_subset(set_t A, set_t B);
+
+// Same as `set_union()`, `set_intersect()` and `set_difference()`, but spread over the threads of `P`
+extern set_t set_union_parallel(set_t A, set_t B, pool_t *P);
+extern set_t set_intersect_parallel(set_t A, set_t B, pool_t *P);
+extern set_t set_difference_parallel(set_t A, set_t B, pool_t *P);
+
+//
+// ---
+
+// Returns the hot-path counters of `S` (all zero unless built with CTYPES_STATS)
+extern struct ctypes_stats set_stats(set_t S);
+
+// Removes all elements and releases the memory held by the set
+// (Releases the whole slab at once if the set has one)
+extern void set_free(set_t *S);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+// It's licensed under MIT, btw
+#define _POSIX_C_SOURCE 200809L
+#include "shard_set.h"
+
+#include <stddef.h> // size_t
+#include <stdlib.h> // aligned_alloc() and free()
+
+static struct shard *__shard(shard_set_t *S, cmp_item_t key) {
+    return &S->shards[S->hash(key) & (S->count - 1)];
+}
+
+shard_set_t *shard_set_new(size_t shards, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), uint64_t (*hash)(cmp_item_t key)) {
+    shard_set_t *S = (shard_set_t*)malloc(sizeof(shard_set_t));
+    size_t n = 1;
+
+    while (n < shards) n <<= 1;
+
+    S->count = n;
+    S->hash = hash ? hash : cmp_hash;
+    S->shards = (struct shard*)aligned_alloc(SHARD_SET_CACHE_LINE, n * sizeof(struct shard));
+    for (size_t i = 0; i < n; i++) {
+        pthread_rwlock_init(&S->shards[i].lock, 0);
+        S->shards[i].set = set_new_slab(sgn_cmp);
+        atomic_init(&S->shards[i].size, 0);
+    }
+
+    return S;
+}
+
+size_t shard_set_size(shard_set_t *S) {
+    size_t size = 0;
+
+    for (size_t i = 0; i < S->count; i++)
+        size += atomic_load_explicit(&S->shards[i].size, memory_order_relaxed);
+    return size;
+}
+
+void shard_set_insert(shard_set_t *S, cmp_item_t key) {
+    struct shard *H = __shard(S, key);
+
+    pthread_rwlock_wrlock(&H->lock);
+    set_insert(&H->set, key);
+    atomic_store_explicit(&H->size, H->set.size, memory_order_relaxed);
+    pthread_rwlock_unlock(&H->lock);
+}
+
+void shard_set_delete(shard_set_t *S, cmp_item_t key) {
+    struct shard *H = __shard(S, key);
+
+    pthread_rwlock_wrlock(&H->lock);
+    set_delete(&H->set, key);
+    atomic_store_explicit(&H->size, H->set.size, memory_order_relaxed);
+    pthread_rwlock_unlock(&H->lock);
+}
+
+int shard_set_count(shard_set_t *S, cmp_item_t key) {
+    struct shard *H = __shard(S, key);
+    int found;
+
+    pthread_rwlock_rdlock(&H->lock);
+    found = set_count(H->set, key);
+    pthread_rwlock_unlock(&H->lock);
+    return found;
+}
+
+void shard_set_free(shard_set_t *S) {
+    for (size_t i = 0; i < S->count; i++) {
+        set_free(&S->shards[i].set);
+        pthread_rwlock_destroy(&S->shards[i].lock);
+    }
+
+    free(S->shards);
+    free(S);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_SHARD_SET_H
+#define _CTYPES_SHARD_SET_H
+
+#include <stddef.h>    // size_t
+#include <stdint.h>    // uint64_t
+#include <stdatomic.h> // atomic_size_t
+#include <pthread.h>   // pthread_rwlock_t (POSIX, e.g. -std=gnu11 or _POSIX_C_SOURCE >= 200112L)
+
+#include "set.h"
+
+// The size of a cache line, every shard starts on its own
+#define SHARD_SET_CACHE_LINE 64
+
+// One independently locked part of a sharded set
+struct shard {
+    _Alignas(SHARD_SET_CACHE_LINE) pthread_rwlock_t lock;
+    set_t set;
+    atomic_size_t size; // A copy of `set.size` which can be read without the lock
+};
+
+// A set which can be shared between threads, obtained with `shard_set_new()`
+// Keys are spread over the shards by their hash, so threads working on different keys rarely touch the same lock
+// Keys which are equal for `sgn_cmp` must hash the same, or they end up in different shards
+struct shard_set {
+    size_t count; // The number of shards (a power of two)
+    struct shard *shards;
+    uint64_t (*hash)(cmp_item_t key);
+};
+
+typedef struct shard_set shard_set_t;
+
+
+// Returns an empty set split into at least `shards` shards, ordered by `sgn_cmp` within each shard
+// Takes a hash function for the keys (0 for `cmp_hash()`, which hashes their bytes)
+// `cmp_hash()` suits every comparator from comparator.h except `cmp_sgn_size()`, which makes keys of the same size equal,
+// and the floating-point ones when keys may be -0.0 and 0.0, or NaNs with different payloads
+extern shard_set_t *shard_set_new(size_t shards, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b), uint64_t (*hash)(cmp_item_t key));
+
+// Returns the number of elements, summed over the shards without locking them
+extern size_t shard_set_size(shard_set_t *S);
+
+// Inserts an element in the set
+extern void shard_set_insert(shard_set_t *S, cmp_item_t key);
+
+// Deletes an element from the set
+extern void shard_set_delete(shard_set_t *S, cmp_item_t key);
+
+// Returns a boolean value indicating whether or not `key` is present
+// Only takes the read lock of one shard
+extern int shard_set_count(shard_set_t *S, cmp_item_t key);
+
+// Removes all elements and releases the set
+// No other thread may be using the set
+extern void shard_set_free(shard_set_t *S);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+// It's licensed under MIT, btw
+#include "slab.h"
+
+#include <stdlib.h> // malloc() and free()
+#include <string.h> // memset()
+
+#define SLAB_MAX (SLAB_ALIGN * SLAB_CLASSES)
+
+// A chunk of memory, the objects follow the header
+struct slab_chunk {
+    struct slab_chunk *next;
+    size_t size;
+};
+
+// The unused end of a chunk, the header is stored in its first object
+struct slab_range {
+    struct slab_range *next;
+    uint8_t *end;
+};
+
+slab_t *slab_new() {
+    slab_t *P = (slab_t*)malloc(sizeof(slab_t));
+
+    memset(P, 0, sizeof(slab_t));
+    return P;
+}
+
+static size_t __class(size_t size) {
+    return size ? (size - 1) / SLAB_ALIGN : 0;
+}
+
+// Starts carving objects of class `c` from a new chunk with room for at least `n` of them
+static void __chunk_new(slab_t *P, size_t c, size_t n) {
+    size_t stride = (c + 1) * SLAB_ALIGN;
+    size_t size = sizeof(struct slab_chunk) + n * stride;
+    struct slab_chunk *chunk;
+    struct slab_range *range;
+
+    if (size < SLAB_CHUNK) size = SLAB_CHUNK;
+
+    // Whatever is left of the previous chunk is kept for later, after the objects reserved from this one
+    if ((size_t)(P->classes[c].end - P->classes[c].cur) >= stride) {
+        range = (struct slab_range*)P->classes[c].cur;
+        range->next = P->classes[c].spare;
+        range->end = P->classes[c].end;
+        P->classes[c].spare = range;
+    }
+
+    chunk = (struct slab_chunk*)malloc(size);
+    chunk->next = P->chunks;
+    chunk->size = size;
+    P->chunks = chunk;
+
+    P->classes[c].cur = (uint8_t*)(chunk + 1);
+    P->classes[c].end = (uint8_t*)chunk + size;
+}
+
+// Continues carving objects of class `c` from the newest spare range, or from a new chunk if there is none
+static void __refill(slab_t *P, size_t c) {
+    struct slab_range *range = P->classes[c].spare;
+
+    if (!range) {
+        __chunk_new(P, c, 1);
+        return;
+    }
+
+    P->classes[c].spare = range->next;
+    P->classes[c].cur = (uint8_t*)range;
+    P->classes[c].end = range->end;
+}
+
+void *slab_alloc(slab_t *P, size_t size) {
+    size_t c = __class(size);
+    size_t stride = (c + 1) * SLAB_ALIGN;
+    struct slab_big *big;
+    void *obj;
+
+    if (size > SLAB_MAX) {
+        big = (struct slab_big*)malloc(SLAB_ALIGN + size);
+        big->prev = 0;
+        big->next = P->big;
+        if (P->big) P->big->prev = big;
+        P->big = big;
+        return (uint8_t*)big + SLAB_ALIGN;
+    }
+
+    if (P->classes[c].free) {
+        obj = P->classes[c].free;
+        P->classes[c].free = *(void**)obj;
+        return obj;
+    }
+
+    if ((size_t)(P->classes[c].end - P->classes[c].cur) < stride) __refill(P, c);
+
+    obj = P->classes[c].cur;
+    P->classes[c].cur += stride;
+    return obj;
+}
+
+void slab_free(slab_t *P, void *ptr, size_t size) {
+    size_t c = __class(size);
+    struct slab_big *big;
+
+    if (!ptr) return;
+
+    if (size > SLAB_MAX) {
+        big = (struct slab_big*)((uint8_t*)ptr - SLAB_ALIGN);
+        if (big->prev) big->prev->next = big->next;
+        else P->big = big->next;
+        if (big->next) big->next->prev = big->prev;
+        free(big);
+        return;
+    }
+
+    *(void**)ptr = P->classes[c].free;
+    P->classes[c].free = ptr;
+}
+
+void slab_reserve(slab_t *P, size_t size, size_t n) {
+    size_t c = __class(size);
+    size_t stride = (c + 1) * SLAB_ALIGN;
+
+    if (size > SLAB_MAX) return;
+    if ((size_t)(P->classes[c].end - P->classes[c].cur) < n * stride) __chunk_new(P, c, n);
+}
+
+void slab_destroy(slab_t *P) {
+    struct slab_chunk *chunk;
+    struct slab_big *big;
+
+    if (!P) return;
+
+    while (P->chunks) {
+        chunk = P->chunks;
+        P->chunks = chunk->next;
+        free(chunk);
+    }
+    while (P->big) {
+        big = P->big;
+        P->big = big->next;
+        free(big);
+    }
+    free(P);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_SLAB_H
+#define _CTYPES_SLAB_H
+
+#include <stdlib.h> // size_t
+#include <stdint.h> // uint8_t
+
+// Objects are rounded up to a multiple of this many bytes
+#define SLAB_ALIGN 16
+
+// The number of size classes, objects bigger than `SLAB_ALIGN * SLAB_CLASSES` are allocated separately
+#define SLAB_CLASSES 16
+
+// The size of the chunks small objects are carved from
+#define SLAB_CHUNK 65536
+
+// A separately allocated object, linked so that the slab can release it
+struct slab_big {
+    struct slab_big *prev;
+    struct slab_big *next;
+};
+
+// The allocator itself, obtained with `slab_new()`
+// Small objects are carved from large chunks and recycled through a free list per size class
+struct slab {
+    struct slab_chunk *chunks;
+    struct slab_big *big;
+
+    struct {
+        void *free;   // Released objects of this class
+        uint8_t *cur; // The unused part of the chunk objects of this class are carved from
+        uint8_t *end;
+        struct slab_range *spare; // Unused ends of older chunks, carved once `cur` runs out
+    } classes[SLAB_CLASSES];
+};
+
+typedef struct slab slab_t;
+
+// Returns a new, empty slab allocator
+extern slab_t *slab_new();
+
+// Allocates `size` bytes
+extern void *slab_alloc(slab_t *P, size_t size);
+
+// Releases an object allocated with `slab_alloc()`, `size` must be the same as when it was allocated
+extern void slab_free(slab_t *P, void *ptr, size_t size);
+
+// Makes sure the next `n` allocations of `size` bytes are carved one after another from the same chunk
+// (As long as there are no released objects of that size to recycle)
+// Whatever was left of the previous chunk is carved once the reserved objects are used up
+extern void slab_reserve(slab_t *P, size_t size, size_t n);
+
+// Releases every object and the allocator itself at once
+extern void slab_destroy(slab_t *P);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,260 @@
+// It's licensed under MIT, btw
+#define _POSIX_C_SOURCE 200809L
+#include "snapshot.h"
+
+#include <stddef.h>   // size_t
+#include <stdio.h>    // fopen(), fwrite(), fclose(), rename() and remove()
+#include <string.h>   // memcpy() and memcmp()
+#include <stdlib.h>   // malloc() and free()
+#include <fcntl.h>    // open()
+#include <unistd.h>   // close() and fsync()
+#include <sys/mman.h> // mmap() and munmap()
+#include <sys/stat.h> // fstat()
+
+#define SNAPSHOT_ALIGN 8
+
+// Appended to the path of a snapshot while it's being written
+#define SNAPSHOT_TMP ".tmp"
+
+// ---
+// writer helpers
+//
+// The elements are collected in key order, laid out in Eytzinger order,
+// and written with their blobs in one sequential pass.
+
+// Fills `order` so that `order[k - 1]` is the sorted index of the k-th node of the implicit tree
+static size_t __eytzinger(size_t *order, size_t n, size_t k, size_t i) {
+    if (k > n) return i;
+
+    i = __eytzinger(order, n, 2 * k, i);
+    order[k - 1] = i++;
+    return __eytzinger(order, n, 2 * k + 1, i);
+}
+
+static uint64_t __blob_size(size_t size) {
+    return size <= sizeof(uint64_t) ? 0 : (size + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+// Stores the data of a small item in `field`, or assigns it the next blob offset
+static void __place(uint64_t *field, cmp_item_t item, uint64_t *offset) {
+    *field = 0;
+    if (item.size <= sizeof(uint64_t)) {
+        if (item.size) memcpy(field, item.data, item.size);
+    } else {
+        *field = *offset;
+        *offset += __blob_size(item.size);
+    }
+}
+
+static int __blob_write(FILE *f, cmp_item_t item) {
+    static const uint8_t pad[SNAPSHOT_ALIGN] = {0};
+    uint64_t size = __blob_size(item.size);
+
+    if (!size) return 1;
+    return fwrite(item.data, 1, item.size, f) == item.size && fwrite(pad, 1, size - item.size, f) == size - item.size;
+}
+
+static int __write(const char *path, cmp_item_t *keys, cmp_item_t *values, size_t n, uint32_t flags) {
+    struct snapshot_header header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, SNAPSHOT_ORDER, flags, 0, n, sizeof(struct snapshot_header), 0};
+    struct snapshot_entry *index = (struct snapshot_entry*)malloc((n ? n : 1) * sizeof(struct snapshot_entry));
+    size_t *order = (size_t*)malloc((n ? n : 1) * sizeof(size_t));
+    uint64_t offset = header.index + n * sizeof(struct snapshot_entry);
+    char *tmp = (char*)malloc(strlen(path) + sizeof(SNAPSHOT_TMP));
+    FILE *f;
+    int ok;
+
+    __eytzinger(order, n, 1, 0);
+
+    // Blobs follow the index in the same (Eytzinger) order, so the whole file is written front to back
+    for (size_t k = 0; k < n; k++) {
+        size_t i = order[k];
+        index[k].key_size = keys[i].size;
+        index[k].value_size = values[i].size;
+        __place(&index[k].key, keys[i], &offset);
+        __place(&index[k].value, values[i], &offset);
+    }
+    header.length = offset;
+
+    // The file is written next to `path` and renamed over it once it's on disk,
+    // so processes which still have the old snapshot mapped keep reading the old file
+    snprintf(tmp, strlen(path) + sizeof(SNAPSHOT_TMP), "%s" SNAPSHOT_TMP, path);
+    ok = (f = fopen(tmp, "wb")) != 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(index, sizeof(struct snapshot_entry), n, f) == n;
+    for (size_t k = 0; ok && k < n; k++)
+        ok = __blob_write(f, keys[order[k]]) && __blob_write(f, values[order[k]]);
+    ok = ok && !fflush(f) && !fsync(fileno(f));
+    if (f && fclose(f)) ok = 0;
+    ok = ok && !rename(tmp, path);
+    if (f && !ok) remove(tmp);
+
+    free(tmp);
+    free(order);
+    free(index);
+    return ok;
+}
+
+// ---
+
+int snapshot_write_set(set_t S, const char *path) {
+    cmp_item_t *keys = (cmp_item_t*)malloc((S.size ? S.size : 1) * sizeof(cmp_item_t));
+    cmp_item_t *values = (cmp_item_t*)calloc(S.size ? S.size : 1, sizeof(cmp_item_t));
+    size_t n = 0;
+    int ok;
+
+    for (struct set_node *node = set_first(S); node; node = set_next(node)) keys[n++] = node->key;
+    ok = __write(path, keys, values, n, 0);
+
+    free(values);
+    free(keys);
+    return ok;
+}
+
+int snapshot_write_map(map_t M, const char *path) {
+    cmp_item_t *keys = (cmp_item_t*)malloc((M.size ? M.size : 1) * sizeof(cmp_item_t));
+    cmp_item_t *values = (cmp_item_t*)malloc((M.size ? M.size : 1) * sizeof(cmp_item_t));
+    size_t n = 0;
+    int ok;
+
+    for (struct map_node *node = map_first(M); node; node = map_next(node), n++) {
+        keys[n] = node->key;
+        values[n] = node->value;
+    }
+    ok = __write(path, keys, values, n, SNAPSHOT_MAP);
+
+    free(values);
+    free(keys);
+    return ok;
+}
+
+
+// ---
+// reader helpers
+
+static cmp_item_t __item(snapshot_t V, const uint64_t *field, uint64_t size) {
+    const void *data = size <= sizeof(uint64_t) ? (const void*)field : (const void*)(V.base + *field);
+    return cmp_item_new((void*)data, size);
+}
+
+// Is an item of `size` bytes stored in `field` within the blobs of the file?
+static int __valid_item(uint64_t field, uint64_t size, uint64_t blobs, size_t length) {
+    if (size <= sizeof(uint64_t)) return 1;
+    return field >= blobs && field <= length && size <= length - field;
+}
+
+static int __valid(const struct snapshot_header *H, size_t length) {
+    const struct snapshot_entry *index = (const struct snapshot_entry*)((const uint8_t*)H + sizeof(struct snapshot_header));
+    uint64_t blobs;
+
+    if (length < sizeof(struct snapshot_header)) return 0;
+    if (memcmp(H->magic, SNAPSHOT_MAGIC, sizeof(H->magic))) return 0;
+    if (H->version != SNAPSHOT_VERSION || H->order != SNAPSHOT_ORDER) return 0;
+    if (H->length != length || H->index != sizeof(struct snapshot_header)) return 0;
+    if (H->size > (length - H->index) / sizeof(struct snapshot_entry)) return 0;
+
+    // Every blob must lie after the index and inside the file, so no lookup reads past the mapping
+    blobs = H->index + H->size * sizeof(struct snapshot_entry);
+    for (uint64_t k = 0; k < H->size; k++) {
+        if (!__valid_item(index[k].key, index[k].key_size, blobs, length)) return 0;
+        if (!__valid_item(index[k].value, index[k].value_size, blobs, length)) return 0;
+    }
+    return 1;
+}
+
+// ---
+
+snapshot_t snapshot_open(const char *path, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b)) {
+    snapshot_t V = {0, 0, 0, 0, sgn_cmp};
+    struct stat st;
+    void *base;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) return V;
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(struct snapshot_header)) {
+        close(fd);
+        return V;
+    }
+
+    // The mapping outlives the descriptor
+    base = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return V;
+
+    const struct snapshot_header *H = (const struct snapshot_header*)base;
+    if (!__valid(H, (size_t)st.st_size)) {
+        munmap(base, (size_t)st.st_size);
+        return V;
+    }
+
+    V.base = (const uint8_t*)base;
+    V.length = (size_t)st.st_size;
+    V.size = H->size;
+    V.index = (const struct snapshot_entry*)(V.base + H->index);
+    return V;
+}
+
+void snapshot_close(snapshot_t *V) {
+    if (V->base) munmap((void*)V->base, V->length);
+    V->base = 0;
+    V->index = 0;
+    V->length = 0;
+    V->size = 0;
+}
+
+size_t snapshot_size(snapshot_t V) {
+    return V.size;
+}
+
+
+size_t snapshot_lower_bound(snapshot_t V, cmp_item_t key) {
+    size_t k = 1;
+
+    // Descend the implicit tree without branching on the comparison, then undo the right turns taken after the last left one
+    while (k <= V.size) {
+        const struct snapshot_entry *E = &V.index[k - 1];
+        k = 2 * k + (V.sgn_cmp(__item(V, &E->key, E->key_size), key) < 0);
+    }
+
+    k >>= __builtin_ffsll((long long)~k);
+    return k;
+}
+
+int snapshot_count(snapshot_t V, cmp_item_t key) {
+    size_t k = snapshot_lower_bound(V, key);
+    return k && !V.sgn_cmp(snapshot_key(V, k), key);
+}
+
+cmp_item_t snapshot_find(snapshot_t V, cmp_item_t key) {
+    size_t k = snapshot_lower_bound(V, key);
+
+    if (!k || V.sgn_cmp(snapshot_key(V, k), key)) return cmp_item_new(0, 0);
+    return snapshot_value(V, k);
+}
+
+
+size_t snapshot_first(snapshot_t V) {
+    size_t k = V.size ? 1 : 0;
+
+    while (k && 2 * k <= V.size) k *= 2;
+    return k;
+}
+
+size_t snapshot_next(snapshot_t V, size_t k) {
+    if (2 * k + 1 <= V.size) {
+        k = 2 * k + 1;
+        while (2 * k <= V.size) k *= 2;
+        return k;
+    }
+
+    // Climb while coming from a right child, the parent after the first left child is next
+    while (k & 1) k >>= 1;
+    return k >> 1;
+}
+
+cmp_item_t snapshot_key(snapshot_t V, size_t k) {
+    return __item(V, &V.index[k - 1].key, V.index[k - 1].key_size);
+}
+
+cmp_item_t snapshot_value(snapshot_t V, size_t k) {
+    return __item(V, &V.index[k - 1].value, V.index[k - 1].value_size);
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_SNAPSHOT_H
+#define _CTYPES_SNAPSHOT_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t, uint32_t and uint64_t
+
+#include "comparator.h"
+#include "set.h"
+#include "map.h"
+
+// ---
+// File format
+//
+// A snapshot is a pointer-free image of a set or a map which is queried in place after `mmap()`.
+// It's made of a header, an index of `size` entries in Eytzinger (breadth-first) order and the key/value blobs.
+// All numbers are native-endian, `order` tells whether the file was written on a machine of the same byte order.
+
+#define SNAPSHOT_MAGIC "CTYPSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ORDER 0x01020304u
+
+// Set in `flags` if the snapshot was written from a map
+#define SNAPSHOT_MAP 1
+
+struct snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t size;   // The number of entries
+    uint64_t index;  // The offset of the first entry
+    uint64_t length; // The size of the whole file
+};
+
+// Keys and values up to 8 bytes are stored in the entry itself, bigger ones are offsets of blobs
+struct snapshot_entry {
+    uint64_t key_size;
+    uint64_t value_size;
+    uint64_t key;
+    uint64_t value;
+};
+
+//
+// ---
+
+// A read-only view of a snapshot file, obtained with `snapshot_open()`
+struct snapshot {
+    const uint8_t *base; // The mapping, zero if the file couldn't be opened
+    size_t length;
+    size_t size;
+    const struct snapshot_entry *index; // The entries, `index[k - 1]` is the k-th node of the implicit tree
+    int (*sgn_cmp)(cmp_item_t a, cmp_item_t b);
+};
+
+typedef struct snapshot snapshot_t;
+
+
+// Writes the keys of `S` to `path`, in O(n)
+// The file is written to `path` with ".tmp" appended, synced, then renamed over `path`
+// Returns 0 if the file couldn't be written
+extern int snapshot_write_set(set_t S, const char *path);
+
+// Writes the keys and values of `M` to `path`, in O(n)
+// Returns 0 if the file couldn't be written
+extern int snapshot_write_map(map_t M, const char *path);
+
+
+// Maps the snapshot at `path` read-only, its keys are compared with `sgn_cmp` (which must be the one the set or map used)
+// The index is checked in O(n) so that no query reads outside the file, the blobs are only read when queried
+// `base` is zero if the file is missing or not a valid snapshot
+extern snapshot_t snapshot_open(const char *path, int (*sgn_cmp)(cmp_item_t a, cmp_item_t b));
+
+// Unmaps the snapshot, every item obtained from it becomes invalid
+extern void snapshot_close(snapshot_t *V);
+
+// Returns the number of elements
+extern size_t snapshot_size(snapshot_t V);
+
+
+// Returns a boolean value indicating whether or not `key` is present
+extern int snapshot_count(snapshot_t V, cmp_item_t key);
+
+// Returns the value of `key`, pointing into the mapping ({0, 0} if the key is missing)
+extern cmp_item_t snapshot_find(snapshot_t V, cmp_item_t key);
+
+
+// ---
+// Iteration
+//
+// Positions are 1-based indices of the implicit tree, 0 stands for "none".
+// Walking with `snapshot_next()` visits the keys in ascending order.
+
+// Returns the position of the smallest key (0 if the snapshot is empty)
+extern size_t snapshot_first(snapshot_t V);
+
+// Returns the position following `pos` in key order (0 if it's the last one)
+extern size_t snapshot_next(snapshot_t V, size_t pos);
+
+// Returns the position of the first key not less than `key` (0 if there is none)
+extern size_t snapshot_lower_bound(snapshot_t V, cmp_item_t key);
+
+// Accesses the key at `pos`
+extern cmp_item_t snapshot_key(snapshot_t V, size_t pos);
+
+// Accesses the value at `pos` (empty for snapshots of sets)
+extern cmp_item_t snapshot_value(snapshot_t V, size_t pos);
+
+//
+// ---
+
+#endif
\ No newline at end of file
@@ -0,0 +1,194 @@
+// It's licensed under MIT, btw
+#define _POSIX_C_SOURCE 200809L
+#include "spill_queue.h"
+
+#include <stddef.h> // size_t
+#include <stdio.h>  // snprintf()
+#include <string.h> // memcpy(), strlen() and strcpy()
+#include <stdlib.h> // malloc(), realloc() and free()
+#include <errno.h>  // errno and EINTR
+#include <fcntl.h>  // open()
+#include <unistd.h> // write(), pread(), close(), unlink() and getpid()
+
+#define SPILL_ALIGN 8
+
+// ---
+// segment helpers
+//
+// Records are appended to the tail segment. A full tail is either handed over to the head directly
+// (when nothing is spilled and the head is used up) or written to its own file with a single `write()`.
+// The head is refilled from the oldest file with a single `pread()` into its preallocated buffer.
+
+static size_t __record_size(size_t size) {
+    return sizeof(size_t) + (size + SPILL_ALIGN - 1) / SPILL_ALIGN * SPILL_ALIGN;
+}
+
+static void __reserve(struct spill_segment *G, size_t capacity) {
+    if (G->capacity >= capacity) return;
+
+    G->data = (uint8_t*)realloc(G->data, capacity);
+    G->capacity = capacity;
+}
+
+static void __path(spill_queue_t *Q, uint64_t id, char *path, size_t n) {
+    snprintf(path, n, "%s/ctypes-spill-%ld-%p-%llu.seg", Q->dir, (long)getpid(), (void*)Q, (unsigned long long)id);
+}
+
+static int __spill(spill_queue_t *Q) {
+    char path[4096];
+    struct spill_file F = {Q->next_id, Q->tail.length};
+    size_t done = 0;
+    int fd;
+
+    __path(Q, F.id, path, sizeof(path));
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0) return 0;
+
+    while (done < F.length) {
+        ssize_t n = write(fd, Q->tail.data + done, F.length - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(fd);
+            unlink(path);
+            return 0;
+        }
+        done += (size_t)n;
+    }
+    close(fd);
+
+    Q->next_id++;
+    queue_push(&Q->spilled, &F, sizeof(F));
+    Q->tail.length = 0;
+    return 1;
+}
+
+static int __unspill(spill_queue_t *Q) {
+    char path[4096];
+    struct spill_file F;
+    size_t done = 0;
+    int fd;
+
+    memcpy(&F, queue_front(Q->spilled), sizeof(F));
+    __path(Q, F.id, path, sizeof(path));
+    if ((fd = open(path, O_RDONLY)) < 0) return 0;
+
+    __reserve(&Q->head, F.length);
+    while (done < F.length) {
+        ssize_t n = pread(fd, Q->head.data + done, F.length - done, (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(fd);
+            return 0;
+        }
+        done += (size_t)n;
+    }
+    close(fd);
+    unlink(path);
+
+    queue_pop(&Q->spilled);
+    Q->head.length = F.length;
+    Q->head.pos = 0;
+    return 1;
+}
+
+static void __swap(spill_queue_t *Q) {
+    struct spill_segment G = Q->head;
+
+    Q->head = Q->tail;
+    Q->head.pos = 0;
+    Q->tail = G;
+    Q->tail.length = 0;
+}
+
+// Makes sure the head holds the first element, returns 0 if that's impossible
+static int __head_ready(spill_queue_t *Q) {
+    if (Q->head.pos < Q->head.length) return 1;
+    if (!Q->size) return 0;
+
+    if (!queue_empty(Q->spilled)) return __unspill(Q);
+    __swap(Q);
+    return 1;
+}
+
+// ---
+
+spill_queue_t *spill_queue_new(const char *dir, size_t segment) {
+    spill_queue_t *Q = (spill_queue_t*)calloc(1, sizeof(spill_queue_t));
+
+    Q->segment = segment ? segment : SPILL_SEGMENT;
+    Q->dir = (char*)malloc(strlen(dir) + 1);
+    strcpy(Q->dir, dir);
+    Q->spilled = queue_new_ring(sizeof(struct spill_file));
+
+    __reserve(&Q->head, Q->segment);
+    __reserve(&Q->tail, Q->segment);
+    return Q;
+}
+
+int spill_queue_empty(spill_queue_t *Q) {
+    return !(Q->size);
+}
+
+size_t spill_queue_size(spill_queue_t *Q) {
+    return Q->size;
+}
+
+
+void *spill_queue_front(spill_queue_t *Q) {
+    if (!__head_ready(Q)) return 0;
+    return Q->head.data + Q->head.pos + sizeof(size_t);
+}
+
+size_t spill_queue_front_size(spill_queue_t *Q) {
+    size_t size;
+
+    if (!__head_ready(Q)) return 0;
+    memcpy(&size, Q->head.data + Q->head.pos, sizeof(size_t));
+    return size;
+}
+
+
+int spill_queue_push(spill_queue_t *Q, void *item, size_t size) {
+    size_t record = __record_size(size);
+
+    if (Q->tail.length && Q->tail.length + record > Q->tail.capacity) {
+        if (queue_empty(Q->spilled) && Q->head.pos == Q->head.length) __swap(Q);
+        else if (!__spill(Q)) return 0;
+    }
+
+    // A record bigger than a segment gets a segment of its own
+    __reserve(&Q->tail, record);
+
+    memcpy(Q->tail.data + Q->tail.length, &size, sizeof(size_t));
+    memcpy(Q->tail.data + Q->tail.length + sizeof(size_t), item, size);
+    Q->tail.length += record;
+    Q->size++;
+    return 1;
+}
+
+void spill_queue_pop(spill_queue_t *Q) {
+    size_t size;
+
+    if (!__head_ready(Q)) return;
+
+    memcpy(&size, Q->head.data + Q->head.pos, sizeof(size_t));
+    Q->head.pos += __record_size(size);
+    Q->size--;
+}
+
+void spill_queue_free(spill_queue_t *Q) {
+    char path[4096];
+
+    while (!queue_empty(Q->spilled)) {
+        struct spill_file F;
+        memcpy(&F, queue_front(Q->spilled), sizeof(F));
+        __path(Q, F.id, path, sizeof(path));
+        unlink(path);
+        queue_pop(&Q->spilled);
+    }
+
+    queue_free(&Q->spilled);
+    free(Q->head.data);
+    free(Q->tail.data);
+    free(Q->dir);
+    free(Q);
+}
\ No newline at end of file
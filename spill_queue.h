@@ -0,0 +1,72 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_SPILL_QUEUE_H
+#define _CTYPES_SPILL_QUEUE_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t and uint64_t
+
+#include "queue.h"
+
+// The default size of a segment in bytes
+#define SPILL_SEGMENT (1 << 20)
+
+// A buffer of consecutive records, every record is its size followed by the payload (padded to 8 bytes)
+struct spill_segment {
+    uint8_t *data;
+    size_t capacity;
+    size_t length; // The number of bytes in use
+    size_t pos;    // The offset of the first unread record
+};
+
+// A queue which keeps only its first and last segment in memory and spills the ones in between to files,
+// obtained with `spill_queue_new()`
+struct spill_queue {
+    size_t size;
+    size_t segment;   // The size of a segment in bytes (a single bigger record gets a segment of its own)
+    char *dir;        // Where the spilled segments are written
+    uint64_t next_id; // The number of the next spilled segment
+
+    struct spill_segment head; // Being read by `spill_queue_front()` and `spill_queue_pop()`
+    struct spill_segment tail; // Being filled by `spill_queue_push()`
+    queue_t spilled;           // The spilled segments in order, as `struct spill_file`
+};
+
+// A spilled segment
+struct spill_file {
+    uint64_t id;
+    uint64_t length;
+};
+
+typedef struct spill_queue spill_queue_t;
+
+
+// Returns an empty queue spilling to `dir` in segments of `segment` bytes (0 picks `SPILL_SEGMENT`)
+extern spill_queue_t *spill_queue_new(const char *dir, size_t segment);
+
+// Returns a boolean value indicating whether or not `Q` is empty
+extern int spill_queue_empty(spill_queue_t *Q);
+
+// Returns the number of elements, in memory and on disk
+extern size_t spill_queue_size(spill_queue_t *Q);
+
+
+// Accesses the first element, reading its segment back if it was spilled
+// Returns 0 if the queue is empty or the segment couldn't be read
+// The pointer is valid until the element is popped
+extern void *spill_queue_front(spill_queue_t *Q);
+
+// Returns the size of the first element (0 if the queue is empty)
+extern size_t spill_queue_front_size(spill_queue_t *Q);
+
+
+// Copies an element to the end of the queue, spilling the last segment when it's full
+// Returns 0 if the segment couldn't be written (the element is not inserted then)
+extern int spill_queue_push(spill_queue_t *Q, void *item, size_t size);
+
+// Removes the first element
+extern void spill_queue_pop(spill_queue_t *Q);
+
+// Removes all elements, deletes the spilled files and releases the queue
+extern void spill_queue_free(spill_queue_t *Q);
+
+#endif
\ No newline at end of file
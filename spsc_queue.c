@@ -0,0 +1,173 @@
+// It's licensed under MIT, btw
+#include "spsc_queue.h"
+
+#include <stddef.h> // size_t
+#include <string.h> // memcpy()
+#include <stdlib.h> // aligned_alloc(), malloc() and free()
+
+#define SPSC_QUEUE_MIN 2
+
+// ---
+// slot helpers
+//
+// Every slot starts with the size of its item, followed by the payload.
+// Items that do not fit into `slot` bytes keep a pointer to a separate copy instead.
+
+static uint8_t *__slot_at(spsc_queue_t *Q, size_t pos) {
+    return Q->ring + (pos & (Q->capacity - 1)) * Q->stride;
+}
+
+static void *__slot_item(spsc_queue_t *Q, uint8_t *slot) {
+    size_t size;
+
+    memcpy(&size, slot, sizeof(size_t));
+    if (size > Q->slot) return *(void**)(slot + sizeof(size_t));
+    return slot + sizeof(size_t);
+}
+
+static void __slot_store(spsc_queue_t *Q, uint8_t *slot, void *item, size_t size) {
+    memcpy(slot, &size, sizeof(size_t));
+
+    if (size > Q->slot) {
+        void *copy = malloc(size);
+        memcpy(copy, item, size);
+        memcpy(slot + sizeof(size_t), &copy, sizeof(void*));
+    } else {
+        memcpy(slot + sizeof(size_t), item, size);
+    }
+}
+
+static void __slot_release(spsc_queue_t *Q, uint8_t *slot) {
+    size_t size;
+
+    memcpy(&size, slot, sizeof(size_t));
+    if (size > Q->slot) free(*(void**)(slot + sizeof(size_t)));
+}
+
+static size_t __round_up(size_t x, size_t to) {
+    return (x + to - 1) / to * to;
+}
+
+// Returns the number of free slots as seen by the producer, re-reading `tail` only if fewer than `want` are known
+static size_t __room(spsc_queue_t *Q, size_t head, size_t want) {
+    size_t room = Q->capacity - (head - Q->tail_cache);
+
+    if (room < want) {
+        Q->tail_cache = atomic_load_explicit(&Q->tail, memory_order_acquire);
+        room = Q->capacity - (head - Q->tail_cache);
+    }
+    return room;
+}
+
+// Returns the number of elements as seen by the consumer, re-reading `head` only if fewer than `want` are known
+static size_t __ready(spsc_queue_t *Q, size_t tail, size_t want) {
+    size_t ready = Q->head_cache - tail;
+
+    if (ready < want) {
+        Q->head_cache = atomic_load_explicit(&Q->head, memory_order_acquire);
+        ready = Q->head_cache - tail;
+    }
+    return ready;
+}
+
+// ---
+
+spsc_queue_t *spsc_queue_new(size_t capacity, size_t slot) {
+    spsc_queue_t *Q = (spsc_queue_t*)aligned_alloc(SPSC_CACHE_LINE, __round_up(sizeof(spsc_queue_t), SPSC_CACHE_LINE));
+    size_t n = SPSC_QUEUE_MIN;
+
+    while (n < capacity) n <<= 1;
+
+    atomic_init(&Q->head, 0);
+    atomic_init(&Q->tail, 0);
+    Q->tail_cache = 0;
+    Q->head_cache = 0;
+
+    // An oversized item stores a pointer in its slot, so there must be room for one
+    Q->capacity = n;
+    Q->slot = slot < sizeof(void*) ? sizeof(void*) : slot;
+    Q->stride = sizeof(size_t) + __round_up(Q->slot, sizeof(size_t));
+    Q->ring = (uint8_t*)aligned_alloc(SPSC_CACHE_LINE, __round_up(n * Q->stride, SPSC_CACHE_LINE));
+    return Q;
+}
+
+int spsc_queue_empty(spsc_queue_t *Q) {
+    return !__ready(Q, atomic_load_explicit(&Q->tail, memory_order_relaxed), 1);
+}
+
+size_t spsc_queue_size(spsc_queue_t *Q) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&Q->head, memory_order_acquire);
+
+    return head - tail;
+}
+
+
+void *spsc_queue_front(spsc_queue_t *Q) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+
+    if (!__ready(Q, tail, 1)) return 0;
+    return __slot_item(Q, __slot_at(Q, tail));
+}
+
+
+int spsc_queue_push(spsc_queue_t *Q, void *item, size_t size) {
+    size_t head = atomic_load_explicit(&Q->head, memory_order_relaxed);
+
+    if (!__room(Q, head, 1)) return 0;
+
+    __slot_store(Q, __slot_at(Q, head), item, size);
+    atomic_store_explicit(&Q->head, head + 1, memory_order_release);
+    return 1;
+}
+
+size_t spsc_queue_push_n(spsc_queue_t *Q, void *items, size_t size, size_t n) {
+    size_t head = atomic_load_explicit(&Q->head, memory_order_relaxed);
+    size_t room = __room(Q, head, n);
+
+    if (n > room) n = room;
+    for (size_t i = 0; i < n; i++)
+        __slot_store(Q, __slot_at(Q, head + i), (uint8_t*)items + i * size, size);
+
+    if (n) atomic_store_explicit(&Q->head, head + n, memory_order_release);
+    return n;
+}
+
+int spsc_queue_pop(spsc_queue_t *Q) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+
+    if (!__ready(Q, tail, 1)) return 0;
+
+    __slot_release(Q, __slot_at(Q, tail));
+    atomic_store_explicit(&Q->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+size_t spsc_queue_pop_n(spsc_queue_t *Q, void *items, size_t size, size_t n) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+    size_t ready = __ready(Q, tail, n);
+
+    if (n > ready) n = ready;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *slot = __slot_at(Q, tail + i);
+        size_t len;
+
+        memcpy(&len, slot, sizeof(size_t));
+        memcpy((uint8_t*)items + i * size, __slot_item(Q, slot), len < size ? len : size);
+        __slot_release(Q, slot);
+    }
+
+    if (n) atomic_store_explicit(&Q->tail, tail + n, memory_order_release);
+    return n;
+}
+
+void spsc_queue_free(spsc_queue_t *Q) {
+    size_t tail = atomic_load_explicit(&Q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&Q->head, memory_order_relaxed);
+
+    for (size_t pos = tail; pos != head; pos++)
+        __slot_release(Q, __slot_at(Q, pos));
+
+    free(Q->ring);
+    free(Q);
+}
\ No newline at end of file
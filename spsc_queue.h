@@ -0,0 +1,71 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_SPSC_QUEUE_H
+#define _CTYPES_SPSC_QUEUE_H
+
+#include <stdlib.h>    // size_t
+#include <stdint.h>    // uint8_t
+#include <stdatomic.h> // atomic_size_t
+
+// The size of a cache line, the producer's and the consumer's fields are kept on separate ones
+#define SPSC_CACHE_LINE 64
+
+// A bounded queue between exactly one producer thread and one consumer thread, obtained with `spsc_queue_new()`
+// Both sides keep a private copy of the other side's index and only re-read it when the copy says full or empty
+struct spsc_queue
+{
+    // Written by the producer
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head; // The position of the next push
+    size_t tail_cache;                            // The last `tail` seen by the producer
+
+    // Written by the consumer
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail; // The position of the first element
+    size_t head_cache;                            // The last `head` seen by the consumer
+
+    _Alignas(SPSC_CACHE_LINE) size_t capacity; // The number of slots (a power of two)
+    size_t slot;   // The number of payload bytes stored inline in every slot
+    size_t stride; // The size of a slot
+    uint8_t *ring;
+};
+
+typedef struct spsc_queue spsc_queue_t;
+
+
+// Returns a new queue with room for at least `capacity` items
+// Items up to `slot` bytes are stored inline, bigger ones are allocated separately
+extern spsc_queue_t *spsc_queue_new(size_t capacity, size_t slot);
+
+// Returns a boolean value indicating whether or not `Q` is empty (consumer side)
+extern int spsc_queue_empty(spsc_queue_t *Q);
+
+// Returns the number of elements (only a snapshot while the other side is running)
+extern size_t spsc_queue_size(spsc_queue_t *Q);
+
+
+// Accesses the first element, or returns 0 if the queue is empty (consumer side)
+// The pointer is valid until the element is popped
+extern void* spsc_queue_front(spsc_queue_t *Q);
+
+
+// Copies an element to the end of the queue (producer side)
+// Returns 0 if the queue is full
+extern int spsc_queue_push(spsc_queue_t *Q, void *item, size_t size);
+
+// Copies up to `n` elements of `size` bytes each, laid out one after another in `items` (producer side)
+// All of them become visible to the consumer at once
+// Returns the number of elements pushed
+extern size_t spsc_queue_push_n(spsc_queue_t *Q, void *items, size_t size, size_t n);
+
+// Removes the first element (consumer side)
+// Returns 0 if the queue is empty
+extern int spsc_queue_pop(spsc_queue_t *Q);
+
+// Moves up to `n` elements into `items`, `size` bytes each, one after another (consumer side)
+// (Bigger elements are truncated)
+// Returns the number of elements popped
+extern size_t spsc_queue_pop_n(spsc_queue_t *Q, void *items, size_t size, size_t n);
+
+// Releases the queue and the elements left in it
+// Neither side may be using the queue
+extern void spsc_queue_free(spsc_queue_t *Q);
+
+#endif
\ No newline at end of file
@@ -25,8 +25,9 @@ size_t stack_size(stack_t S) {
 void stack_push(stack_t *S, void *item, size_t size) {
     struct stack_item *newi = (struct stack_item*)malloc(sizeof(struct stack_item));
 
-    newi->item = malloc(size);
+    newi->item = size <= STACK_INLINE ? newi->small : malloc(size);
     memcpy((void*)newi->item, item, size);
+    newi->size = size;
 
     if (stack_empty(*S)) {
         S->head = newi;
@@ -43,7 +44,7 @@ void stack_pop(stack_t *S) {
     if (stack_empty(*S)) return;
 
     struct stack_item *oldi = S->head;
-    free(oldi->item);
+    if (oldi->item != oldi->small) free(oldi->item);
 
     if (S->head->prev == 0) {
         S->head = 0;
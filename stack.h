@@ -3,12 +3,19 @@
 #define _CTYPES_STACK_H
 
 #include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+
+// Items up to this many bytes are stored inside the stack item
+#define STACK_INLINE 16
 
 
 // The item stored in the stack
 struct stack_item {
-    void *item;
+    void *item; // Points to `small` if the item fits
+    size_t size;
     struct stack_item *prev;
+
+    uint8_t small[STACK_INLINE];
 };
 
 // The stack itself. Should be assingned the value of `stack_new()` or zeroed manually
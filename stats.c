@@ -0,0 +1,35 @@
+// It's licensed under MIT, btw
+#include "stats.h"
+
+#include <stdlib.h> // calloc() and free()
+
+struct ctypes_counters *stats_new(void) {
+#ifdef CTYPES_STATS
+    return (struct ctypes_counters*)calloc(1, sizeof(struct ctypes_counters));
+#else
+    return 0;
+#endif
+}
+
+struct ctypes_stats stats_read(struct ctypes_counters *C) {
+    struct ctypes_stats out = {0};
+
+#ifdef CTYPES_STATS
+    if (!C) return out;
+
+    out.finds = atomic_load_explicit(&C->finds, memory_order_relaxed);
+    out.visited = atomic_load_explicit(&C->visited, memory_order_relaxed);
+    out.compares = atomic_load_explicit(&C->compares, memory_order_relaxed);
+    out.rotations = atomic_load_explicit(&C->rotations, memory_order_relaxed);
+    out.allocs = atomic_load_explicit(&C->allocs, memory_order_relaxed);
+    out.frees = atomic_load_explicit(&C->frees, memory_order_relaxed);
+    out.bytes = atomic_load_explicit(&C->bytes, memory_order_relaxed);
+#else
+    (void)C;
+#endif
+    return out;
+}
+
+void stats_free(struct ctypes_counters *C) {
+    free(C);
+}
\ No newline at end of file
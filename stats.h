@@ -0,0 +1,52 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_STATS_H
+#define _CTYPES_STATS_H
+
+#include <stddef.h> // size_t
+
+// Hot-path counters for `set_t` and `map_t`
+//
+// They are only maintained when the library is built with -DCTYPES_STATS, otherwise containers carry a zero pointer
+// and every update compiles to nothing. Updates are relaxed atomics, so concurrent readers (see cmap.h) can be counted too.
+
+// A snapshot of the counters of one container
+struct ctypes_stats {
+    size_t finds;     // Descents from the root (lookups, inserts and deletes)
+    size_t visited;   // Nodes visited by those descents
+    size_t compares;  // Comparator invocations on the lookup and insert paths
+    size_t rotations; // Rotations while rebalancing after inserts and deletes
+    size_t allocs;    // Allocations of nodes and out-of-line payloads
+    size_t frees;     // Releases of the same
+    size_t bytes;     // Bytes currently held by those allocations
+};
+
+#ifdef CTYPES_STATS
+
+#include <stdatomic.h> // atomic_size_t
+
+struct ctypes_counters {
+    atomic_size_t finds, visited, compares, rotations, allocs, frees, bytes;
+};
+
+#define STATS_ADD(C, field, n) do { if (C) atomic_fetch_add_explicit(&(C)->field, (size_t)(n), memory_order_relaxed); } while (0)
+#define STATS_SUB(C, field, n) do { if (C) atomic_fetch_sub_explicit(&(C)->field, (size_t)(n), memory_order_relaxed); } while (0)
+
+#else
+
+struct ctypes_counters;
+
+#define STATS_ADD(C, field, n) ((void)(C), (void)(n))
+#define STATS_SUB(C, field, n) ((void)(C), (void)(n))
+
+#endif
+
+// Returns zeroed counters (0 unless built with CTYPES_STATS)
+extern struct ctypes_counters *stats_new(void);
+
+// Returns the current values of `C` (all zero if `C` is zero)
+extern struct ctypes_stats stats_read(struct ctypes_counters *C);
+
+// Releases the counters
+extern void stats_free(struct ctypes_counters *C);
+
+#endif
\ No newline at end of file
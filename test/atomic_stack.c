@@ -0,0 +1,91 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "atomic_stack.h"
+
+#include <stdatomic.h> // atomic_uchar
+
+#define THREADS 4
+#define ITEMS 50000
+
+// Every item is pushed once by one thread and must be popped exactly once, `taken[]` counts how often it was
+static atomic_uchar taken[THREADS * ITEMS];
+static atomic_stack_t *S;
+
+static void __take(uint64_t item) {
+    CHECK(item < THREADS * ITEMS);
+    CHECK(atomic_fetch_add_explicit(&taken[item], 1, memory_order_relaxed) == 0);
+}
+
+// On one thread it's a plain stack, and popping into a small buffer truncates but reports the size
+static void test_sequential(void) {
+    uint64_t item[TEST_ITEM], out[TEST_ITEM];
+    size_t size;
+    stack_t rest;
+
+    S = atomic_stack_new();
+    CHECK(atomic_stack_empty(S));
+    for (uint64_t i = 0; i < 100; i++) atomic_stack_push(S, item, test_item(item, i));
+    for (uint64_t i = 100; i-- > 50;) {
+        size = i % 3 ? sizeof(out) : sizeof(uint64_t);
+        CHECK(atomic_stack_pop(S, out, &size));
+        CHECK(size == test_item(item, i) && out[0] == i && (i % 3 == 0 || test_item_holds(out, i)));
+    }
+
+    rest = atomic_stack_pop_all(S);
+    CHECK(atomic_stack_empty(S) && !atomic_stack_pop(S, out, &size) && stack_size(rest) == 50);
+    for (uint64_t i = 50; i-- > 0;) {
+        CHECK(test_item_holds(stack_top(rest), i));
+        stack_pop(&rest);
+    }
+
+    // Elements left in the stack are released with it
+    for (uint64_t i = 0; i < 5; i++) atomic_stack_push(S, item, test_item(item, i));
+    atomic_stack_free(S);
+    PASS("atomic stack");
+}
+
+// ---
+// Every thread pushes its own items and pops whatever is on top, the rest is taken with `atomic_stack_pop_all()`.
+
+static void *__worker(void *arg) {
+    uint64_t id = (uint64_t)(size_t)arg, item[3], rng = id;
+    size_t size;
+
+    for (uint64_t i = 0; i < ITEMS; i++) {
+        item[0] = item[1] = item[2] = id * ITEMS + i;
+        atomic_stack_push(S, item, i % 5 ? sizeof(uint64_t) : sizeof(item));
+
+        size = sizeof(item);
+        if (test_rand(&rng) % 3 && atomic_stack_pop(S, item, &size)) {
+            CHECK(size == sizeof(uint64_t) || (item[1] == item[0] && item[2] == item[0]));
+            __take(item[0]);
+        }
+    }
+    return 0;
+}
+
+static void test_concurrent(void) {
+    stack_t rest;
+
+    S = atomic_stack_new();
+    test_threads(THREADS, __worker);
+
+    rest = atomic_stack_pop_all(S);
+    CHECK(atomic_stack_empty(S));
+    while (!stack_empty(rest)) {
+        __take(*(uint64_t*)stack_top(rest));
+        stack_pop(&rest);
+    }
+    for (size_t i = 0; i < THREADS * ITEMS; i++) CHECK(atomic_load_explicit(&taken[i], memory_order_relaxed) == 1);
+    atomic_stack_free(S);
+    PASS("atomic stack pushes and pops from every thread");
+}
+
+//
+// ---
+
+int main(void) {
+    test_sequential();
+    test_concurrent();
+    return 0;
+}
@@ -0,0 +1,148 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "btree.h"
+
+#include <string.h> // memcmp()
+
+#define UNIVERSE 4096
+#define OPS 300000
+
+// Values alternate between fitting `CMP_INLINE` and not, so both kinds are moved by splits and merges
+struct value {
+    uint64_t key;
+    uint64_t version;
+    uint64_t check;
+};
+
+static uint64_t __key(const struct btree_box *box) {
+    return *(const uint64_t*)(box->size <= CMP_INLINE ? box->small : box->data);
+}
+
+static size_t __value_size(uint64_t key) {
+    return key % 2 ? sizeof(struct value) : sizeof(uint64_t);
+}
+
+// Checks the fill, the separators and the depth below `x`, whose keys must lie in [lo, hi)
+// Returns the number of keys, storing the depth of the leaves in `*depth`
+static size_t __check(btree_t *T, struct btree_node *x, uint64_t lo, uint64_t hi, size_t *depth) {
+    size_t n = 0, d, first = 0;
+
+    if (x != T->root) CHECK(x->length >= BTREE_ORDER / 2);
+    CHECK(x->length <= BTREE_ORDER);
+    for (size_t i = 0; i < x->length; i++) {
+        CHECK(__key(&x->keys[i]) >= lo && __key(&x->keys[i]) < hi);
+        if (i) CHECK(__key(&x->keys[i - 1]) < __key(&x->keys[i]));
+    }
+
+    if (x->leaf) {
+        *depth = 1;
+        return x->length;
+    }
+
+    struct btree_inner *inner = (struct btree_inner*)x;
+    for (size_t i = 0; i <= x->length; i++) {
+        uint64_t l = i ? __key(&x->keys[i - 1]) : lo, h = i < x->length ? __key(&x->keys[i]) : hi;
+
+        n += __check(T, inner->children[i], l, h, &d);
+        if (!i) first = d;
+        CHECK(d == first);
+    }
+    *depth = first + 1;
+    return n;
+}
+
+// Compares `T` with the model: the structure, the size, the leaf chain both ways, and every value
+// `version[k]` is zero for missing keys
+static void __compare(btree_t *T, const uint64_t *version) {
+    btree_iter_t it = btree_first(*T);
+    size_t depth, n = 0;
+
+    if (T->root) CHECK(__check(T, T->root, 0, UNIVERSE, &depth) == T->size);
+    else CHECK(!T->size);
+
+    for (uint64_t k = 0; k < UNIVERSE; k++) {
+        if (!version[k]) continue;
+
+        struct value v = {k, version[k], k ^ version[k]};
+        CHECK(it.leaf && *(uint64_t*)btree_key(it).data == k);
+        CHECK(btree_value(it)->size == __value_size(k) && !memcmp(btree_value(it)->data, &v, __value_size(k)));
+        it = btree_next(it);
+        n++;
+    }
+    CHECK(!it.leaf && n == btree_size(*T));
+
+    it = btree_last(*T);
+    for (uint64_t k = UNIVERSE; k-- > 0;) {
+        if (!version[k]) continue;
+        CHECK(it.leaf && *(uint64_t*)btree_key(it).data == k);
+        it = btree_prev(it);
+    }
+    CHECK(!it.leaf);
+}
+
+static void test_random(void) {
+    uint64_t version[UNIVERSE] = {0};
+    uint64_t rng = 7, k;
+    btree_t T = btree_new(cmp_sgn_u64);
+    cmp_item_t *found;
+
+    for (size_t i = 1; i <= OPS; i++) {
+        // Runs of inserts and of deletes, so the tree grows and shrinks by several levels
+        int grow = (i / 20000) % 2 == 0;
+
+        k = test_rand(&rng) % UNIVERSE;
+        switch (test_rand(&rng) % 5) {
+        case 0:
+        case 1:
+            if (grow) {
+                struct value v = {k, i, k ^ i};
+
+                // Inserting a present key keeps its value
+                btree_insert(&T, cmp_item_new(&k, sizeof(k)), cmp_item_new(&v, __value_size(k)));
+                if (!version[k]) version[k] = i;
+            } else {
+                btree_delete(&T, cmp_item_new(&k, sizeof(k)));
+                version[k] = 0;
+            }
+            break;
+        case 2:
+            btree_delete(&T, cmp_item_new(&k, sizeof(k)));
+            version[k] = 0;
+            break;
+        default:
+            found = btree_find(T, cmp_item_new(&k, sizeof(k)));
+            CHECK(!found == !version[k]);
+            if (found) CHECK(*(uint64_t*)found->data == k && (k % 2 == 0 || ((uint64_t*)found->data)[1] == version[k]));
+        }
+        if (i % 10000 == 0) __compare(&T, version);
+    }
+    __compare(&T, version);
+
+    // Bounds against the model
+    for (k = 0; k < UNIVERSE; k++) {
+        btree_iter_t lower = btree_lower_bound(T, cmp_item_new(&k, sizeof(k)));
+        btree_iter_t upper = btree_upper_bound(T, cmp_item_new(&k, sizeof(k)));
+        uint64_t l = k, u = k + 1;
+
+        while (l < UNIVERSE && !version[l]) l++;
+        while (u < UNIVERSE && !version[u]) u++;
+        CHECK(l == UNIVERSE ? !lower.leaf : lower.leaf && *(uint64_t*)btree_key(lower).data == l);
+        CHECK(u == UNIVERSE ? !upper.leaf : upper.leaf && *(uint64_t*)btree_key(upper).data == u);
+    }
+
+    // Emptying the tree releases every node
+    for (k = 0; k < UNIVERSE; k++) {
+        btree_delete(&T, cmp_item_new(&k, sizeof(k)));
+        version[k] = 0;
+        if (k % 512 == 0) __compare(&T, version);
+    }
+    __compare(&T, version);
+
+    btree_free(&T);
+    PASS("btree random operations");
+}
+
+int main(void) {
+    test_random();
+    return 0;
+}
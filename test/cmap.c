@@ -0,0 +1,111 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "cmap.h"
+
+#include <stdatomic.h> // atomic_int
+#include <string.h>    // memcmp() and memset()
+
+#define READERS 3
+#define KEYS 2000
+#define ROUNDS 100
+
+static cmap_t *C;
+static atomic_int done;
+
+// A value is derived from its key only (8 to 32 bytes), so a reader can check whatever it finds
+static size_t __value(uint64_t key, uint64_t *value) {
+    size_t words = key % 4 + 1;
+
+    for (size_t i = 0; i < words; i++) value[i] = key * 3 + i;
+    return words * sizeof(uint64_t);
+}
+
+// Finds `k` and checks its value, a buffer too small for the value gets its beginning and nothing past its end is written
+static int __find(uint64_t k) {
+    uint64_t expected[4], buffer[6];
+    size_t real = __value(k, expected), room = k % 3 ? 4 * sizeof(uint64_t) : sizeof(uint64_t), size = room;
+
+    memset(buffer, 0xab, sizeof(buffer));
+    if (!cmap_find(C, cmp_item_new(&k, sizeof(k)), buffer, &size)) return 0;
+
+    CHECK(size == real);
+    CHECK(!memcmp(buffer, expected, real < room ? real : room));
+    CHECK(((uint8_t*)buffer)[room] == 0xab);
+    return 1;
+}
+
+// On one thread it's a plain map
+static void test_sequential(void) {
+    uint8_t present[KEYS] = {0};
+    uint64_t rng = 15, value[4], k;
+    size_t n = 0;
+
+    C = cmap_new(cmp_sgn_u64);
+    for (size_t i = 0; i < 100000; i++) {
+        k = test_rand(&rng) % KEYS;
+        switch (test_rand(&rng) % 3) {
+        case 0:
+            cmap_insert(C, cmp_item_new(&k, sizeof(k)), cmp_item_new(value, __value(k, value)));
+            n += !present[k];
+            present[k] = 1;
+            break;
+        case 1:
+            cmap_delete(C, cmp_item_new(&k, sizeof(k)));
+            n -= present[k];
+            present[k] = 0;
+            break;
+        default:
+            CHECK(__find(k) == present[k] && cmap_count(C, cmp_item_new(&k, sizeof(k))) == present[k]);
+        }
+        CHECK(cmap_size(C) == n);
+    }
+    cmap_free(C);
+    PASS("concurrent map");
+}
+
+// ---
+// The writer keeps inserting and deleting the odd keys, the even ones stay all the time.
+
+static void *__worker(void *arg) {
+    uint64_t value[4];
+
+    if (arg) {
+        while (!atomic_load(&done)) {
+            for (uint64_t k = 0; k < KEYS; k++) {
+                CHECK(__find(k) || k % 2);
+                if (k % 2 == 0) CHECK(cmap_count(C, cmp_item_new(&k, sizeof(k))));
+            }
+        }
+        return 0;
+    }
+
+    for (size_t round = 0; round < ROUNDS; round++) {
+        for (uint64_t k = 1; k < KEYS; k += 2) {
+            if (round % 2) cmap_delete(C, cmp_item_new(&k, sizeof(k)));
+            else cmap_insert(C, cmp_item_new(&k, sizeof(k)), cmp_item_new(value, __value(k, value)));
+        }
+    }
+    atomic_store(&done, 1);
+    return 0;
+}
+
+static void test_concurrent(void) {
+    uint64_t value[4];
+
+    C = cmap_new(cmp_sgn_u64);
+    for (uint64_t k = 0; k < KEYS; k += 2) cmap_insert(C, cmp_item_new(&k, sizeof(k)), cmp_item_new(value, __value(k, value)));
+
+    test_threads(READERS + 1, __worker);
+    CHECK(cmap_size(C) == KEYS / 2);
+    cmap_free(C);
+    PASS("concurrent map writer and readers");
+}
+
+//
+// ---
+
+int main(void) {
+    test_sequential();
+    test_concurrent();
+    return 0;
+}
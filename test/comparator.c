@@ -0,0 +1,96 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "comparator.h"
+
+#define LENGTH 160
+#define ROUNDS 200000
+
+// ---
+// Byte comparators
+//
+// The little-endian scans are checked against a byte loop from the most significant end,
+// on every length up to past two AVX2 vectors and at every alignment of both sides.
+
+static int __sgn_le(const uint8_t *a, const uint8_t *b, size_t n) {
+    while (n--) {
+        if (a[n] != b[n]) return a[n] < b[n] ? -1 : 1;
+    }
+    return 0;
+}
+
+static int __sgn_be(const uint8_t *a, const uint8_t *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static void test_bytes(void) {
+    uint8_t a[LENGTH + 32], b[LENGTH + 32];
+    uint64_t rng = 14;
+
+    for (size_t i = 0; i < ROUNDS; i++) {
+        size_t n = test_rand(&rng) % LENGTH, oa = test_rand(&rng) % 32, ob = test_rand(&rng) % 32;
+        cmp_item_t x = cmp_item_new(a + oa, n), y = cmp_item_new(b + ob, n);
+
+        for (size_t j = 0; j < n; j++) a[oa + j] = b[ob + j] = (uint8_t)test_rand(&rng);
+        // Equal items, or items differing in a few bytes anywhere (mostly near either end)
+        for (size_t d = test_rand(&rng) % 4; n && d; d--) {
+            size_t at = test_rand(&rng) % 3 ? test_rand(&rng) % n : (test_rand(&rng) % 2 ? 0 : n - 1);
+            b[ob + at] = (uint8_t)test_rand(&rng);
+        }
+
+        int le = __sgn_le(a + oa, b + ob, n), be = __sgn_be(a + oa, b + ob, n);
+        CHECK(cmp_sgn_le(x, y) == le && cmp_sgn_le(y, x) == -le);
+        CHECK(cmp_sgn_be(x, y) == be && cmp_sgn_be(y, x) == -be);
+        CHECK(cmp_smaller_le(x, y) == (le <= 0) && cmp_greater_le(x, y) == (le > 0));
+        CHECK(cmp_smaller_be(x, y) == (be <= 0) && cmp_greater_be(x, y) == (be > 0));
+        CHECK(cmp_equal(x, y) == !le);
+        if (!le) CHECK(cmp_hash(x) == cmp_hash(y));
+    }
+
+    // Items of different sizes are ordered by size first
+    CHECK(cmp_sgn_le(cmp_item_new(a, 3), cmp_item_new(b, 4)) == -1 && cmp_sgn_be(cmp_item_new(a, 5), cmp_item_new(b, 4)) == 1);
+    CHECK(cmp_sgn_size(cmp_item_new(a, 7), cmp_item_new(b, 7)) == 0 && !cmp_equal(cmp_item_new(a, 0), cmp_item_new(b, 1)));
+    PASS("byte comparators");
+}
+
+//
+// ---
+
+// ---
+// Typed comparators
+//
+// Random bit patterns of every type (so the floats include infinities, NaNs and both zeros) are compared
+// with the operators, NaNs being ordered after every other value. Items of other sizes fall back to `cmp_sgn()`.
+
+#define TEST_TYPED(name, type) \
+static void test_##name(void) { \
+    uint64_t rng = 15, bits[3] = {0}; \
+    type x, y; \
+    for (size_t i = 0; i < ROUNDS; i++) { \
+        bits[0] = test_rand(&rng); \
+        bits[1] = i % 4 ? test_rand(&rng) : bits[0]; \
+        memcpy(&x, &bits[0], sizeof(type)); \
+        memcpy(&y, &bits[1], sizeof(type)); \
+        int expected = x != x || y != y ? (x != x) - (y != y) : (x > y) - (x < y); \
+        CHECK(cmp_sgn_##name(cmp_item_new(&x, sizeof(type)), cmp_item_new(&y, sizeof(type))) == expected); \
+        CHECK(__cmp_sgn_##name(cmp_item_new(&x, sizeof(type)), cmp_item_new(&y, sizeof(type))) == expected); \
+        CHECK(cmp_sgn_##name(cmp_item_new(bits, sizeof(type) + 1), cmp_item_new(bits + 1, sizeof(type) + 1)) == \
+              cmp_sgn(cmp_item_new(bits, sizeof(type) + 1), cmp_item_new(bits + 1, sizeof(type) + 1))); \
+    } \
+    PASS("typed comparator (" #name ")"); \
+}
+CMP_TYPES(TEST_TYPED)
+#undef TEST_TYPED
+
+//
+// ---
+
+int main(void) {
+    test_bytes();
+#define TEST_TYPED(name, type) test_##name();
+    CMP_TYPES(TEST_TYPED)
+#undef TEST_TYPED
+    return 0;
+}
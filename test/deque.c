@@ -0,0 +1,121 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "deque.h"
+#include "pool.h"
+
+#include <string.h> // memmove() and memcmp()
+
+#define CAPACITY 8000
+#define OPS 400000
+#define VALUES 64
+
+// Odd values are bigger than `CMP_INLINE`, so both kinds of items are moved around the blocks
+struct item {
+    uint64_t value[3];
+};
+
+static size_t __size(uint64_t value) {
+    return value % 2 ? sizeof(struct item) : sizeof(uint64_t);
+}
+
+static struct item __item(uint64_t value) {
+    return (struct item){{value, value, value}};
+}
+
+// Compares `L` with the model `model[0..n)`, by index and from both ends
+static void __compare(deque_t *L, const uint64_t *model, size_t n) {
+    CHECK(deque_size(*L) == n && deque_empty(*L) == !n);
+    for (size_t i = 0; i < n; i++) {
+        struct item x = __item(model[i]);
+        CHECK(!memcmp(deque_at(*L, (int)i), &x, __size(model[i])));
+    }
+    CHECK(!deque_at(*L, (int)n) && !deque_at(*L, -1));
+    if (n) CHECK(*(uint64_t*)deque_front(*L) == model[0] && *(uint64_t*)deque_back(*L) == model[n - 1]);
+}
+
+static void test_random(pool_t *P, const char *name) {
+    static uint64_t model[CAPACITY + 1];
+    uint64_t rng = 8;
+    deque_t L = deque_new();
+    size_t n = 0;
+
+    for (size_t i = 0; i < OPS; i++) {
+        uint64_t v = test_rand(&rng) % VALUES, r = test_rand(&rng) % 10;
+        struct item x = __item(v);
+        // Phases biased towards growing and towards shrinking, so the block map both grows and recenters
+        int grow = (i / 50000) % 2 == 0;
+        size_t at;
+
+        if (grow && r >= 6) r -= 6;
+        if (!grow && r < 4) r += 6;
+        if (n >= CAPACITY) r = 6;
+        switch (r) {
+        case 0:
+        case 1:
+            deque_push_front(&L, &x, __size(v));
+            memmove(model + 1, model, n * sizeof(*model));
+            model[0] = v;
+            n++;
+            break;
+        case 2:
+        case 3:
+            deque_push_back(&L, &x, __size(v));
+            model[n++] = v;
+            break;
+        case 4:
+            // Past the end acts as a push to the back, a negative index does nothing
+            at = test_rand(&rng) % (n + 2);
+            deque_insert(&L, at % 7 == 6 ? -(int)at - 1 : (int)at, &x, __size(v));
+            if (at % 7 == 6) break;
+            if (at > n) at = n;
+            memmove(model + at + 1, model + at, (n - at) * sizeof(*model));
+            model[at] = v;
+            n++;
+            break;
+        case 5:
+            at = test_rand(&rng) % (n + 2);
+            deque_remove(&L, at % 7 == 6 ? -(int)at - 1 : (int)at);
+            if (at % 7 == 6 || at >= n) break;
+            memmove(model + at, model + at + 1, (n - at - 1) * sizeof(*model));
+            n--;
+            break;
+        case 6:
+        case 7:
+            if (!n) break;
+            deque_pop_front(&L);
+            memmove(model, model + 1, --n * sizeof(*model));
+            break;
+        default:
+            if (!n) break;
+            deque_pop_back(&L);
+            n--;
+        }
+
+        if (i % 20000 == 0) {
+            size_t count = 0;
+
+            __compare(&L, model, n);
+            for (size_t j = 0; j < n; j++) count += model[j] == v;
+            CHECK((size_t)deque_count(L, &x, __size(v)) == count);
+            CHECK((size_t)deque_count_parallel(L, &x, __size(v), P) == count);
+        }
+    }
+    __compare(&L, model, n);
+
+    // Draining from both ends
+    while (n > 1) {
+        deque_pop_front(&L);
+        deque_pop_back(&L);
+        memmove(model, model + 1, (n -= 2) * sizeof(*model));
+        if (n % 1000 < 2) __compare(&L, model, n);
+    }
+    deque_free(&L);
+    pool_free(P);
+    PASS(name);
+}
+
+int main(void) {
+    test_random(0, "deque random operations");
+    test_random(pool_new(3), "deque random operations (pool of 3)");
+    return 0;
+}
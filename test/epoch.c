@@ -0,0 +1,72 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "epoch.h"
+
+#include <stdatomic.h> // atomic_int and atomic_size_t
+
+#define READERS 3
+#define ITEMS 50000
+#define MAGIC 0x6570786fu
+
+// A writer keeps replacing a shared object and retires the old one, readers check the one they see.
+// The retired objects are wiped before they are freed, so a reader which sees a wiped one was not protected.
+struct object {
+    unsigned magic;
+    uint64_t value;
+};
+
+static _Atomic(struct object*) current;
+static atomic_size_t released;
+static atomic_int done;
+
+static void __release(void *ptr) {
+    struct object *x = (struct object*)ptr;
+
+    __atomic_store_n(&x->magic, 0, __ATOMIC_RELAXED);
+    free(x);
+    atomic_fetch_add(&released, 1);
+}
+
+static void *__worker(void *arg) {
+    struct object *x;
+
+    if (arg) {
+        while (!atomic_load(&done)) {
+            epoch_enter();
+            x = atomic_load_explicit(&current, memory_order_acquire);
+            CHECK(__atomic_load_n(&x->magic, __ATOMIC_RELAXED) == MAGIC);
+            CHECK(x->value < ITEMS);
+            epoch_exit();
+        }
+        return 0;
+    }
+
+    for (uint64_t i = 1; i < ITEMS; i++) {
+        x = (struct object*)malloc(sizeof(*x));
+        x->magic = MAGIC;
+        x->value = i;
+        epoch_retire(atomic_exchange_explicit(&current, x, memory_order_acq_rel), __release);
+    }
+    atomic_store(&done, 1);
+    epoch_synchronize();
+    return 0;
+}
+
+static void test_epoch(void) {
+    struct object *x = (struct object*)malloc(sizeof(*x));
+
+    x->magic = MAGIC;
+    x->value = 0;
+    atomic_init(&current, x);
+
+    test_threads(READERS + 1, __worker);
+    // Every replaced object has been released by the writer's `epoch_synchronize()`
+    CHECK(atomic_load(&released) == ITEMS - 1);
+    free(atomic_load(&current));
+    PASS("epoch reclamation");
+}
+
+int main(void) {
+    test_epoch();
+    return 0;
+}
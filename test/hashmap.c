@@ -0,0 +1,63 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "hashmap.h"
+
+#define OPS 400000
+#define UNIVERSE (OPS / 16)
+
+// Odd keys are bigger than `HASHMAP_INLINE`, so they are stored outside of the slots
+static cmp_item_t __key(uint64_t *key, uint64_t k) {
+    key[0] = key[1] = key[2] = k;
+    return cmp_item_new(key, k % 2 ? 3 * sizeof(uint64_t) : sizeof(uint64_t));
+}
+
+static void test_random(void) {
+    static uint64_t version[UNIVERSE];
+    uint64_t rng = 11, k, v, key[3];
+    hashmap_t H = hashmap_new(0);
+    cmp_item_t *found;
+    size_t n = 0;
+
+    for (size_t i = 1; i <= OPS; i++) {
+        // Phases of mostly inserts and of mostly deletes, so the table grows and fills up with tombstones
+        size_t op = test_rand(&rng) % 4, grow = (i / 50000) % 2 == 0;
+
+        k = test_rand(&rng) % UNIVERSE;
+        if (op < 2) op = !grow;
+        switch (op) {
+        case 0:
+            // Inserting a present key keeps its value
+            v = i;
+            hashmap_insert(&H, __key(key, k), cmp_item_new(&v, sizeof(v)));
+            if (!version[k]) {
+                version[k] = i;
+                n++;
+            }
+            break;
+        case 1:
+            hashmap_delete(&H, __key(key, k));
+            n -= version[k] != 0;
+            version[k] = 0;
+            break;
+        default:
+            found = hashmap_find(H, __key(key, k));
+            CHECK(!found == !version[k]);
+            if (found) CHECK(found->size == sizeof(v) && *(uint64_t*)found->data == version[k]);
+        }
+        CHECK(hashmap_size(H) == n);
+    }
+
+    // Every key once more, at the end
+    for (k = 0; k < UNIVERSE; k++) {
+        found = hashmap_find(H, __key(key, k));
+        CHECK(!found == !version[k]);
+        if (found) CHECK(*(uint64_t*)found->data == version[k]);
+    }
+    hashmap_free(&H);
+    PASS("hashmap random operations");
+}
+
+int main(void) {
+    test_random();
+    return 0;
+}
@@ -0,0 +1,298 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "map.h"
+#include "pool.h"
+
+#include <string.h> // memcmp()
+
+#define UNIVERSE 2048
+#define OPS 200000
+
+// Values are bigger than `CMP_INLINE`, so they live outside of the nodes
+struct value {
+    uint64_t key;
+    uint64_t version;
+    uint64_t check;
+};
+
+static struct value __value(uint64_t key, uint64_t version) {
+    return (struct value){key, version, key ^ version ^ 0x5555};
+}
+
+// Checks the red-black invariants below `x` and returns the number of nodes, storing the black height in `*black`
+static size_t __check(map_t *M, struct map_node *x, struct map_node *parent, size_t *black) {
+    size_t left, right, n;
+
+    if (!x) {
+        *black = 1;
+        return 0;
+    }
+
+    CHECK(x->parent == parent);
+    if (x->color) CHECK((!x->left || !x->left->color) && (!x->right || !x->right->color));
+
+    n = __check(M, x->left, x, &left) + __check(M, x->right, x, &right) + 1;
+    CHECK(left == right);
+    if (M->ranked) CHECK(x->weight == n);
+
+    *black = left + !x->color;
+    return n;
+}
+
+// Compares `M` with the model: the invariants, the size, and every key and value in order
+// `version[k]` is zero for missing keys
+static void __compare(map_t *M, const uint64_t *version) {
+    struct map_node *x = map_first(*M);
+    size_t black, n = 0;
+
+    CHECK(!M->root || !M->root->color);
+    CHECK(__check(M, M->root, 0, &black) == M->size);
+
+    for (uint64_t k = 0; k < UNIVERSE; k++) {
+        if (!version[k]) continue;
+
+        struct value v = __value(k, version[k]);
+        CHECK(x && *(uint64_t*)x->key.data == k);
+        CHECK(x->value.size == sizeof(v) && !memcmp(x->value.data, &v, sizeof(v)));
+        x = map_next(x);
+        n++;
+    }
+    CHECK(!x && n == map_size(*M));
+}
+
+// Checks the bounds, the order statistics, the ranges and both directions of iteration against the model
+static void __scan(map_t M, const uint64_t *version) {
+    struct map_node *node = map_last(M);
+    uint64_t k;
+
+    CHECK(!map_select(M, map_size(M)));
+    for (k = 0; k < UNIVERSE; k++) {
+        struct map_node *lower = map_lower_bound(M, cmp_item_new(&k, sizeof(k)));
+        struct map_node *upper = map_upper_bound(M, cmp_item_new(&k, sizeof(k)));
+        size_t rank = 0;
+        uint64_t l = k, u = k + 1;
+
+        while (l < UNIVERSE && !version[l]) l++;
+        while (u < UNIVERSE && !version[u]) u++;
+        for (uint64_t j = 0; j < k; j++) rank += version[j] != 0;
+        CHECK(map_rank(M, cmp_item_new(&k, sizeof(k))) == rank);
+        if (version[k]) CHECK(*(uint64_t*)map_select(M, rank)->key.data == k);
+        CHECK(l == UNIVERSE ? !lower : lower && *(uint64_t*)lower->key.data == l);
+        CHECK(u == UNIVERSE ? !upper : upper && *(uint64_t*)upper->key.data == u);
+    }
+
+    // Ranges of every width, empty ones included, walked both ways
+    for (k = 0; k < UNIVERSE; k += 7) {
+        uint64_t hi = k + k % 61 - 3, expected = 0, seen = 0;
+        map_range_t R = map_range(M, cmp_item_new(&k, sizeof(k)), cmp_item_new(&hi, sizeof(hi)));
+
+        for (uint64_t j = k; j <= hi && j < UNIVERSE; j++) expected += version[j] != 0;
+        for (node = R.first; node; node = map_range_next(R, node)) {
+            uint64_t key = *(uint64_t*)node->key.data;
+            CHECK(key >= k && key <= hi && version[key]);
+            CHECK(((struct value*)node->value.data)->version == version[key]);
+            seen++;
+        }
+        CHECK(seen == expected && !R.first == !expected && !R.last == !expected);
+        for (node = R.last; node; node = map_range_prev(R, node)) seen--;
+        CHECK(!seen);
+    }
+
+    node = map_last(M);
+    for (k = UNIVERSE; k-- > 0;) {
+        if (!version[k]) continue;
+        CHECK(node && *(uint64_t*)node->key.data == k);
+        node = map_prev(node);
+    }
+    CHECK(!node);
+}
+
+// Looks up every key of the universe, and a few twice, in one batch
+static void __find_many(map_t M, const uint64_t *version) {
+    static uint64_t keys_data[UNIVERSE + 100];
+    static cmp_item_t keys[UNIVERSE + 100], *values[UNIVERSE + 100];
+    size_t n = UNIVERSE + 100, hits = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        keys_data[i] = (i * 7) % UNIVERSE;
+        keys[i] = cmp_item_new(&keys_data[i], sizeof(keys_data[i]));
+        hits += version[keys_data[i]] != 0;
+    }
+    CHECK(map_find_many(M, keys, n, values) == hits);
+    for (size_t i = 0; i < n; i++) {
+        CHECK(!values[i] == !version[keys_data[i]]);
+        if (values[i]) CHECK(values[i] == map_find(M, keys[i]) && ((struct value*)values[i]->data)->version == version[keys_data[i]]);
+    }
+    // Batches shorter than `MAP_BATCH`
+    CHECK(map_find_many(M, keys, 3, values) == (size_t)(!!version[keys_data[0]] + !!version[keys_data[1]] + !!version[keys_data[2]]));
+    CHECK(!map_find_many(M, keys, 0, values));
+}
+
+static void test_random(map_t M, const char *name) {
+    uint64_t version[UNIVERSE] = {0};
+    uint64_t rng = 4, k;
+    struct value v;
+    struct map_node *node;
+    cmp_item_t *found;
+
+    for (size_t i = 1; i <= OPS; i++) {
+        k = test_rand(&rng) % UNIVERSE;
+        switch (test_rand(&rng) % 3) {
+        case 0:
+            // Inserting a present key keeps its value
+            v = __value(k, i);
+            map_insert(&M, cmp_item_new(&k, sizeof(k)), cmp_item_new(&v, sizeof(v)));
+            if (!version[k]) version[k] = i;
+            break;
+        case 1:
+            if (i % 2) {
+                map_delete(&M, cmp_item_new(&k, sizeof(k)));
+                version[k] = 0;
+                break;
+            }
+
+            // Unlinked nodes belong to the caller, the slab releases its own ones with the map
+            node = map_unlink(&M, cmp_item_new(&k, sizeof(k)));
+            CHECK(!node == !version[k]);
+            if (node) {
+                v = __value(k, version[k]);
+                CHECK(*(uint64_t*)node->key.data == k && !memcmp(node->value.data, &v, sizeof(v)));
+                if (!M.slab) {
+                    free(node->value.data);
+                    free(node);
+                }
+            }
+            version[k] = 0;
+            break;
+        default:
+            found = map_find(M, cmp_item_new(&k, sizeof(k)));
+            CHECK(!found == !version[k]);
+            if (found) CHECK(((struct value*)found->data)->version == version[k]);
+        }
+        if (i % 10000 == 0) __compare(&M, version);
+        if (i % 50000 == 0) {
+            __scan(M, version);
+            __find_many(M, version);
+        }
+    }
+    __compare(&M, version);
+    __scan(M, version);
+    __find_many(M, version);
+
+    map_free(&M);
+    PASS(name);
+}
+
+static void test_batch(map_t M, const char *name) {
+    uint64_t version[UNIVERSE] = {0};
+    uint64_t rng = 5, keys_data[512];
+    struct value values_data[512];
+    cmp_item_t keys[512], values[512];
+
+    for (size_t round = 1; round <= 200; round++) {
+        // Batches of every size, from a few keys to more than the whole map (which rebuilds it)
+        size_t k = test_rand(&rng) % (round % 10 == 0 ? 512 : 32) + 1;
+        int insert = test_rand(&rng) % 3 != 0;
+
+        for (size_t i = 0; i < k; i++) {
+            keys_data[i] = test_rand(&rng) % UNIVERSE;
+            values_data[i] = __value(keys_data[i], round);
+            keys[i] = cmp_item_new(&keys_data[i], sizeof(keys_data[i]));
+            values[i] = cmp_item_new(&values_data[i], sizeof(values_data[i]));
+        }
+
+        // Present keys keep their values
+        if (insert) map_insert_batch(&M, keys, values, k);
+        else map_delete_batch(&M, keys, k);
+        for (size_t i = 0; i < k; i++) {
+            if (!insert) version[keys_data[i]] = 0;
+            else if (!version[keys_data[i]]) version[keys_data[i]] = round;
+        }
+        __compare(&M, version);
+    }
+
+    map_free(&M);
+    PASS(name);
+}
+
+// Bumps the version of the value in place and sums the keys
+static void __visit(struct map_node *node, void *arg) {
+    struct value *v = (struct value*)node->value.data;
+
+    v->version++;
+    v->check = v->key ^ v->version ^ 0x5555;
+    __atomic_fetch_add((uint64_t*)arg, v->key, __ATOMIC_RELAXED);
+}
+
+static void test_build(pool_t *P, const char *name) {
+    uint64_t version[UNIVERSE], keys_data[UNIVERSE];
+    struct value values_data[UNIVERSE];
+    cmp_item_t keys[UNIVERSE], values[UNIVERSE];
+    uint64_t rng = 6;
+
+    for (size_t round = 0; round < 40; round++) {
+        uint64_t density = test_rand(&rng) % 101, sum = 0, expected = 0;
+        size_t n = 0;
+
+        for (uint64_t k = 0; k < UNIVERSE; k++) {
+            version[k] = test_rand(&rng) % 100 < density;
+            if (!version[k]) continue;
+
+            keys_data[n] = k;
+            values_data[n] = __value(k, 1);
+            keys[n] = cmp_item_new(&keys_data[n], sizeof(uint64_t));
+            values[n] = cmp_item_new(&values_data[n], sizeof(struct value));
+            expected += k;
+            n++;
+        }
+
+        map_t M = P ? map_from_sorted_parallel(keys, values, n, cmp_sgn_u64, P) : map_from_sorted(keys, values, n, cmp_sgn_u64);
+        if (round % 2) map_enable_rank(&M);
+        __compare(&M, version);
+        __scan(M, version);
+
+        // `map_for_each()` may change the values in place, so every version goes from 1 to 2
+        map_for_each(M, __visit, &sum, P);
+        CHECK(sum == expected);
+        for (uint64_t k = 0; k < UNIVERSE; k++) version[k] *= 2;
+        __compare(&M, version);
+        for (uint64_t k = 0; k < UNIVERSE; k++) version[k] /= 2;
+        map_free(&M);
+
+        // Shuffled input goes through `map_from_array()`
+        for (size_t i = n; i > 1; i--) {
+            size_t j = test_rand(&rng) % i;
+            cmp_item_t t = keys[i - 1];
+
+            keys[i - 1] = keys[j];
+            keys[j] = t;
+            t = values[i - 1];
+            values[i - 1] = values[j];
+            values[j] = t;
+        }
+        M = map_from_array(keys, values, n, cmp_sgn_u64);
+        __compare(&M, version);
+        map_free(&M);
+    }
+    PASS(name);
+}
+
+int main(void) {
+    map_t ranked = map_new(cmp_sgn_u64);
+    pool_t *P = pool_new(3);
+
+    map_enable_rank(&ranked);
+    // The typed descent, and the generic one (`cmp_sgn()` orders little-endian keys the same way)
+    test_random(map_new(cmp_sgn_u64), "map random operations");
+    test_random(map_new(cmp_sgn), "map random operations (generic comparator)");
+    test_random(map_new_slab(cmp_sgn_u64), "map random operations (slab)");
+    test_random(ranked, "map random operations (ranked)");
+    test_batch(map_new(cmp_sgn_u64), "map batches");
+    test_batch(map_new(cmp_sgn), "map batches (generic comparator)");
+    test_batch(map_new_slab(cmp_sgn_u64), "map batches (slab)");
+    test_build(0, "map bulk loading");
+    test_build(P, "map bulk loading (pool of 3)");
+
+    pool_free(P);
+    return 0;
+}
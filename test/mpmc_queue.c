@@ -0,0 +1,95 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "mpmc_queue.h"
+
+#include <stdatomic.h> // atomic_uchar
+#include <sched.h>     // sched_yield()
+
+#define PRODUCERS 4
+#define ITEMS 50000
+
+// Every item is pushed once by one producer and must be popped exactly once, `taken[]` counts how often it was
+static atomic_uchar taken[PRODUCERS * ITEMS];
+static mpmc_queue_t *Q;
+
+// A full queue refuses pushes, an empty one pops, and popping into a small buffer truncates but reports the size
+static void test_bounds(void) {
+    uint64_t item[3] = {1, 2, 3}, out[3];
+    size_t n = 0, size;
+
+    Q = mpmc_queue_new(10, sizeof(uint64_t));
+    while (mpmc_queue_try_push(Q, item, n % 2 ? sizeof(item) : sizeof(uint64_t))) n++;
+    CHECK(n >= 10 && mpmc_queue_size(Q) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        out[0] = out[1] = 0;
+        size = i % 4 == 1 ? sizeof(uint64_t) : sizeof(out);
+        CHECK(mpmc_queue_try_pop(Q, out, &size));
+        CHECK(size == (i % 2 ? sizeof(item) : sizeof(uint64_t)) && out[0] == 1);
+        CHECK(out[1] == (i % 4 == 3 ? 2 : 0));
+    }
+    CHECK(!mpmc_queue_size(Q) && !mpmc_queue_try_pop(Q, out, &size));
+
+    // Elements left in the queue are released with it
+    for (size_t i = 0; i < 5; i++) mpmc_queue_push(Q, item, sizeof(item));
+    mpmc_queue_free(Q);
+    PASS("mpmc queue bounds");
+}
+
+// ---
+// Producers push their own items in order, some of them too big for a cell,
+// and a consumer must see the items of each producer in the order they were pushed.
+
+static void *__producer(void *arg) {
+    uint64_t id = (uint64_t)(size_t)arg, item[3];
+
+    for (uint64_t i = 0; i < ITEMS; i++) {
+        item[0] = item[1] = item[2] = id * ITEMS + i;
+        if (i % 3) mpmc_queue_push(Q, item, i % 5 ? sizeof(uint64_t) : sizeof(item));
+        else while (!mpmc_queue_try_push(Q, item, i % 5 ? sizeof(uint64_t) : sizeof(item))) sched_yield();
+    }
+    return 0;
+}
+
+static void *__consumer(void *arg) {
+    uint64_t last[PRODUCERS] = {0}, item[3];
+    size_t size;
+
+    (void)arg;
+    for (size_t n = 0; n < ITEMS; n++) {
+        size = sizeof(item);
+        if (n % 2) mpmc_queue_pop(Q, item, &size);
+        else while (!mpmc_queue_try_pop(Q, item, &size)) sched_yield();
+
+        uint64_t producer = item[0] / ITEMS, i = item[0] % ITEMS;
+        CHECK(producer < PRODUCERS);
+        CHECK(size == (i % 5 ? sizeof(uint64_t) : sizeof(item)));
+        CHECK(size == sizeof(uint64_t) || (item[1] == item[0] && item[2] == item[0]));
+        CHECK(i >= last[producer]);
+        last[producer] = i + 1;
+        CHECK(atomic_fetch_add_explicit(&taken[item[0]], 1, memory_order_relaxed) == 0);
+    }
+    return 0;
+}
+
+static void *__worker(void *arg) {
+    return (size_t)arg < PRODUCERS ? __producer(arg) : __consumer(arg);
+}
+
+static void test_concurrent(void) {
+    Q = mpmc_queue_new(64, sizeof(uint64_t));
+    test_threads(2 * PRODUCERS, __worker);
+    for (size_t i = 0; i < PRODUCERS * ITEMS; i++) CHECK(atomic_load_explicit(&taken[i], memory_order_relaxed) == 1);
+    CHECK(!mpmc_queue_size(Q));
+    mpmc_queue_free(Q);
+    PASS("mpmc queue producers and consumers");
+}
+
+//
+// ---
+
+int main(void) {
+    test_bounds();
+    test_concurrent();
+    return 0;
+}
@@ -0,0 +1,83 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "pool.h"
+
+#include <stdatomic.h> // atomic_size_t and atomic_uchar
+
+#define THREADS 4
+#define N 1000
+
+static pool_t *P;
+
+// Every index of a call is visited exactly once, by ranges no longer than the grain (unless a single thread runs it all)
+static atomic_uchar visited[100000];
+static size_t grain;
+
+static void __visit(void *arg, size_t lo, size_t hi) {
+    (void)arg;
+    CHECK(lo < hi && (pool_threads(P) == 1 || hi - lo <= (grain ? grain : 1)));
+    for (size_t i = lo; i < hi; i++) CHECK(atomic_fetch_add_explicit(&visited[i], 1, memory_order_relaxed) == 0);
+}
+
+static void test_ranges(pool_t *pool, const char *name) {
+    size_t sizes[] = {0, 1, 2, 7, 1000, 99999};
+    uint64_t rng = 20;
+
+    P = pool;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+        for (size_t round = 0; round < 4; round++) {
+            size_t n = sizes[s];
+
+            grain = round ? test_rand(&rng) % 64 : 0;
+            for (size_t i = 0; i < n; i++) atomic_store_explicit(&visited[i], 0, memory_order_relaxed);
+            pool_for(P, n, grain, __visit, 0);
+            for (size_t i = 0; i < n; i++) CHECK(atomic_load_explicit(&visited[i], memory_order_relaxed) == 1);
+        }
+    }
+    CHECK(pool_threads(P) == (P ? P->threads : 1));
+    pool_free(P);
+    PASS(name);
+}
+
+// ---
+// Outside threads call `pool_for()` at the same time, and every range starts a nested `pool_for()` of its own.
+
+static void __inner(void *arg, size_t lo, size_t hi) {
+    atomic_size_t *sum = (atomic_size_t*)arg;
+
+    for (size_t i = lo; i < hi; i++) atomic_fetch_add_explicit(sum, i, memory_order_relaxed);
+}
+
+static void __outer(void *arg, size_t lo, size_t hi) {
+    for (size_t i = lo; i < hi; i++) pool_for(P, N, 16, __inner, arg);
+}
+
+static void *__worker(void *arg) {
+    atomic_size_t sum;
+
+    (void)arg;
+    for (size_t round = 0; round < 10; round++) {
+        atomic_init(&sum, 0);
+        pool_for(P, 20, 1, __outer, &sum);
+        CHECK(atomic_load(&sum) == 20 * (N * (N - 1) / 2));
+    }
+    return 0;
+}
+
+static void test_nested(void) {
+    P = pool_new(THREADS);
+    test_threads(THREADS, __worker);
+    pool_free(P);
+    PASS("thread pool nested and outside calls");
+}
+
+//
+// ---
+
+int main(void) {
+    test_ranges(0, "thread pool (zero pool)");
+    test_ranges(pool_new(1), "thread pool (one thread)");
+    test_ranges(pool_new(THREADS), "thread pool");
+    test_nested();
+    return 0;
+}
@@ -0,0 +1,34 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "queue.h"
+
+#define OPS 200000
+
+static void test_queue(queue_t Q, const char *name) {
+    static uint64_t model[OPS];
+    uint64_t rng = 10, item[TEST_ITEM];
+    size_t first = 0, last = 0;
+
+    for (size_t i = 0; i < OPS; i++) {
+        // Bursts of pushes and of pops, so the ring grows and wraps around
+        if (test_rand(&rng) % 4 < ((i / 5000) % 2 ? 1 : 3) || first == last) {
+            model[last] = test_rand(&rng);
+            queue_push(&Q, item, test_item(item, model[last++]));
+        } else {
+            queue_pop(&Q);
+            first++;
+        }
+        CHECK(queue_size(Q) == last - first && queue_empty(Q) == (first == last));
+        if (first != last) CHECK(test_item_holds(queue_front(Q), model[first]) && test_item_holds(queue_back(Q), model[last - 1]));
+    }
+    queue_free(&Q);
+    PASS(name);
+}
+
+int main(void) {
+    test_queue(queue_new(), "queue");
+    // Slots smaller than some of the items, which are then allocated separately
+    test_queue(queue_new_ring(16), "queue (ring)");
+    test_queue(queue_new_ring(40), "queue (ring, every item inline)");
+    return 0;
+}
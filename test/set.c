@@ -0,0 +1,331 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "set.h"
+#include "pool.h"
+
+#define UNIVERSE 2048
+#define OPS 200000
+
+// Checks the red-black invariants below `x` and returns the number of nodes, storing the black height in `*black`
+static size_t __check(set_t *S, struct set_node *x, struct set_node *parent, size_t *black) {
+    size_t left, right, n;
+
+    if (!x) {
+        *black = 1;
+        return 0;
+    }
+
+    CHECK(x->parent == parent);
+    if (x->color) CHECK((!x->left || !x->left->color) && (!x->right || !x->right->color));
+
+    n = __check(S, x->left, x, &left) + __check(S, x->right, x, &right) + 1;
+    CHECK(left == right);
+    if (S->ranked) CHECK(x->weight == n);
+
+    *black = left + !x->color;
+    return n;
+}
+
+// Compares `S` with the model: the invariants, the size, and every key in order
+static void __compare(set_t *S, const uint8_t *present) {
+    struct set_node *x = set_first(*S);
+    size_t black, n = 0;
+
+    CHECK(!S->root || !S->root->color);
+    CHECK(__check(S, S->root, 0, &black) == S->size);
+
+    for (uint64_t k = 0; k < UNIVERSE; k++) {
+        if (!present[k]) continue;
+        CHECK(x && *(uint64_t*)x->key.data == k);
+        x = set_next(x);
+        n++;
+    }
+    CHECK(!x && n == set_size(*S));
+}
+
+// Checks the bounds, the order statistics, the ranges and both directions of iteration against the model
+static void __scan(set_t S, const uint8_t *present) {
+    struct set_node *x = set_last(S);
+    uint64_t k;
+
+    CHECK(!set_select(S, set_size(S)));
+    for (k = 0; k < UNIVERSE; k++) {
+        struct set_node *lower = set_lower_bound(S, cmp_item_new(&k, sizeof(k)));
+        struct set_node *upper = set_upper_bound(S, cmp_item_new(&k, sizeof(k)));
+        size_t rank = 0;
+        uint64_t l = k, u = k + 1, p = k;
+
+        while (l < UNIVERSE && !present[l]) l++;
+        while (u < UNIVERSE && !present[u]) u++;
+        while (p > 0 && !present[p - 1]) p--;
+        for (uint64_t j = 0; j < k; j++) rank += present[j] != 0;
+        CHECK(set_rank(S, cmp_item_new(&k, sizeof(k))) == rank);
+        if (present[k]) CHECK(*(uint64_t*)set_select(S, rank)->key.data == k);
+
+        CHECK(l == UNIVERSE ? !lower : lower && *(uint64_t*)lower->key.data == l);
+        CHECK(u == UNIVERSE ? !upper : upper && *(uint64_t*)upper->key.data == u);
+        if (present[k]) CHECK(p ? *(uint64_t*)set_prev(lower)->key.data == p - 1 : !set_prev(lower));
+    }
+
+    // Ranges of every width, empty ones included, walked both ways
+    for (k = 0; k < UNIVERSE; k += 7) {
+        uint64_t hi = k + k % 61 - 3, expected = 0, seen = 0;
+        set_range_t R = set_range(S, cmp_item_new(&k, sizeof(k)), cmp_item_new(&hi, sizeof(hi)));
+        struct set_node *node;
+
+        for (uint64_t j = k; j <= hi && j < UNIVERSE; j++) expected += present[j];
+        for (node = R.first; node; node = set_range_next(R, node)) {
+            uint64_t key = *(uint64_t*)node->key.data;
+            CHECK(key >= k && key <= hi && present[key]);
+            seen++;
+        }
+        CHECK(seen == expected && !R.first == !expected && !R.last == !expected);
+        for (node = R.last; node; node = set_range_prev(R, node)) seen--;
+        CHECK(!seen);
+    }
+
+    for (k = UNIVERSE; k-- > 0;) {
+        if (!present[k]) continue;
+        CHECK(x && *(uint64_t*)x->key.data == k);
+        x = set_prev(x);
+    }
+    CHECK(!x);
+}
+
+// Looks up every key of the universe, and a few twice, in one batch with and without `found`
+static void __count_many(set_t S, const uint8_t *present) {
+    static uint64_t values[UNIVERSE + 100];
+    static cmp_item_t keys[UNIVERSE + 100];
+    static int found[UNIVERSE + 100];
+    size_t n = UNIVERSE + 100, hits = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        values[i] = (i * 7) % UNIVERSE;
+        keys[i] = cmp_item_new(&values[i], sizeof(values[i]));
+        hits += present[values[i]];
+    }
+    CHECK(set_count_many(S, keys, n, found) == hits && set_count_many(S, keys, n, 0) == hits);
+    for (size_t i = 0; i < n; i++) CHECK(found[i] == present[values[i]]);
+    // Batches shorter than `SET_BATCH`
+    CHECK(set_count_many(S, keys, 3, found) == (size_t)(present[values[0]] + present[values[1]] + present[values[2]]));
+    CHECK(!set_count_many(S, keys, 0, found));
+}
+
+static void test_random(set_t S, const char *name) {
+    uint8_t present[UNIVERSE] = {0};
+    uint64_t rng = 1, k;
+
+    for (size_t i = 0; i < OPS; i++) {
+        k = test_rand(&rng) % UNIVERSE;
+        switch (test_rand(&rng) % 3) {
+        case 0: set_insert(&S, cmp_item_new(&k, sizeof(k))); present[k] = 1; break;
+        case 1: set_delete(&S, cmp_item_new(&k, sizeof(k))); present[k] = 0; break;
+        default: CHECK(set_count(S, cmp_item_new(&k, sizeof(k))) == present[k]);
+        }
+        if (i % 10000 == 0) __compare(&S, present);
+        if (i % 50000 == 0) {
+            __scan(S, present);
+            __count_many(S, present);
+        }
+    }
+    __compare(&S, present);
+    __scan(S, present);
+    __count_many(S, present);
+
+    set_free(&S);
+    PASS(name);
+}
+
+static void test_batch(set_t S, const char *name) {
+    uint8_t present[UNIVERSE] = {0};
+    uint64_t rng = 2, values[512];
+    cmp_item_t keys[512];
+
+    for (size_t round = 0; round < 200; round++) {
+        // Batches of every size, from a few keys to more than the whole set (which rebuilds it)
+        size_t k = test_rand(&rng) % (round % 10 == 0 ? 512 : 32) + 1;
+        int insert = test_rand(&rng) % 3 != 0;
+
+        for (size_t i = 0; i < k; i++) {
+            values[i] = test_rand(&rng) % UNIVERSE;
+            keys[i] = cmp_item_new(&values[i], sizeof(values[i]));
+        }
+
+        if (insert) set_insert_batch(&S, keys, k);
+        else set_delete_batch(&S, keys, k);
+        for (size_t i = 0; i < k; i++) present[values[i]] = insert;
+        __compare(&S, present);
+    }
+
+    set_free(&S);
+    PASS(name);
+}
+
+// Builds a set of the keys `present` with `set_from_sorted()` (or its parallel version if there is a pool), with duplicates in the input
+static set_t __build(const uint8_t *present, pool_t *P) {
+    uint64_t values[2 * UNIVERSE];
+    cmp_item_t keys[2 * UNIVERSE];
+    size_t n = 0;
+
+    for (uint64_t k = 0; k < UNIVERSE; k++) {
+        if (!present[k]) continue;
+        values[n] = values[n + 1] = k;
+        keys[n] = cmp_item_new(&values[n], sizeof(uint64_t));
+        keys[n + 1] = cmp_item_new(&values[n + 1], sizeof(uint64_t));
+        n += 1 + (k % 3 == 0);
+    }
+    return P ? set_from_sorted_parallel(keys, n, cmp_sgn_u64, P) : set_from_sorted(keys, n, cmp_sgn_u64);
+}
+
+static void __visit(struct set_node *node, void *arg) {
+    __atomic_fetch_add((uint64_t*)arg, *(uint64_t*)node->key.data, __ATOMIC_RELAXED);
+}
+
+static void test_build(pool_t *P, const char *name) {
+    uint8_t present[UNIVERSE];
+    uint64_t values[UNIVERSE], rng = 3;
+    cmp_item_t keys[UNIVERSE];
+
+    for (size_t round = 0; round < 40; round++) {
+        uint64_t density = test_rand(&rng) % 101, sum = 0, expected = 0;
+        size_t n = 0;
+
+        for (uint64_t k = 0; k < UNIVERSE; k++) {
+            present[k] = test_rand(&rng) % 100 < density;
+            if (present[k]) values[n++] = k;
+            if (present[k]) expected += k;
+        }
+
+        // Every size of a tree, and it stays balanced through later inserts and deletes
+        // Every other tree is ranked once built, so its weights are filled in afterwards
+        set_t S = __build(present, P);
+        if (round % 2) set_enable_rank(&S);
+        __compare(&S, present);
+        set_for_each(S, __visit, &sum, P);
+        CHECK(sum == expected);
+        for (size_t i = 0; i < 200; i++) {
+            uint64_t k = test_rand(&rng) % UNIVERSE;
+
+            if (i % 2) set_insert(&S, cmp_item_new(&k, sizeof(k)));
+            else set_delete(&S, cmp_item_new(&k, sizeof(k)));
+            present[k] = i % 2;
+        }
+        __compare(&S, present);
+        set_free(&S);
+
+        // Shuffled input goes through `set_from_array()`
+        for (size_t i = n; i > 1; i--) {
+            size_t j = test_rand(&rng) % i;
+            uint64_t t = values[i - 1];
+
+            values[i - 1] = values[j];
+            values[j] = t;
+        }
+        memset(present, 0, sizeof(present));
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = cmp_item_new(&values[i], sizeof(uint64_t));
+            present[values[i]] = 1;
+        }
+        S = set_from_array(keys, n, cmp_sgn_u64);
+        __compare(&S, present);
+        set_free(&S);
+    }
+    PASS(name);
+}
+
+static void test_algebra(pool_t *P, const char *name) {
+    uint8_t a[UNIVERSE], b[UNIVERSE], out[UNIVERSE];
+    uint64_t rng = 4;
+
+    for (size_t round = 0; round < 40; round++) {
+        // Densities from empty to full, so both the merge and the probing paths run
+        uint64_t da = test_rand(&rng) % 101, db = test_rand(&rng) % 101;
+
+        if (round % 4 == 0) da = da % 2;
+        for (size_t k = 0; k < UNIVERSE; k++) {
+            a[k] = test_rand(&rng) % 100 < da;
+            b[k] = test_rand(&rng) % 100 < db;
+        }
+
+        set_t A = __build(a, P), B = __build(b, P), U, I, D;
+
+        U = P ? set_union_parallel(A, B, P) : set_union(A, B);
+        I = P ? set_intersect_parallel(A, B, P) : set_intersect(A, B);
+        D = P ? set_difference_parallel(A, B, P) : set_difference(A, B);
+        for (size_t k = 0; k < UNIVERSE; k++) out[k] = a[k] | b[k];
+        __compare(&U, out);
+        for (size_t k = 0; k < UNIVERSE; k++) out[k] = a[k] & b[k];
+        __compare(&I, out);
+        for (size_t k = 0; k < UNIVERSE; k++) out[k] = a[k] & !b[k];
+        __compare(&D, out);
+
+        CHECK(set_is_subset(I, A) && set_is_subset(I, B) && set_is_subset(A, U) && set_is_subset(B, U));
+        CHECK(set_is_subset(A, B) == !set_size(D));
+        set_free(&D);
+        D = set_difference(B, A);
+        CHECK(set_is_subset(B, A) == !set_size(D));
+
+        set_free(&A);
+        set_free(&B);
+        set_free(&U);
+        set_free(&I);
+        set_free(&D);
+    }
+    PASS(name);
+}
+
+// Keys of 8 to 40 bytes, so some of them are stored inside the nodes and some are not
+static void test_sizes(set_t S, const char *name) {
+    uint8_t present[UNIVERSE] = {0};
+    uint64_t rng = 7, k, key[TEST_ITEM];
+    struct set_node *x, *prev = 0;
+    size_t n = 0;
+
+    for (size_t i = 0; i < OPS; i++) {
+        k = test_rand(&rng) % UNIVERSE;
+        cmp_item_t item = cmp_item_new(key, test_item(key, k));
+
+        switch (test_rand(&rng) % 3) {
+        case 0: set_insert(&S, item); present[k] = 1; break;
+        case 1: set_delete(&S, item); present[k] = 0; break;
+        default: CHECK(set_count(S, item) == present[k]);
+        }
+    }
+
+    // Every key is intact, and they come in the order of the comparator
+    for (x = set_first(S); x; prev = x, x = set_next(x)) {
+        k = *(uint64_t*)x->key.data;
+        CHECK(k < UNIVERSE && present[k] && x->key.size == test_item(key, k) && test_item_holds(x->key.data, k));
+        if (prev) CHECK(S.sgn_cmp(prev->key, x->key) < 0);
+        n++;
+    }
+    for (k = 0; k < UNIVERSE; k++) n -= present[k];
+    CHECK(!n);
+
+    set_free(&S);
+    PASS(name);
+}
+
+int main(void) {
+    set_t ranked = set_new(cmp_sgn_u64);
+    pool_t *P = pool_new(3);
+
+    set_enable_rank(&ranked);
+    // The typed descent, and the generic one (`cmp_sgn()` orders little-endian keys the same way)
+    test_random(set_new(cmp_sgn_u64), "set random operations");
+    test_random(set_new(cmp_sgn), "set random operations (generic comparator)");
+    test_random(set_new_slab(cmp_sgn_u64), "set random operations (slab)");
+    test_random(ranked, "set random operations (ranked)");
+    test_sizes(set_new(cmp_sgn), "set keys of mixed sizes");
+    test_sizes(set_new_slab(cmp_sgn), "set keys of mixed sizes (slab)");
+    test_batch(set_new(cmp_sgn_u64), "set batches");
+    test_batch(set_new(cmp_sgn), "set batches (generic comparator)");
+    test_batch(set_new_slab(cmp_sgn_u64), "set batches (slab)");
+    test_build(0, "set bulk loading");
+    test_build(P, "set bulk loading (pool of 3)");
+    test_algebra(0, "set algebra");
+    test_algebra(P, "set algebra (pool of 3)");
+
+    pool_free(P);
+    return 0;
+}
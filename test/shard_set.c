@@ -0,0 +1,101 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "shard_set.h"
+
+#include <stdatomic.h> // atomic_size_t
+#include <math.h>      // NAN
+
+#define THREADS 4
+#define KEYS 4096
+#define ITEMS 50000
+
+static shard_set_t *S;
+static atomic_size_t total;
+
+// Hashes doubles the way `cmp_sgn_f64()` compares them, so -0.0 meets 0.0 and every NaN meets the others
+static uint64_t __hash_f64(cmp_item_t key) {
+    double x;
+
+    memcpy(&x, key.data, sizeof(x));
+    if (x == 0) x = 0;
+    if (x != x) x = NAN;
+    return cmp_hash(cmp_item_new(&x, sizeof(x)));
+}
+
+static uint64_t __hash_size(cmp_item_t key) {
+    return key.size * 0x9e3779b97f4a7c15ull;
+}
+
+// Keys which are equal for the comparator but differ in their bytes are found through a matching hash
+static void test_hash(void) {
+    double zero = 0.0, negative = -0.0, nan = NAN, other = -NAN;
+    uint64_t a = 1, b = 2;
+
+    S = shard_set_new(64, cmp_sgn_f64, __hash_f64);
+    shard_set_insert(S, cmp_item_new(&zero, sizeof(zero)));
+    shard_set_insert(S, cmp_item_new(&nan, sizeof(nan)));
+    CHECK(shard_set_count(S, cmp_item_new(&negative, sizeof(negative))));
+    CHECK(shard_set_count(S, cmp_item_new(&other, sizeof(other))));
+    shard_set_insert(S, cmp_item_new(&negative, sizeof(negative)));
+    CHECK(shard_set_size(S) == 2);
+    shard_set_free(S);
+
+    S = shard_set_new(64, cmp_sgn_size, __hash_size);
+    shard_set_insert(S, cmp_item_new(&a, sizeof(a)));
+    CHECK(shard_set_count(S, cmp_item_new(&b, sizeof(b))) && !shard_set_count(S, cmp_item_new(&b, sizeof(uint32_t))));
+    shard_set_delete(S, cmp_item_new(&b, sizeof(b)));
+    CHECK(!shard_set_size(S));
+    shard_set_free(S);
+    PASS("sharded set with a custom hash");
+}
+
+// ---
+// Every thread owns the keys equal to its id modulo THREADS and compares them with its own model,
+// while looking up the keys of the others.
+
+static void *__worker(void *arg) {
+    uint64_t id = (uint64_t)(size_t)arg, rng = id + 100, k;
+    uint8_t present[KEYS / THREADS] = {0};
+    size_t n = 0;
+
+    for (size_t i = 0; i < ITEMS; i++) {
+        size_t slot = test_rand(&rng) % (KEYS / THREADS);
+
+        k = slot * THREADS + id;
+        switch (test_rand(&rng) % 3) {
+        case 0:
+            shard_set_insert(S, cmp_item_new(&k, sizeof(k)));
+            n += !present[slot];
+            present[slot] = 1;
+            break;
+        case 1:
+            shard_set_delete(S, cmp_item_new(&k, sizeof(k)));
+            n -= present[slot];
+            present[slot] = 0;
+            break;
+        default:
+            CHECK(shard_set_count(S, cmp_item_new(&k, sizeof(k))) == present[slot]);
+            k = test_rand(&rng) % KEYS;
+            shard_set_count(S, cmp_item_new(&k, sizeof(k)));
+        }
+    }
+    atomic_fetch_add(&total, n);
+    return 0;
+}
+
+static void test_concurrent(void) {
+    S = shard_set_new(16, cmp_sgn_u64, 0);
+    test_threads(THREADS, __worker);
+    CHECK(shard_set_size(S) == atomic_load(&total));
+    shard_set_free(S);
+    PASS("sharded set from every thread");
+}
+
+//
+// ---
+
+int main(void) {
+    test_hash();
+    test_concurrent();
+    return 0;
+}
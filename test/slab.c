@@ -0,0 +1,70 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "slab.h"
+
+#define OBJECTS 4096
+#define OPS 400000
+
+// Reserved objects are contiguous even when the current chunk is half used, and its rest is carved afterwards
+static void test_reserve(void) {
+    slab_t *P = slab_new();
+    uint8_t *first, *obj, *next;
+    size_t n = 2 * SLAB_CHUNK / 48;
+
+    first = (uint8_t*)slab_alloc(P, 48);
+    for (size_t i = 1; i < 100; i++) CHECK(slab_alloc(P, 48) == first + i * 48);
+
+    slab_reserve(P, 48, n);
+    obj = (uint8_t*)slab_alloc(P, 48);
+    for (size_t i = 1; i < n; i++) CHECK(slab_alloc(P, 48) == obj + i * 48);
+
+    // Then the rest of the first chunk, then released objects before anything else
+    next = (uint8_t*)slab_alloc(P, 48);
+    CHECK(next == first + 100 * 48);
+    slab_free(P, first, 48);
+    CHECK(slab_alloc(P, 48) == first);
+
+    // A reservation which fits in the current chunk doesn't move it
+    next = (uint8_t*)slab_alloc(P, 48);
+    slab_reserve(P, 48, 10);
+    CHECK(slab_alloc(P, 48) == next + 48);
+
+    slab_destroy(P);
+    PASS("slab reservations");
+}
+
+// Live objects of random sizes, filled with their index, must never overlap
+static void test_random(void) {
+    static uint8_t *objects[OBJECTS];
+    static size_t sizes[OBJECTS];
+    slab_t *P = slab_new();
+    uint64_t rng = 16;
+
+    for (size_t i = 0; i < OPS; i++) {
+        size_t j = test_rand(&rng) % OBJECTS;
+
+        if (objects[j]) {
+            for (size_t b = 0; b < sizes[j]; b++) CHECK(objects[j][b] == (uint8_t)j);
+            slab_free(P, objects[j], sizes[j]);
+            objects[j] = 0;
+        } else {
+            // Mostly small objects, some of them bigger than the biggest class
+            sizes[j] = test_rand(&rng) % 8 ? test_rand(&rng) % (SLAB_ALIGN * SLAB_CLASSES) + 1 : test_rand(&rng) % 1024 + 1;
+            if (i % 1000 == 0) slab_reserve(P, sizes[j], test_rand(&rng) % 2000);
+            objects[j] = (uint8_t*)slab_alloc(P, sizes[j]);
+            memset(objects[j], (uint8_t)j, sizes[j]);
+        }
+    }
+    for (size_t j = 0; j < OBJECTS; j++) {
+        for (size_t b = 0; objects[j] && b < sizes[j]; b++) CHECK(objects[j][b] == (uint8_t)j);
+    }
+
+    slab_destroy(P);
+    PASS("slab random allocations");
+}
+
+int main(void) {
+    test_reserve();
+    test_random();
+    return 0;
+}
@@ -0,0 +1,132 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "snapshot.h"
+
+#include <string.h> // memcmp() and strlen()
+#include <unistd.h> // rmdir(), truncate() and access()
+
+#define UNIVERSE 4096
+
+// Compares the snapshot at `path` with `M`, by walking it in order and by looking up every key
+static void __compare(map_t M, const char *path) {
+    snapshot_t V = snapshot_open(path, cmp_sgn);
+    struct map_node *node = map_first(M);
+    size_t pos = snapshot_first(V);
+
+    CHECK(V.base && snapshot_size(V) == map_size(M));
+    for (; node; node = map_next(node), pos = snapshot_next(V, pos)) {
+        cmp_item_t key = snapshot_key(V, pos), value = snapshot_value(V, pos);
+
+        CHECK(pos && key.size == node->key.size && !memcmp(key.data, node->key.data, key.size));
+        CHECK(value.size == node->value.size && !memcmp(value.data, node->value.data, value.size));
+        CHECK(snapshot_count(V, node->key) && snapshot_lower_bound(V, node->key) == pos);
+        value = snapshot_find(V, node->key);
+        CHECK(value.size == node->value.size && !memcmp(value.data, node->value.data, value.size));
+    }
+    CHECK(!pos);
+    snapshot_close(&V);
+}
+
+static void test_map(const char *dir) {
+    char path[256], tmp[sizeof(path) + 4], key[64], value[64];
+    map_t M = map_new(cmp_sgn);
+    struct snapshot_header header;
+    struct snapshot_entry entry;
+    snapshot_t V;
+    FILE *F;
+
+    snprintf(path, sizeof(path), "%s/map.snap", dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    CHECK(snapshot_write_map(M, path));
+    __compare(M, path);
+
+    // Keys and values on both sides of the 8 bytes kept in the entries
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), i % 2 ? "k%d" : "key-%06d-long-enough", i);
+        snprintf(value, sizeof(value), i % 3 ? "v%d" : "value-%d-also-long-enough", i);
+        map_insert(&M, cmp_item_new(key, strlen(key)), cmp_item_new(value, strlen(value)));
+    }
+    CHECK(snapshot_write_map(M, path) && access(tmp, F_OK));
+    __compare(M, path);
+
+    // Rewriting the file leaves an open mapping of the old one intact
+    V = snapshot_open(path, cmp_sgn);
+    map_insert(&M, cmp_item_new("zz-a-key-added-later", 20), cmp_item_new("x", 1));
+    CHECK(snapshot_write_map(M, path));
+    CHECK(snapshot_size(V) == 1000 && !snapshot_count(V, cmp_item_new("zz-a-key-added-later", 20)));
+    snapshot_close(&V);
+    __compare(M, path);
+
+    // A blob offset past the end of the file is rejected
+    F = fopen(path, "r+b");
+    CHECK(F && fread(&header, sizeof(header), 1, F) == 1);
+    CHECK(!fseek(F, (long)header.index, SEEK_SET));
+    do CHECK(fread(&entry, sizeof(entry), 1, F) == 1); while (entry.key_size <= sizeof(entry.key));
+    entry.key = header.length - 4;
+    CHECK(!fseek(F, -(long)sizeof(entry), SEEK_CUR) && fwrite(&entry, sizeof(entry), 1, F) == 1);
+    fclose(F);
+    V = snapshot_open(path, cmp_sgn);
+    CHECK(!V.base);
+
+    // So is a truncated file
+    CHECK(snapshot_write_map(M, path));
+    CHECK(!truncate(path, (off_t)(header.length / 2)));
+    V = snapshot_open(path, cmp_sgn);
+    CHECK(!V.base);
+
+    // Writing into a missing directory fails
+    snprintf(path, sizeof(path), "%s/missing/map.snap", dir);
+    CHECK(!snapshot_write_map(M, path));
+
+    snprintf(path, sizeof(path), "%s/map.snap", dir);
+    remove(path);
+    map_free(&M);
+    PASS("snapshot of a map");
+}
+
+// Every size of the implicit tree, and the bounds of keys which are missing from it
+static void test_set(const char *dir) {
+    uint8_t present[UNIVERSE] = {0};
+    uint64_t rng = 17;
+    char path[256];
+    set_t S = set_new(cmp_sgn_u64);
+
+    snprintf(path, sizeof(path), "%s/set.snap", dir);
+    for (size_t round = 0; round < 12; round++) {
+        for (size_t i = 0; i < (size_t)1 << round; i++) {
+            uint64_t k = test_rand(&rng) % UNIVERSE;
+            set_insert(&S, cmp_item_new(&k, sizeof(k)));
+            present[k] = 1;
+        }
+        CHECK(snapshot_write_set(S, path));
+
+        snapshot_t V = snapshot_open(path, cmp_sgn_u64);
+        CHECK(V.base && snapshot_size(V) == set_size(S));
+        for (uint64_t k = 0; k < UNIVERSE; k++) {
+            size_t pos = snapshot_lower_bound(V, cmp_item_new(&k, sizeof(k)));
+            uint64_t l = k;
+
+            while (l < UNIVERSE && !present[l]) l++;
+            CHECK(snapshot_count(V, cmp_item_new(&k, sizeof(k))) == present[k]);
+            CHECK(l == UNIVERSE ? !pos : pos && *(uint64_t*)snapshot_key(V, pos).data == l && !snapshot_value(V, pos).size);
+        }
+        snapshot_close(&V);
+    }
+
+    remove(path);
+    set_free(&S);
+    PASS("snapshot of a set");
+}
+
+int main(void) {
+    char dir[] = "/tmp/ctypes-snapshot-XXXXXX";
+
+    CHECK(mkdtemp(dir));
+    test_map(dir);
+    test_set(dir);
+
+    // Every file the tests made must be gone by now
+    CHECK(!rmdir(dir));
+    return 0;
+}
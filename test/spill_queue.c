@@ -0,0 +1,77 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "spill_queue.h"
+
+#include <string.h> // memcmp() and memset()
+#include <unistd.h> // rmdir()
+
+#define OPS 50000
+
+static void test_random(const char *dir) {
+    static uint64_t model[OPS], big[1024];
+    uint64_t rng = 12, item[TEST_ITEM];
+    // Segments of a few items, so most of the queue lives on disk
+    spill_queue_t *Q = spill_queue_new(dir, 1024);
+    size_t first = 0, last = 0;
+
+    for (size_t i = 0; i < OPS; i++) {
+        if (test_rand(&rng) % 4 < ((i / 10000) % 2 ? 1 : 3) || first == last) {
+            model[last] = test_rand(&rng);
+            CHECK(spill_queue_push(Q, item, test_item(item, model[last++])));
+        } else {
+            CHECK(spill_queue_front_size(Q) == test_item(item, model[first]));
+            CHECK(test_item_holds(spill_queue_front(Q), model[first++]));
+            spill_queue_pop(Q);
+        }
+        CHECK(spill_queue_size(Q) == last - first && spill_queue_empty(Q) == (first == last));
+    }
+
+    // Records bigger than a segment get one of their own
+    memset(big, 7, sizeof(big));
+    CHECK(spill_queue_push(Q, big, sizeof(big)));
+    for (; first != last; first++) {
+        CHECK(test_item_holds(spill_queue_front(Q), model[first]));
+        spill_queue_pop(Q);
+    }
+    CHECK(spill_queue_front_size(Q) == sizeof(big) && !memcmp(spill_queue_front(Q), big, sizeof(big)));
+    spill_queue_pop(Q);
+    CHECK(spill_queue_empty(Q) && !spill_queue_front(Q) && !spill_queue_front_size(Q));
+
+    // Freeing a queue with spilled segments deletes their files
+    for (uint64_t i = 0; i < 1000; i++) CHECK(spill_queue_push(Q, item, test_item(item, i)));
+    spill_queue_free(Q);
+    PASS("spill queue");
+}
+
+// A segment which can't be spilled leaves the queue as it was
+static void test_missing(const char *dir) {
+    char path[256];
+    uint64_t item[TEST_ITEM];
+    spill_queue_t *Q;
+    size_t n = 0;
+
+    snprintf(path, sizeof(path), "%s/missing", dir);
+    Q = spill_queue_new(path, 256);
+    while (n < 1000 && spill_queue_push(Q, item, test_item(item, n))) n++;
+    CHECK(n < 1000 && spill_queue_size(Q) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        CHECK(test_item_holds(spill_queue_front(Q), i));
+        spill_queue_pop(Q);
+    }
+    CHECK(spill_queue_empty(Q));
+    spill_queue_free(Q);
+    PASS("spill queue without a directory");
+}
+
+int main(void) {
+    char dir[] = "/tmp/ctypes-spill-XXXXXX";
+
+    CHECK(mkdtemp(dir));
+    test_random(dir);
+    test_missing(dir);
+
+    // Every file the tests made must be gone by now
+    CHECK(!rmdir(dir));
+    return 0;
+}
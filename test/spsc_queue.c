@@ -0,0 +1,104 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "spsc_queue.h"
+
+#include <sched.h> // sched_yield()
+
+#define ITEMS 200000
+#define BATCH 16
+
+static spsc_queue_t *Q;
+
+// A full queue refuses pushes and takes only part of a batch, an empty one pops nothing,
+// and items bigger than a slot come back whole from the front
+static void test_bounds(void) {
+    uint64_t item[TEST_ITEM], items[4 * BATCH];
+    size_t n = 0;
+
+    Q = spsc_queue_new(10, sizeof(uint64_t));
+    while (spsc_queue_push(Q, item, test_item(item, n))) n++;
+    CHECK(n >= 10 && spsc_queue_size(Q) == n && !spsc_queue_push_n(Q, items, sizeof(uint64_t), 1));
+
+    for (size_t i = 0; i < n; i++) {
+        CHECK(test_item_holds(spsc_queue_front(Q), i));
+        CHECK(spsc_queue_pop(Q));
+    }
+    CHECK(spsc_queue_empty(Q) && !spsc_queue_front(Q) && !spsc_queue_pop(Q));
+    CHECK(!spsc_queue_pop_n(Q, items, sizeof(uint64_t), BATCH));
+
+    for (size_t i = 0; i < 4 * BATCH; i++) items[i] = i;
+    n = spsc_queue_push_n(Q, items, sizeof(uint64_t), 4 * BATCH);
+    CHECK(n >= 10 && n < 4 * BATCH && spsc_queue_size(Q) == n);
+    CHECK(spsc_queue_pop_n(Q, items, sizeof(uint64_t), n + 5) == n);
+    for (size_t i = 0; i < n; i++) CHECK(items[i] == i);
+
+    // Elements left in the queue are released with it
+    for (size_t i = 0; i < 5; i++) spsc_queue_push(Q, item, test_item(item, 4));
+    spsc_queue_free(Q);
+    PASS("spsc queue bounds");
+}
+
+// ---
+// The producer pushes single items and batches, the consumer pops them the same two ways
+// and must see every number in order.
+
+static void *__producer(void *arg) {
+    uint64_t items[BATCH];
+
+    (void)arg;
+    for (uint64_t i = 0; i < ITEMS;) {
+        size_t n;
+
+        if (i % 7) {
+            n = spsc_queue_push(Q, &i, sizeof(i));
+        } else {
+            for (size_t j = 0; j < BATCH; j++) items[j] = i + j;
+            n = spsc_queue_push_n(Q, items, sizeof(uint64_t), ITEMS - i < BATCH ? ITEMS - i : BATCH);
+        }
+        if (!n) sched_yield();
+        i += n;
+    }
+    return 0;
+}
+
+static void *__consumer(void *arg) {
+    uint64_t items[BATCH], *front;
+    size_t n;
+
+    (void)arg;
+    for (uint64_t i = 0; i < ITEMS;) {
+        if (i % 5) {
+            if (!(front = (uint64_t*)spsc_queue_front(Q))) {
+                sched_yield();
+                continue;
+            }
+            CHECK(*front == i++);
+            CHECK(spsc_queue_pop(Q));
+            continue;
+        }
+        if (!(n = spsc_queue_pop_n(Q, items, sizeof(uint64_t), BATCH))) sched_yield();
+        for (size_t j = 0; j < n; j++) CHECK(items[j] == i++);
+    }
+    return 0;
+}
+
+static void *__worker(void *arg) {
+    return arg ? __consumer(arg) : __producer(arg);
+}
+
+static void test_concurrent(void) {
+    Q = spsc_queue_new(64, sizeof(uint64_t));
+    test_threads(2, __worker);
+    CHECK(spsc_queue_empty(Q));
+    spsc_queue_free(Q);
+    PASS("spsc queue producer and consumer");
+}
+
+//
+// ---
+
+int main(void) {
+    test_bounds();
+    test_concurrent();
+    return 0;
+}
@@ -0,0 +1,35 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "stack.h"
+
+#define OPS 200000
+
+static void test_stack(void) {
+    static uint64_t model[OPS];
+    uint64_t rng = 9, item[TEST_ITEM];
+    stack_t S = stack_new();
+    size_t n = 0;
+
+    for (size_t i = 0; i < OPS; i++) {
+        if (test_rand(&rng) % 3 || !n) {
+            model[n] = test_rand(&rng);
+            stack_push(&S, item, test_item(item, model[n++]));
+        } else {
+            stack_pop(&S);
+            n--;
+        }
+        CHECK(stack_size(S) == n && stack_empty(S) == !n);
+        if (n) CHECK(test_item_holds(stack_top(S), model[n - 1]));
+    }
+    while (n--) {
+        CHECK(test_item_holds(stack_top(S), model[n]));
+        stack_pop(&S);
+    }
+    CHECK(stack_empty(S));
+    PASS("stack");
+}
+
+int main(void) {
+    test_stack();
+    return 0;
+}
@@ -0,0 +1,69 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_TEST_H
+#define _CTYPES_TEST_H
+
+#include <stdio.h>   // fprintf()
+#include <stdlib.h>  // abort()
+#include <stdint.h>  // uint64_t
+#include <string.h>  // memcmp()
+#include <pthread.h> // pthread_create() and pthread_join()
+
+// ---
+// Test helpers
+//
+// Every test is a program which returns 0 when all of its checks pass and aborts on the first failure.
+// Containers are compared against a plain model (a presence array or a vector) after random operations,
+// and the random numbers come from a fixed seed, so a failure reproduces on every run.
+
+// Aborts with the condition and its location if it doesn't hold
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        abort(); \
+    } \
+} while (0)
+
+// Returns the next number of a splitmix64 sequence
+static inline uint64_t test_rand(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Fills `item` (room for `TEST_ITEM` words) with a payload made from `value` and returns its size
+// Sizes run from 8 to 40 bytes, on both sides of the containers' inline limits
+#define TEST_ITEM 5
+static inline size_t test_item(uint64_t *item, uint64_t value) {
+    size_t words = value % TEST_ITEM + 1;
+
+    for (size_t i = 0; i < words; i++) item[i] = value;
+    return words * sizeof(uint64_t);
+}
+
+// Checks that `item` holds the payload `test_item()` makes from `value`
+static inline int test_item_holds(const void *item, uint64_t value) {
+    uint64_t expected[TEST_ITEM];
+    size_t size = test_item(expected, value);
+
+    return !memcmp(item, expected, size);
+}
+
+// Runs `fn(i)` for every `i` below `n` (at most `TEST_THREADS`), each on its own thread, and waits for all of them
+#define TEST_THREADS 8
+static inline void test_threads(size_t n, void *(*fn)(void *arg)) {
+    pthread_t threads[TEST_THREADS];
+
+    CHECK(n <= TEST_THREADS);
+    for (size_t i = 0; i < n; i++) CHECK(!pthread_create(&threads[i], 0, fn, (void*)i));
+    for (size_t i = 0; i < n; i++) CHECK(!pthread_join(threads[i], 0));
+}
+
+// Prints the name of a passed test
+#define PASS(name) fprintf(stderr, "ok   %s\n", name)
+
+//
+// ---
+
+#endif
\ No newline at end of file
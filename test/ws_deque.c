@@ -0,0 +1,100 @@
+// It's licensed under MIT, btw
+#include "test.h"
+#include "ws_deque.h"
+
+#include <stdatomic.h> // atomic_int and atomic_uchar
+#include <sched.h>     // sched_yield()
+
+#define THIEVES 3
+#define ITEMS 200000
+
+// Every item is pushed once by the owner and must be popped exactly once, `taken[]` counts how often it was
+static atomic_uchar taken[ITEMS];
+static atomic_int done;
+static ws_deque_t *L;
+
+static void __take(uint64_t item) {
+    CHECK(item < ITEMS);
+    CHECK(atomic_fetch_add_explicit(&taken[item], 1, memory_order_relaxed) == 0);
+}
+
+// On one thread the back is a stack and the front a queue, through growth of the array,
+// and popping into a small buffer truncates but reports the size
+static void test_sequential(ws_deque_t *deque, const char *name) {
+    uint64_t item[TEST_ITEM], out[TEST_ITEM], first = 0, last = 1000;
+    size_t size;
+
+    L = deque;
+    for (uint64_t i = 0; i < last; i++) ws_deque_push_back(L, item, test_item(item, i));
+    CHECK(ws_deque_size(L) == last && !ws_deque_empty(L));
+
+    while (first < last) {
+        uint64_t i = first % 3 ? first++ : --last;
+
+        size = i % 4 ? sizeof(out) : sizeof(uint64_t);
+        CHECK(i == last ? ws_deque_pop_back(L, out, &size) : ws_deque_pop_front(L, out, &size));
+        CHECK(size == test_item(item, i) && out[0] == i && (i % 4 == 0 || test_item_holds(out, i)));
+    }
+    CHECK(ws_deque_empty(L) && !ws_deque_pop_back(L, out, &size) && !ws_deque_pop_front(L, out, &size));
+
+    // Elements left in the deque are released with it
+    for (uint64_t i = 0; i < 5; i++) ws_deque_push_back(L, item, test_item(item, i));
+    ws_deque_free(L);
+    PASS(name);
+}
+
+// ---
+// The owner pushes every item and pops some of them back, the thieves steal from the front.
+
+static void *__worker(void *arg) {
+    uint64_t item[3], rng = 13;
+    size_t size;
+
+    if (arg) {
+        while (!atomic_load(&done) || !ws_deque_empty(L)) {
+            size = sizeof(item);
+            if (!ws_deque_pop_front(L, item, &size)) {
+                sched_yield();
+                continue;
+            }
+            CHECK(size == sizeof(uint64_t) || (item[1] == item[0] && item[2] == item[0]));
+            __take(item[0]);
+        }
+        return 0;
+    }
+
+    for (uint64_t i = 0; i < ITEMS; i++) {
+        item[0] = item[1] = item[2] = i;
+        ws_deque_push_back(L, item, i % 5 ? sizeof(uint64_t) : sizeof(item));
+
+        size = sizeof(item);
+        if (test_rand(&rng) % 2 && ws_deque_pop_back(L, item, &size)) __take(item[0]);
+    }
+    atomic_store(&done, 1);
+    return 0;
+}
+
+// Starts small, so the array grows under the thieves
+static void test_concurrent(ws_deque_t *deque, const char *name) {
+    L = deque;
+    atomic_store(&done, 0);
+    for (size_t i = 0; i < ITEMS; i++) atomic_store_explicit(&taken[i], 0, memory_order_relaxed);
+
+    test_threads(THIEVES + 1, __worker);
+    for (size_t i = 0; i < ITEMS; i++) CHECK(atomic_load_explicit(&taken[i], memory_order_relaxed) == 1);
+    ws_deque_free(L);
+    PASS(name);
+}
+
+//
+// ---
+
+int main(void) {
+    test_sequential(ws_deque_new(4), "work-stealing deque");
+    // Items up to 16 bytes are stored in the array, bigger ones are not (and a slot past `WS_DEQUE_INLINE` is clamped)
+    test_sequential(ws_deque_new_inline(4, 16), "work-stealing deque (inline)");
+    test_sequential(ws_deque_new_inline(4, 1000), "work-stealing deque (every item inline)");
+    test_concurrent(ws_deque_new(4), "work-stealing deque owner and thieves");
+    test_concurrent(ws_deque_new_inline(4, 16), "work-stealing deque owner and thieves (inline)");
+    return 0;
+}
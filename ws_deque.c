@@ -0,0 +1,215 @@
+// It's licensed under MIT, btw
+#include "ws_deque.h"
+#include "epoch.h"
+
+#include <stddef.h> // size_t and ptrdiff_t
+#include <stdint.h> // uintptr_t
+#include <string.h> // memcpy()
+#include <stdlib.h> // aligned_alloc(), malloc() and free()
+
+#define WS_DEQUE_MIN 16
+
+// The most words an element takes
+#define WS_DEQUE_WORDS (1 + (WS_DEQUE_INLINE + sizeof(uintptr_t) - 1) / sizeof(uintptr_t))
+
+// ---
+// element helpers
+//
+// An element is built in (and taken out of) a local array of words, which is then copied word by word
+// to (or from) the deque's array. Thieves copy it before their compare-and-swap, and only the winner keeps it.
+// Whoever takes an element out of the deque (the owner or a successful thief) owns its heap copy, if any.
+
+// Builds the element for `item` in `element` and returns the number of words it uses
+static size_t __element_new(ws_deque_t *L, uintptr_t *element, void *item, size_t size) {
+    void *copy;
+
+    element[0] = size;
+    if (size <= L->slot) {
+        memcpy(element + 1, item, size);
+        return 1 + (size + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+    }
+
+    copy = malloc(size);
+    memcpy(copy, item, size);
+    element[1] = (uintptr_t)copy;
+    return 2;
+}
+
+static void __element_take(ws_deque_t *L, uintptr_t *element, void *item, size_t *size) {
+    size_t n = element[0];
+    void *data = n <= L->slot ? (void*)(element + 1) : (void*)element[1];
+
+    memcpy(item, data, n < *size ? n : *size);
+    *size = n;
+    if (n > L->slot) free(data);
+}
+
+// ---
+
+// ---
+// array helpers
+//
+// Thieves may still read an array after the owner has replaced it,
+// so old arrays are retired through `epoch.h` and thieves read inside a critical section.
+
+static struct ws_array *__array_new(ws_deque_t *L, size_t capacity) {
+    struct ws_array *A = (struct ws_array*)malloc(sizeof(struct ws_array) + capacity * L->stride * sizeof(_Atomic(uintptr_t)));
+
+    A->capacity = capacity;
+    return A;
+}
+
+static _Atomic(uintptr_t) *__array_at(ws_deque_t *L, struct ws_array *A, ptrdiff_t i) {
+    return &A->words[((size_t)i & (A->capacity - 1)) * L->stride];
+}
+
+// Copies all `stride` words of the element at `i`, whatever its size
+static void __array_get(ws_deque_t *L, struct ws_array *A, ptrdiff_t i, uintptr_t *element) {
+    _Atomic(uintptr_t) *at = __array_at(L, A, i);
+
+    for (size_t w = 0; w < L->stride; w++) element[w] = atomic_load_explicit(&at[w], memory_order_relaxed);
+}
+
+static void __array_put(ws_deque_t *L, struct ws_array *A, ptrdiff_t i, const uintptr_t *element, size_t words) {
+    _Atomic(uintptr_t) *at = __array_at(L, A, i);
+
+    for (size_t w = 0; w < words; w++) atomic_store_explicit(&at[w], element[w], memory_order_relaxed);
+}
+
+static void __array_free(void *A) {
+    free(A);
+}
+
+static struct ws_array *__array_grow(ws_deque_t *L, struct ws_array *A, ptrdiff_t top, ptrdiff_t bottom) {
+    struct ws_array *N = __array_new(L, A->capacity * 2);
+    uintptr_t element[WS_DEQUE_WORDS];
+
+    for (ptrdiff_t i = top; i < bottom; i++) {
+        __array_get(L, A, i, element);
+        __array_put(L, N, i, element, L->stride);
+    }
+
+    atomic_store_explicit(&L->array, N, memory_order_release);
+    epoch_retire(A, __array_free);
+    return N;
+}
+
+// ---
+
+ws_deque_t *ws_deque_new(size_t capacity) {
+    return ws_deque_new_inline(capacity, 0);
+}
+
+ws_deque_t *ws_deque_new_inline(size_t capacity, size_t slot) {
+    ws_deque_t *L = (ws_deque_t*)aligned_alloc(WS_DEQUE_CACHE_LINE, sizeof(ws_deque_t));
+    size_t n = WS_DEQUE_MIN, words;
+
+    while (n < capacity) n <<= 1;
+    if (slot > WS_DEQUE_INLINE) slot = WS_DEQUE_INLINE;
+    // Room for the bytes, or at least for the pointer to them
+    words = (slot + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+
+    L->slot = slot;
+    L->stride = 1 + (words ? words : 1);
+    atomic_init(&L->top, 0);
+    atomic_init(&L->bottom, 0);
+    atomic_init(&L->array, __array_new(L, n));
+    return L;
+}
+
+int ws_deque_empty(ws_deque_t *L) {
+    return !ws_deque_size(L);
+}
+
+size_t ws_deque_size(ws_deque_t *L) {
+    ptrdiff_t top = atomic_load_explicit(&L->top, memory_order_acquire);
+    ptrdiff_t bottom = atomic_load_explicit(&L->bottom, memory_order_acquire);
+
+    return bottom > top ? (size_t)(bottom - top) : 0;
+}
+
+
+void ws_deque_push_back(ws_deque_t *L, void *item, size_t size) {
+    ptrdiff_t bottom = atomic_load_explicit(&L->bottom, memory_order_relaxed);
+    ptrdiff_t top = atomic_load_explicit(&L->top, memory_order_acquire);
+    struct ws_array *A = atomic_load_explicit(&L->array, memory_order_relaxed);
+    uintptr_t element[WS_DEQUE_WORDS];
+    size_t words = __element_new(L, element, item, size);
+
+    if ((size_t)(bottom - top) >= A->capacity) A = __array_grow(L, A, top, bottom);
+
+    __array_put(L, A, bottom, element, words);
+    atomic_store_explicit(&L->bottom, bottom + 1, memory_order_release);
+}
+
+int ws_deque_pop_back(ws_deque_t *L, void *item, size_t *size) {
+    ptrdiff_t bottom = atomic_load_explicit(&L->bottom, memory_order_relaxed) - 1;
+    struct ws_array *A = atomic_load_explicit(&L->array, memory_order_relaxed);
+    uintptr_t element[WS_DEQUE_WORDS];
+    ptrdiff_t top;
+    int taken = 0;
+
+    // Claim the last element before looking at `top`, so a thief either sees the claim or wins it
+    atomic_store_explicit(&L->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    top = atomic_load_explicit(&L->top, memory_order_relaxed);
+
+    if (top <= bottom) {
+        __array_get(L, A, bottom, element);
+        taken = 1;
+
+        if (top == bottom) {
+            // The only element left may be stolen at the same time, whoever advances `top` gets it
+            if (!atomic_compare_exchange_strong_explicit(&L->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+                taken = 0;
+            atomic_store_explicit(&L->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&L->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    if (!taken) return 0;
+    __element_take(L, element, item, size);
+    return 1;
+}
+
+int ws_deque_pop_front(ws_deque_t *L, void *item, size_t *size) {
+    uintptr_t element[WS_DEQUE_WORDS];
+    int taken = 0;
+
+    epoch_enter();
+    for (;;) {
+        ptrdiff_t top = atomic_load_explicit(&L->top, memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        ptrdiff_t bottom = atomic_load_explicit(&L->bottom, memory_order_acquire);
+
+        if (top >= bottom) break;
+
+        struct ws_array *A = atomic_load_explicit(&L->array, memory_order_acquire);
+        __array_get(L, A, top, element);
+        if (atomic_compare_exchange_strong_explicit(&L->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            taken = 1;
+            break;
+        }
+    }
+    epoch_exit();
+
+    if (!taken) return 0;
+    __element_take(L, element, item, size);
+    return 1;
+}
+
+void ws_deque_free(ws_deque_t *L) {
+    ptrdiff_t top = atomic_load_explicit(&L->top, memory_order_relaxed);
+    ptrdiff_t bottom = atomic_load_explicit(&L->bottom, memory_order_relaxed);
+    struct ws_array *A = atomic_load_explicit(&L->array, memory_order_relaxed);
+    uintptr_t element[WS_DEQUE_WORDS];
+
+    for (ptrdiff_t i = top; i < bottom; i++) {
+        __array_get(L, A, i, element);
+        if (element[0] > L->slot) free((void*)element[1]);
+    }
+
+    free(A);
+    free(L);
+}
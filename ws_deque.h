@@ -0,0 +1,68 @@
+// It's licensed under MIT, btw
+#ifndef _CTYPES_WS_DEQUE_H
+#define _CTYPES_WS_DEQUE_H
+
+#include <stddef.h>    // size_t and ptrdiff_t
+#include <stdint.h>    // uintptr_t
+#include <stdatomic.h> // atomic_ptrdiff_t and _Atomic
+
+// The size of a cache line, the thieves' and the owner's indices are kept on separate ones
+#define WS_DEQUE_CACHE_LINE 64
+
+// The biggest slot `ws_deque_new_inline()` accepts, thieves copy an element this big to their stack before claiming it
+#define WS_DEQUE_INLINE 64
+
+// A circular array of elements, replaced by a bigger copy when full
+// Every element takes `stride` words of the deque: its size, then its bytes if they fit the slot or a pointer to a copy of them
+struct ws_array {
+    size_t capacity; // Always a power of two
+    _Atomic(uintptr_t) words[];
+};
+
+// A work-stealing deque, obtained with `ws_deque_new()`
+// One owner thread pushes and pops at the back, any number of thieves pop at the front
+struct ws_deque {
+    _Alignas(WS_DEQUE_CACHE_LINE) atomic_ptrdiff_t top; // The position of the first element, advanced by thieves (and the owner on the last one)
+
+    _Alignas(WS_DEQUE_CACHE_LINE) atomic_ptrdiff_t bottom; // The position after the last element, written by the owner only
+    _Atomic(struct ws_array*) array;
+    size_t slot;   // Items up to this many bytes are stored in the array itself
+    size_t stride; // The number of words per element
+};
+
+typedef struct ws_deque ws_deque_t;
+
+
+// Returns an empty deque with room for at least `capacity` elements before it grows
+// Every element is copied to the heap, the array only holds its size and a pointer
+extern ws_deque_t *ws_deque_new(size_t capacity);
+
+// Same as `ws_deque_new()`, but items up to `slot` bytes (at most `WS_DEQUE_INLINE`) are stored in the array itself,
+// so pushing and popping them doesn't allocate. Bigger items are still copied to the heap
+extern ws_deque_t *ws_deque_new_inline(size_t capacity, size_t slot);
+
+// Returns a boolean value indicating whether or not `L` is empty (only a snapshot under concurrent use)
+extern int ws_deque_empty(ws_deque_t *L);
+
+// Returns the number of elements (only a snapshot under concurrent use)
+extern size_t ws_deque_size(ws_deque_t *L);
+
+
+// Copies an element to the back (owner only)
+extern void ws_deque_push_back(ws_deque_t *L, void *item, size_t size);
+
+// Moves the last element into `item`, which has room for `*size` bytes, and stores its real size in `*size` (owner only)
+// (Bigger elements are truncated)
+// Returns 0 if the deque is empty
+extern int ws_deque_pop_back(ws_deque_t *L, void *item, size_t *size);
+
+// Steals the first element the same way (any thread)
+// Never blocks the owner, retries only when another thread took the element first
+// Returns 0 if the deque is empty
+extern int ws_deque_pop_front(ws_deque_t *L, void *item, size_t *size);
+
+// Releases the deque and the elements left in it
+// No other thread may be using the deque
+extern void ws_deque_free(ws_deque_t *L);
+
+#endif
\ No newline at end of file